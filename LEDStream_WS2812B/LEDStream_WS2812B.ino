@@ -2,6 +2,10 @@
 // Uses Adalight protocol and is compatible with Boblight, Prismatik etc.
 // The "magic word" for synchronisation is "Ada" followed by LED count high and low byte and a checksum (the low and high byte XORed with 0x55).
 // The interface sends the string "Ada\n" in 1000ms intervals when idle, so the software can detect the display.
+// It also supports the extended protocol of NerDisco, which only sends LEDs that changed (see LEDStream.h in the NerDisco sources).
+// The magic word is "Adx" followed by LED count high and low byte, flags and a checksum (count bytes and flags XORed with 0x55).
+// It is announced by sending "Adx" followed by the capabilities as a hexadecimal digit and "\n" after "Ada\n".
+// After showing a frame the interface sends "Adr\n", so the software never sends frames faster than they can be shown.
 
 #include <FastLED.h>
 
@@ -9,11 +13,18 @@
 #define SERIAL_TIMEOUT 1000 //turn display off after a second. this is also the SCK send interval
 
 //Adalight sends a "magic word" (defined in /etc/boblight.conf) before sending the pixel data
-static const uint8_t magic[] = { 'A', 'd', 'a' };
-uint8_t hi, lo, checksum;
+//the third byte is 'a' for Adalight frames or 'x' for extended frames
+static const uint8_t magic[] = { 'A', 'd' };
+uint8_t type, hi, lo, flags, checksum;
 uint16_t i;
+uint8_t buffer[4];
 unsigned long lastReceiveTime = 0;
 
+//extended protocol
+#define ADX_CAPABILITIES "7" //delta coding (1), reduced color (2) and acknowledging frames (4)
+#define ADX_KEYFRAME 0x01 //frame is decoded against black instead of the previous frame
+#define ADX_REDUCED_COLOR 0x02 //pairs of LEDs are sent as luma and shared chroma
+
 //LED strip setup
 #define CALIBRATION_TEMPERATURE TypicalLEDStrip
 #define MAX_BRIGHTNESS 255 // 0-255
@@ -47,6 +58,7 @@ void setup()
         //open serial port
         Serial.begin(SERIALRATE);
 	Serial.print("Ada\n");
+	Serial.print("Adx" ADX_CAPABILITIES "\n");
 }
 
 void loop() {
@@ -61,6 +73,18 @@ void loop() {
 		// otherwise, wait for first byte again...
 		i = 0;
 	}
+	//read frame type
+	if (waitForBytes(1) == false) {
+		return;
+	}
+	type = Serial.read();
+	if (type == 'x') {
+		readExtendedFrame();
+		return;
+	}
+	if (type != 'a') {
+		return;
+	}
 	//read count high and low byte and checksum
 	if (waitForBytes(3) == false) {
             return;
@@ -82,8 +106,9 @@ void loop() {
 		Serial.readBytes((uint8_t*)(&leds[i]), 45);
                 i += 15;
 	}
-	// shows new values
+	// shows new values and tell the host we're ready for the next frame
 	FastLED.show();
+	Serial.print("Adr\n");
 	//If you have problems, try one of these two:
 	//#1 - short delay to make sure that if buffer is overrun, no corrupted data is shown
 	//delayMicroseconds(200);
@@ -105,8 +130,116 @@ boolean waitForBytes(int numberOfBytes)
 			FastLED.show();
 			//Send standard identifier string to host
 			Serial.print("Ada\n");
+			Serial.print("Adx" ADX_CAPABILITIES "\n");
 			return false;
 		}
 	}
 	return true;
 }
+
+void readExtendedFrame()
+{
+	//read count high and low byte, flags and checksum
+	if (waitForBytes(4) == false) {
+		return;
+	}
+	hi = Serial.read();
+	lo = Serial.read();
+	flags = Serial.read();
+	checksum = Serial.read();
+	if (checksum != (hi ^ lo ^ flags ^ 0x55)) {
+		return;
+	}
+	const uint16_t count = ((uint16_t)hi << 8) | lo;
+	//key frames start from black, other frames change the LEDs shown
+	if (flags & ADX_KEYFRAME) {
+		memset(leds, 0, NUM_LEDS * sizeof(struct CRGB));
+	}
+	//read runs of unchanged and changed LEDs
+	uint16_t led = 0;
+	while (led < count) {
+		if (waitForBytes(1) == false) {
+			return;
+		}
+		const uint8_t control = Serial.read();
+		uint8_t length = (control & 0x7F) + 1;
+		if (control & 0x80) {
+			led += length;
+			continue;
+		}
+		if (flags & ADX_REDUCED_COLOR) {
+			//pairs of LEDs are sent as Y0, Y1, Co, Cg, a single LED as Y, Co, Cg
+			for (; length >= 2; length -= 2, led += 2) {
+				if (waitForBytes(4) == false) {
+					return;
+				}
+				Serial.readBytes(buffer, 4);
+				setLumaChroma(led, buffer[0], buffer[2], buffer[3]);
+				setLumaChroma(led + 1, buffer[1], buffer[2], buffer[3]);
+			}
+			if (length == 1) {
+				if (waitForBytes(3) == false) {
+					return;
+				}
+				Serial.readBytes(buffer, 3);
+				setLumaChroma(led++, buffer[0], buffer[1], buffer[2]);
+			}
+		}
+		else {
+			for (; length > 0; --length, ++led) {
+				if (waitForBytes(3) == false) {
+					return;
+				}
+				Serial.readBytes(buffer, 3);
+				if (led < NUM_LEDS) {
+					memcpy(&leds[led], buffer, 3);
+				}
+			}
+		}
+	}
+	//compare the checksum of the LEDs with the one of the host. if it differs, frames were lost and we need a key frame
+	if (waitForBytes(2) == false) {
+		return;
+	}
+	hi = Serial.read();
+	lo = Serial.read();
+	if (count <= NUM_LEDS && (((uint16_t)hi << 8) | lo) != ledChecksum(count)) {
+		Serial.print("Adk\n");
+	}
+	FastLED.show();
+	Serial.print("Adr\n");
+}
+
+//decode YCoCg-R luma and quantized chroma. channels are in the order G, R, B NerDisco sends them in
+void setLumaChroma(uint16_t led, uint8_t y, uint8_t co, uint8_t cg)
+{
+	if (led >= NUM_LEDS) {
+		return;
+	}
+	const int16_t coValue = (int16_t)co * 2 - 256;
+	const int16_t cgValue = (int16_t)cg * 2 - 256;
+	const int16_t t = y - (cgValue >> 1);
+	const int16_t b = t - (coValue >> 1);
+	uint8_t * color = (uint8_t *)&leds[led];
+	color[0] = clampColor(cgValue + t);
+	color[1] = clampColor(b + coValue);
+	color[2] = clampColor(b);
+}
+
+uint8_t clampColor(int16_t value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+//Fletcher-style checksum modulo 256 over the LED colors
+uint16_t ledChecksum(uint16_t count)
+{
+	const uint8_t * data = (const uint8_t *)leds;
+	uint8_t sum1 = 0;
+	uint8_t sum2 = 0;
+	for (uint16_t j = 0; j < count * 3; ++j) {
+		sum1 += data[j];
+		sum2 += sum1;
+	}
+	return ((uint16_t)sum2 << 8) | sum1;
+}
@@ -0,0 +1,216 @@
+#include "AudioFeatures.h"
+
+#include <QOpenGLContext>
+#include <QRegExp>
+#include <QStringList>
+#include <QVector2D>
+#include <cmath>
+#include <algorithm>
+
+
+//time for the beat value to decay to 1/e in s
+static const float BeatDecay = 0.15f;
+//shortest time between two beats in s, which is 400 bpm
+static const float MinimumBeatInterval = 0.15f;
+//how many standard deviations the onset strength has to be above its mean for a beat
+static const float BeatThreshold = 1.5f;
+//weight of a new block in the running onset statistics
+static const float OnsetAdaption = 0.05f;
+
+//names of the features in the script comment and of their uniforms, indexed by the bit of the feature
+static const char * FeatureNames[6] = {"spectrum", "bass", "mid", "treble", "beat", "onset"};
+static const char * UniformNames[6] = {"audioSpectrum", "audioBass", "audioMid", "audioTreble", "audioBeat", "audioOnset"};
+
+static int featureIndex(AudioFeatures::Feature feature)
+{
+	int index = 0;
+	while (index < 6 && !((int)feature & (1 << index)))
+	{
+		++index;
+	}
+	return index;
+}
+
+std::mutex AudioFeatures::s_mutex;
+
+AudioFeatures::SPtr & AudioFeatures::getInstance()
+{
+	static AudioFeatures::SPtr s_instance = nullptr;
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_instance)
+	{
+		s_instance.reset(new AudioFeatures());
+	}
+	return s_instance;
+}
+
+AudioFeatures::AudioFeatures()
+	: m_bandCount(0)
+	, m_historyStart(0)
+	, m_bass(0.0f)
+	, m_mid(0.0f)
+	, m_treble(0.0f)
+	, m_onset(0.0f)
+	, m_onsetMean(0.0f)
+	, m_onsetVariance(0.0f)
+	, m_lastBeat(-1)
+	, m_blockTime(0)
+	, m_blockFrameTime(0)
+	, m_version(0)
+	, m_frameVersion(0)
+	, m_uploadedVersion(0)
+	, m_texture(0)
+{
+	std::fill(m_frameValues, m_frameValues + 6, 0.0f);
+}
+
+int AudioFeatures::parseFeatures(const QString & script)
+{
+	//same format as the other script variables, e.g. "//audio=spectrum,beat"
+	QRegExp audioExp("^//audio\\s*=\\s*(\\S+)\\s*$");
+	int features = None;
+	const QStringList lines = script.split(QChar::LineFeed);
+	for (auto line : lines)
+	{
+		if (audioExp.indexIn(line.trimmed()) >= 0)
+		{
+			const QStringList names = audioExp.cap(1).split(',', QString::SkipEmptyParts);
+			for (auto name : names)
+			{
+				for (int i = 0; i < 6; ++i)
+				{
+					if (name.trimmed().compare(FeatureNames[i], Qt::CaseInsensitive) == 0)
+					{
+						features |= 1 << i;
+					}
+				}
+			}
+		}
+	}
+	return features;
+}
+
+void AudioFeatures::addSpectrum(const QVector<float> & bands, int64_t timestamp)
+{
+	if (bands.isEmpty())
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	//a new stream starts at time 0 again
+	if (timestamp < m_blockTime)
+	{
+		m_lastBeat = -1;
+	}
+	m_blockTime = timestamp;
+	//start over if the analysis changed
+	if (bands.size() != m_bandCount)
+	{
+		m_bandCount = bands.size();
+		m_history.assign(m_bandCount * HistoryLength, 0.0f);
+		m_historyStart = 0;
+		m_previousBands.assign(m_bandCount, 0.0f);
+		m_onsetMean = 0.0f;
+		m_onsetVariance = 0.0f;
+	}
+	m_historyStart = (m_historyStart + HistoryLength - 1) % HistoryLength;
+	float * block = m_history.data() + m_historyStart * m_bandCount;
+	//energy of the low, middle and high thirds of the octave bands, e.g. <125Hz, <2kHz and above for 11 bands
+	const int midStart = std::max((m_bandCount * 4) / 11, 1);
+	const int trebleStart = std::max((m_bandCount * 8) / 11, midStart);
+	float sums[3] = {0.0f, 0.0f, 0.0f};
+	float flux = 0.0f;
+	for (int i = 0; i < m_bandCount; ++i)
+	{
+		const float value = std::max(0.0f, std::min(1.0f, bands.at(i)));
+		block[i] = value;
+		sums[i < midStart ? 0 : (i < trebleStart ? 1 : 2)] += value;
+		//onset strength is the spectral flux. only rising bands count
+		flux += std::max(0.0f, value - m_previousBands[i]);
+		m_previousBands[i] = value;
+	}
+	m_bass = sums[0] / midStart;
+	m_mid = trebleStart > midStart ? sums[1] / (trebleStart - midStart) : 0.0f;
+	m_treble = m_bandCount > trebleStart ? sums[2] / (m_bandCount - trebleStart) : 0.0f;
+	m_onset = flux / m_bandCount;
+	//a beat is an onset well above the recent average
+	const float deviation = m_onset - m_onsetMean;
+	const bool isBeat = deviation > BeatThreshold * std::sqrt(m_onsetVariance) && (m_lastBeat < 0 || (timestamp - m_lastBeat) / 1.0e9f >= MinimumBeatInterval);
+	if (isBeat)
+	{
+		m_lastBeat = timestamp;
+	}
+	m_onsetMean += OnsetAdaption * deviation;
+	m_onsetVariance = (1.0f - OnsetAdaption) * (m_onsetVariance + OnsetAdaption * deviation * deviation);
+	++m_version;
+}
+
+void AudioFeatures::update(int64_t timestamp)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_frameValues[featureIndex(Bass)] = m_bass;
+	m_frameValues[featureIndex(Mid)] = m_mid;
+	m_frameValues[featureIndex(Treble)] = m_treble;
+	m_frameValues[featureIndex(Onset)] = m_onset;
+	//build the texture once per frame, no matter how many blocks arrived
+	if (m_frameVersion != m_version)
+	{
+		m_blockFrameTime = timestamp;
+		m_textureData.resize(m_bandCount * HistoryLength);
+		for (int row = 0; row < HistoryLength; ++row)
+		{
+			const float * block = m_history.data() + ((m_historyStart + row) % HistoryLength) * m_bandCount;
+			unsigned char * dest = m_textureData.data() + row * m_bandCount;
+			for (int i = 0; i < m_bandCount; ++i)
+			{
+				dest[i] = (unsigned char)(block[i] * 255.0f + 0.5f);
+			}
+		}
+		m_frameVersion = m_version;
+	}
+	//the beat decays in audio time. between blocks audio time is advanced with the frame time
+	const int64_t audioTime = m_blockTime + std::max<int64_t>(timestamp - m_blockFrameTime, 0);
+	m_frameValues[featureIndex(Beat)] = m_lastBeat < 0 ? 0.0f : std::exp(-std::max((audioTime - m_lastBeat) / 1.0e9f, 0.0f) / BeatDecay);
+}
+
+float AudioFeatures::value(Feature feature) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_frameValues[featureIndex(feature)];
+}
+
+void AudioFeatures::setUniforms(QOpenGLShaderProgram * program, int features)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (features & Spectrum)
+	{
+		QOpenGLFunctions * functions = QOpenGLContext::currentContext()->functions();
+		functions->glActiveTexture(GL_TEXTURE0);
+		if (!m_texture)
+		{
+			functions->glGenTextures(1, &m_texture);
+			functions->glBindTexture(GL_TEXTURE_2D, m_texture);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		functions->glBindTexture(GL_TEXTURE_2D, m_texture);
+		//the first deck rendering in a frame uploads the texture, the other one finds it up to date
+		if (m_uploadedVersion != m_frameVersion && !m_textureData.empty())
+		{
+			functions->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			functions->glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, m_bandCount, HistoryLength, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, m_textureData.data());
+			m_uploadedVersion = m_frameVersion;
+		}
+		program->setUniformValue(UniformNames[0], 0);
+		program->setUniformValue("audioSpectrumSize", QVector2D(m_bandCount, HistoryLength));
+	}
+	for (int i = 1; i < 6; ++i)
+	{
+		if (features & (1 << i))
+		{
+			program->setUniformValue(UniformNames[i], m_frameValues[i]);
+		}
+	}
+}
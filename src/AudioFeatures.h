@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include <QString>
+#include <QVector>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+
+
+/// @brief Turns the spectrum of the audio analysis into values effect scripts can use.
+/// Keeps a history of the spectrum bands and derives bass, mid and treble energy, onset strength and beats from it.
+/// The history is stored in a texture with one column per band and one row per analysis block, newest first.
+/// All OpenGL contexts share resources, so the texture is uploaded at most once per frame for all decks.
+/// Scripts select the features they use with a comment like "//audio=spectrum,bass,beat" and declare their uniforms.
+/// Only those features are set, so effects that don't use audio cost nothing.
+class AudioFeatures
+{
+public:
+	/// brief Shared pointer of AudioFeatures object.
+	typedef std::shared_ptr<AudioFeatures> SPtr;
+
+	enum Feature {
+		None = 0,
+		Spectrum = 0x01, ///< sampler2D audioSpectrum: x is the band, y the age. vec2 audioSpectrumSize: bands and history length.
+		Bass = 0x02, ///< float audioBass: energy of the low bands in [0,1].
+		Mid = 0x04, ///< float audioMid: energy of the middle bands in [0,1].
+		Treble = 0x08, ///< float audioTreble: energy of the high bands in [0,1].
+		Beat = 0x10, ///< float audioBeat: 1 on a beat, decaying to 0 until the next one.
+		Onset = 0x20 ///< float audioOnset: how much the spectrum rose since the last block in [0,1].
+	};
+
+	/// @brief Number of analysis blocks kept in the spectrum history.
+	static const int HistoryLength = 64;
+
+	/// @brief Retrieve or create the instance of the audio features.
+	static SPtr & getInstance();
+
+	/// @brief Parse the "//audio=" comment of a script.
+	/// @return Combination of Feature flags used by the script.
+	static int parseFeatures(const QString & script);
+	/// @brief Add the spectrum of an analysis block.
+	/// @param bands Band values in [0,1], lowest frequency first.
+	/// @param timestamp Audio time of the end of the block in nanoseconds since the stream started.
+	/// Beats are detected in audio time, so they are the same no matter when or how fast the blocks arrive.
+	void addSpectrum(const QVector<float> & bands, int64_t timestamp);
+
+	/// @brief Update the values passed to the scripts. Call once per rendered frame.
+	/// The newest block is taken as current when it is first seen here, and the audio time advances with the frame time from there.
+	/// @param timestamp Frame time in nanoseconds.
+	void update(int64_t timestamp);
+
+	/// @brief Retrieve the value of a scalar feature for the current frame.
+	float value(Feature feature) const;
+
+	/// @brief Set the uniforms for a combination of features in a bound shader program.
+	/// Binds the spectrum texture to texture unit 0, uploading it first if it changed since the last upload.
+	/// @note Call with an OpenGL context current.
+	void setUniforms(QOpenGLShaderProgram * program, int features);
+
+private:
+	AudioFeatures();
+	AudioFeatures(AudioFeatures & af);
+	AudioFeatures & operator=(const AudioFeatures & af);
+
+	static std::mutex s_mutex;
+
+	mutable std::mutex m_mutex;
+	int m_bandCount;
+	//spectrum history as ring buffer of m_bandCount values per block
+	std::vector<float> m_history;
+	int m_historyStart; //index of the newest block
+	std::vector<float> m_previousBands;
+	//values derived from the newest block
+	float m_bass;
+	float m_mid;
+	float m_treble;
+	float m_onset;
+	//running mean and variance of the onset strength for an adaptive beat threshold
+	float m_onsetMean;
+	float m_onsetVariance;
+	int64_t m_lastBeat; //audio time of the last beat in ns or -1 before the first one
+	int64_t m_blockTime; //audio time of the newest block in ns
+	int64_t m_blockFrameTime; //frame time the newest block was first used in ns
+	//values for the current frame, indexed by the bit of the feature
+	float m_frameValues[6];
+	//texture data for the current frame, newest block in the first row
+	std::vector<unsigned char> m_textureData;
+	uint64_t m_version; //incremented with every added block
+	uint64_t m_frameVersion; //version the texture data was built from
+	uint64_t m_uploadedVersion; //version in the texture
+	GLuint m_texture;
+};
@@ -1,22 +1,30 @@
 #include "AudioInterface.h"
+#include "DeviceAudioSource.h"
+#include "FileAudioSource.h"
+#ifdef WITH_JACK
+	#include "JackAudioSource.h"
+#endif
 
 #include <QAudioDeviceInfo>
-#include <QBuffer>
 #include <QDebug>
 
 
+//capture device names starting with this are file sources
+static const QString FileSourcePrefix = "file:";
+
+
 AudioInterface::AudioInterface(QObject *parent)
 	: QObject(parent)
 	, m_conversionWorker(new ConversionWorker())
 	, m_processingWorker(new ProcessingWorker())
-    , m_audioInput(NULL)
-    , m_inputDevice(NULL)
 	, captureDevice("captureDevice", "")
 	, capturing("capturing", false)
 	, captureInterval("captureInterval", 20, 10, 50)
+	, captureRealTime("captureRealTime", true)
 {
 	//register metatype so all signal/slot connections work
     qRegisterMetaType< QVector<float> >("QVector<float>");
+	qRegisterMetaType<QAudioFormat>("QAudioFormat");
 	//do all possible connections to worker objects
 	connect(&m_workerThread, &QThread::finished, m_conversionWorker, &QObject::deleteLater);
 	connect(&m_workerThread, &QThread::finished, m_processingWorker, &QObject::deleteLater);
@@ -24,12 +32,15 @@ AudioInterface::AudioInterface(QObject *parent)
 	connect(m_conversionWorker, SIGNAL(output(const QVector<float> &, int, float)), m_processingWorker, SLOT(input(const QVector<float> &, int, float)));
 	//connect returning signals
 	connect(m_processingWorker, SIGNAL(levelData(const QVector<float> &, float)), this, SIGNAL(levelData(const QVector<float> &, float)));
-	connect(m_processingWorker, SIGNAL(fftData(const QVector<float> &, int, float)), this, SIGNAL(fftData(const QVector<float> &, int, float)));
+	connect(m_processingWorker, SIGNAL(fftData(const QVector<float> &, int, float, qint64)), this, SIGNAL(fftData(const QVector<float> &, int, float, qint64)));
 	connect(m_processingWorker, SIGNAL(beatData(float, bool)), this, SIGNAL(beatData(float, bool)));
 	//connect parameters to internal slots
 	connect(captureDevice.GetSharedParameter().get(), SIGNAL(valueChanged(const QString &)), this, SLOT(setCaptureDevice(const QString &)));
 	connect(capturing.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(setCaptureState(bool)));
 	connect(captureInterval.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(setCaptureInterval(int)));
+	connect(captureRealTime.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(setCaptureRealTime(bool)));
+	connect(&m_statisticsTimer, SIGNAL(timeout()), this, SLOT(reportStatistics()));
+	m_statisticsTimer.start(1000);
 	//move worker objects to thread and run thread
 	m_conversionWorker->moveToThread(&m_workerThread);
 	m_processingWorker->moveToThread(&m_workerThread);
@@ -38,12 +49,9 @@ AudioInterface::AudioInterface(QObject *parent)
 
 AudioInterface::~AudioInterface()
 {
-    if (m_audioInput)
-    {
-        m_audioInput->stop();
-        delete m_audioInput;
-        delete m_inputDevice;
-    }
+	//stop the source before the workers, file sources might wait for them
+	delete m_source;
+	m_source = nullptr;
 	m_workerThread.quit();
 	m_workerThread.wait();
 }
@@ -60,6 +68,7 @@ void AudioInterface::toXML(QDomElement & parent) const
 	}
 	captureDevice.toXML(element);
 	captureInterval.toXML(element);
+	captureRealTime.toXML(element);
 }
 
 AudioInterface & AudioInterface::fromXML(const QDomElement & parent)
@@ -72,14 +81,33 @@ AudioInterface & AudioInterface::fromXML(const QDomElement & parent)
 	}
 	//read device name from element
 	capturing = false;
-	captureDevice.fromXML(element);
 	captureInterval.fromXML(element);
+	//older settings have no pacing for file sources
+	try
+	{
+		captureRealTime.fromXML(element);
+	}
+	catch (const std::runtime_error &)
+	{
+		captureRealTime = true;
+	}
+	captureDevice.fromXML(element);
 	return *this;
 }
 
-void AudioInterface::inputStateChanged(QAudio::State state)
+QString AudioInterface::fileSourceName(const QString & fileName)
+{
+	return FileSourcePrefix + fileName;
+}
+
+bool AudioInterface::isFileSource(const QString & deviceName)
 {
-	capturing = (state == QAudio::ActiveState /* || state == QAudio::IdleState*/);
+	return deviceName.startsWith(FileSourcePrefix);
+}
+
+void AudioInterface::sourceActiveChanged(bool active)
+{
+	capturing = active;
 }
 
 void AudioInterface::setCaptureState(bool on)
@@ -87,84 +115,78 @@ void AudioInterface::setCaptureState(bool on)
 	//check if we want to start or stop capturing
 	if (on)
 	{
-		if (m_audioInput)
+		if (m_source && !m_source->isActive())
 		{
-			//set up processing worker with current sample rate and bit depth
-			m_processingWorker->setSampleRate(m_sampleRate);
-			m_processingWorker->setBitDepth(m_bitDepth);
-			//create buffer receiving data
-			m_inputDevice = new QBuffer(this);
-			m_inputDevice->open(QIODevice::ReadWrite);
-			//connect(m_inputDevice, SIGNAL(readyRead()), this, SLOT(inputDataReady()));
-			m_audioInput->start(m_inputDevice);
-			//m_inputDevice = m_audioInput->start(); //DOES NOT WORK! Why. ever.
+			//set up processing worker with the sample rate and bit depth of the source
+			const QAudioFormat format = m_source->format();
+			m_processingWorker->setSampleRate(format.sampleRate());
+			//float samples have the precision of 24-bit integers
+			m_processingWorker->setBitDepth(format.sampleType() == QAudioFormat::Float ? 24 : format.sampleSize());
+			//the stream time starts over. queue this, so it runs after all blocks of the previous stream
+			QMetaObject::invokeMethod(m_processingWorker, "reset", Qt::QueuedConnection);
+			if (!m_source->start())
+			{
+				capturing = false;
+			}
 		}
-		else
+		else if (!m_source)
 		{
 			capturing = false;
 		}
 	}
 	else
 	{
-		if (m_audioInput)
+		if (m_source)
 		{
-			m_audioInput->stop();
-			m_inputDevice->close();
-			m_inputDevice->disconnect(this);
-			delete m_inputDevice;
-			m_inputDevice = NULL;
-			capturing = false;
+			m_source->stop();
 		}
+		capturing = false;
 	}
 }
 
 void AudioInterface::setCaptureDevice(const QString & inputName)
 {
-	//if the current device is running, stop it
-	if (m_audioInput && m_audioInput->state() == QAudio::ActiveState)
+	//stop and remove the current source
+	if (m_source)
 	{
-		m_audioInput->stop();
-		m_audioInput->disconnect(this);
-		delete m_audioInput;
-		m_audioInput = NULL;
-		m_inputDevice->disconnect(this);
-		delete m_inputDevice;
-		m_inputDevice = NULL;
+		m_source->disconnect(this);
+		delete m_source;
+		m_source = nullptr;
 		capturing = false;
 	}
-	//if we've got a device name, try to find the device
-	if (!inputName.isEmpty())
+	if (isFileSource(inputName))
+	{
+		//file sources deliver from their own thread. wait for the analysis, so reading as fast as possible can't flood it
+		m_source = new FileAudioSource(inputName.mid(FileSourcePrefix.size()), m_sampleRate, captureInterval, captureRealTime, this);
+		connect(m_source, SIGNAL(dataReady(const QByteArray &, const QAudioFormat &)), m_conversionWorker, SLOT(input(const QByteArray &, const QAudioFormat &)), Qt::BlockingQueuedConnection);
+	}
+#ifdef WITH_JACK
+	else if (inputName == JackAudioSource::DeviceName)
+	{
+		//blocks are collected from the JACK ring in a thread of the source, so waiting for the analysis can't stall JACK
+		m_source = new JackAudioSource(this);
+		connect(m_source, SIGNAL(dataReady(const QByteArray &, const QAudioFormat &)), m_conversionWorker, SLOT(input(const QByteArray &, const QAudioFormat &)), Qt::BlockingQueuedConnection);
+	}
+#endif
+	else if (!inputName.isEmpty())
 	{
 		//find device for name
 		foreach(const QAudioDeviceInfo & info, QAudioDeviceInfo::availableDevices(QAudio::AudioInput))
 		{
 			if (info.deviceName() == inputName)
 			{
-				//device found. create capture format
-				QAudioFormat format;
-				format.setSampleRate(m_sampleRate);
-				format.setChannelCount(1);
-				format.setSampleSize(m_bitDepth);
-				format.setCodec("audio/pcm");
-				format.setByteOrder(QAudioFormat::LittleEndian);
-				format.setSampleType(QAudioFormat::UnSignedInt);
-				if (!info.isFormatSupported(format))
-				{
-					//format not supported, try something similar
-					format = info.nearestFormat(format);
-				}
-				//create audio input
-				m_audioInput = new QAudioInput(info, format, this);
-				m_audioInput->setNotifyInterval(captureInterval);
-				//allocate audio buffer sized twice the capture interval
-				m_audioInput->setBufferSize(m_audioInput->format().bytesForDuration(1000 * 2 * captureInterval));
-				connect(m_audioInput, SIGNAL(notify()), this, SLOT(inputDataReady()));
-				connect(m_audioInput, SIGNAL(stateChanged(QAudio::State)), this, SLOT(inputStateChanged(QAudio::State)));
-				captureDevice = inputName;
+				m_source = new DeviceAudioSource(info, m_sampleRate, m_bitDepth, captureInterval, this);
+				connect(m_source, SIGNAL(dataReady(const QByteArray &, const QAudioFormat &)), m_conversionWorker, SLOT(input(const QByteArray &, const QAudioFormat &)), Qt::QueuedConnection);
 				break;
 			}
 		}
 	}
+	m_reportedFrames = 0;
+	if (m_source)
+	{
+		connect(m_source, SIGNAL(activeChanged(bool)), this, SLOT(sourceActiveChanged(bool)));
+		captureDevice = inputName;
+	}
 	else
 	{
 		captureDevice = "";
@@ -173,32 +195,32 @@ void AudioInterface::setCaptureDevice(const QString & inputName)
 
 void AudioInterface::setCaptureInterval(int interval)
 {
-	if (m_audioInput && m_inputDevice)
+	if (m_source)
 	{
-		const bool inputActive = m_audioInput && m_audioInput->state() == QAudio::ActiveState;
-		if (inputActive)
-		{
-			//if capturing stop input
-			m_audioInput->stop();
-			m_inputDevice->close();
-		}
-		//change callback interval and buffer size
-		m_audioInput->setNotifyInterval(interval);
-		m_audioInput->setBufferSize(m_audioInput->format().bytesForDuration(1000 * 2 * interval));
-		if (inputActive)
-		{
-			//if capturing, restart input
-			m_inputDevice->open(QIODevice::ReadWrite);
-			m_audioInput->start(m_inputDevice);
-		}
+		m_source->setInterval(interval);
 	}
-	else if (m_audioInput)
+	captureInterval = interval;
+}
+
+void AudioInterface::setCaptureRealTime(bool realTime)
+{
+	FileAudioSource * fileSource = qobject_cast<FileAudioSource *>(m_source);
+	if (fileSource)
 	{
-		//change callback interval and buffer size
-		m_audioInput->setNotifyInterval(interval);
-		m_audioInput->setBufferSize(m_audioInput->format().bytesForDuration(1000 * 2 * interval));
+		fileSource->setRealTime(realTime);
+	}
+	captureRealTime = realTime;
+}
+
+void AudioInterface::reportStatistics()
+{
+	if (m_source && m_source->isActive())
+	{
+		//every captured frame is either delivered or counted as lost, so lost frames are the gaps in the analyzed audio
+		const qint64 delivered = m_source->deliveredFrames();
+		emit statistics(tr("Audio frames/s %1, lost %2 in %3 gaps since start").arg(delivered - m_reportedFrames).arg(m_source->lostFrames()).arg(m_source->discontinuities()));
+		m_reportedFrames = delivered;
 	}
-	captureInterval = interval;
 }
 
 QStringList AudioInterface::inputDeviceNames()
@@ -208,6 +230,9 @@ QStringList AudioInterface::inputDeviceNames()
 	{
 		deviceNames.append(deviceInfo.deviceName());
 	}
+#ifdef WITH_JACK
+	deviceNames.append(JackAudioSource::DeviceName);
+#endif
 	return deviceNames;
 }
 
@@ -230,20 +255,3 @@ QString AudioInterface::defaultOutputDeviceName()
 {
 	return QAudioDeviceInfo::defaultOutputDevice().deviceName();
 }
-
-void AudioInterface::inputDataReady()
-{
-	if (m_inputDevice)
-	{
-		//seek to start of buffer
-		m_inputDevice->seek(0);
-		//check if we have data to process
-		if (m_inputDevice->bytesAvailable() > 0)
-		{
-			//send data to worker thread for processing
-			QMetaObject::invokeMethod(m_conversionWorker, "input", Q_ARG(const QByteArray &, m_inputDevice->readAll()), Q_ARG(const QAudioFormat &, m_audioInput->format()));
-			//emit output(m_inputDevice->readAll(), m_audioInput->format());
-		}
-		m_inputDevice->reset();
-	}
-}
@@ -2,12 +2,12 @@
 
 #include "AudioConversion.h"
 #include "AudioProcessing.h"
+#include "AudioSource.h"
 #include "Parameters.h"
 
 #include <QVector>
-#include <QAudio>
-#include <QAudioInput>
 #include <QThread>
+#include <QTimer>
 #include <QDomDocument>
 
 
@@ -26,9 +26,18 @@ public:
 	/// @param parent The parent element to load the settings from.
 	AudioInterface & fromXML(const QDomElement & parent);
 
+	/// @brief Name of the capture device or a file source name, see fileSourceName().
 	ParameterQString captureDevice;
 	ParameterBool capturing;
 	ParameterInt captureInterval;
+	/// @brief If true, file sources are played in real time, else as fast as the analysis can take them.
+	ParameterBool captureRealTime;
+
+	/// @brief Retrieve the capture device name for playing a WAVE file or reading raw PCM from a file or pipe.
+	/// @note See FileAudioSource for the formats read.
+	static QString fileSourceName(const QString & fileName);
+	/// @brief Check if a capture device name is a file source.
+	static bool isFileSource(const QString & deviceName);
 
 	static QStringList inputDeviceNames();
 	static QString defaultInputDeviceName();
@@ -40,24 +49,29 @@ signals:
 	//Delivers audio levels for each channel.
 	void levelData(const QVector<float> & levels, float timeus);
 	//Delivers the FFT of the current audio data.
-	void fftData(const QVector<float> & spectrum, int channels, float timeus);
+	//streamTime is the audio time of the end of the analyzed block in ns since capturing started.
+	void fftData(const QVector<float> & spectrum, int channels, float timeus, qint64 streamTime);
 	//Delivers beat information for the beat detection.
 	void beatData(float bpm, bool isBeat);
+	//Delivers the capture statistics once per second while capturing.
+	void statistics(const QString & message);
 
 protected slots:
 	void setCaptureDevice(const QString & inputName);
 	void setCaptureState(bool capturing);
 	void setCaptureInterval(int interval);
+	void setCaptureRealTime(bool realTime);
 
-	void inputDataReady();
-	void inputStateChanged(QAudio::State state);
+	void sourceActiveChanged(bool active);
+	void reportStatistics();
 
 private:
 	ConversionWorker * m_conversionWorker = nullptr;
 	ProcessingWorker * m_processingWorker = nullptr;
 	QThread m_workerThread;
-	QAudioInput * m_audioInput = nullptr;
-	QIODevice * m_inputDevice = nullptr;
+	AudioSource * m_source = nullptr;
+	QTimer m_statisticsTimer;
+	qint64 m_reportedFrames = 0; //frames delivered by the source at the last report
 	int m_sampleRate = 44100;
 	int m_bitDepth = 16;
 };
@@ -6,9 +6,6 @@
 #include <QDebug>
 #include <math.h>
 
-static QVector<float> debugSignal;
-static int debugSignalSize = 0;
-
 
 ProcessingWorker::ProcessingWorker(int sampleRate, int bitDepth, QObject *parent)
 	: QObject(parent)
@@ -78,14 +75,6 @@ void ProcessingWorker::UpdateKissConfig()
 			m_spectrum.resize(m_fftBinSize);
 			//calculate new window coefficients
 			UpdateWindowCoefficients();
-			//build debug periodic signal
-			debugSignal.resize(m_fftWindowSize * 1.5f);
-			for (int i = 0; i < debugSignal.size(); ++i)
-			{
-				float p = i / (m_sampleRate / 4000.0f);
-				float value = std::sin(2.0f * 3.1415926f * p);
-				debugSignal[i] = value;
-			}
 		}
 		m_kissConfigChanged = false;
 	}
@@ -124,8 +113,15 @@ void ProcessingWorker::enableFFTData(bool enable)
 	m_doFFT = enable;
 }
 
+void ProcessingWorker::reset()
+{
+	m_data.clear();
+	m_streamSamples = 0;
+}
+
 void ProcessingWorker::input(const QVector<float> & data, int channels, float timeus)
 {
+	m_streamSamples += data.size();
 	if (m_doLevels)
 	{
 		QVector<float> levels = getMaximumLevels(data, channels);
@@ -140,7 +136,7 @@ void ProcessingWorker::input(const QVector<float> & data, int channels, float ti
 		m_spectrum.fill(0.0f);
 		float * spectrumData = m_spectrum.data();
 		//we might have data left from last frame, append the new data to it
-		m_data += debugSignal.mid(0, data.size());//data;
+		m_data += data;
 		const int nrOfSamples = m_data.size(); //# of samples left to process
 		//check if we have sufficient samples to do an FFT
 		if (nrOfSamples >= m_fftWindowSize)
@@ -176,6 +172,9 @@ void ProcessingWorker::input(const QVector<float> & data, int channels, float ti
 			{
 				spectrumData[i] /= nrOfDataChunks;
 			}
+			//the last window ended one overlap after the next start. count the stream time from the samples, not the clock
+			const qint64 windowEnd = m_streamSamples - nrOfSamples + startSample + m_fftWindowOverlap;
+			const qint64 streamTime = windowEnd / channels * 1000000000LL / m_sampleRate;
 			//store remaining samples for next frame, remove the ones we've processed already
 			m_data.remove(0, startSample);
 			//m_data.clear();
@@ -185,7 +184,7 @@ void ProcessingWorker::input(const QVector<float> & data, int channels, float ti
 			//normalize the values by dividing by the SQNR value for the signal bit depth
 			normalizeValuesSQNR(octaveBands.data(), octaveBands.constData(), octaveBands.size(), m_Sqnr);
 			//qDebug() << octaveBands;
-			emit fftData(octaveBands, channels, timeus);
+			emit fftData(octaveBands, channels, timeus, streamTime);
 			//if (m_doBeatDetection)
 			//{
 			//	//reduce spectrum to half the channels and calculate average volume of low frequencies
@@ -35,7 +35,9 @@ signals:
 	/// @brief Delivers audio levels for each channel.
 	void levelData(const QVector<float> & levels, float timeus);
 	/// @brief Delivers the FFT of the current audio data.
-	void fftData(const QVector<float> & spectrum, int channels, float timeus);
+	/// @param streamTime Time of the end of the analyzed audio in ns since the stream started. This is audio time,
+	/// so it does not depend on when or how fast the audio was delivered.
+	void fftData(const QVector<float> & spectrum, int channels, float timeus, qint64 streamTime);
 	/// @brief Delivers beat information for the beat detection.
 	void beatData(float bpm, bool isBeat);
 
@@ -43,6 +45,8 @@ signals:
 
 public slots:
 	void input(const QVector<float> & data, int channels, float timeus);
+	/// @brief Start a new stream. Drops samples not processed yet and starts the stream time at 0 again.
+	void reset();
 
 private:
 	/// @brief Update the window coefficients.
@@ -97,6 +101,8 @@ private:
 	float m_windowFunctionCoefficientSum = 0.0f;
 	/// @brief Keeps data for current frame. Keeps unprocessed samples remaining from last frame.
 	QVector<float> m_data;
+	/// @brief Number of samples received since the stream started, including the ones in m_data.
+	qint64 m_streamSamples = 0;
 	/// @brief Final spectrum results.
 	QVector<float> m_spectrum;
 	/// @brief Flag is true when the KissFFT configuration changed and needs to be updated.
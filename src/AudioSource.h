@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QAudioFormat>
+#include <atomic>
+
+
+/// @brief Base class of everything AudioInterface can capture from, e.g. sound cards, files or pipes.
+/// A source delivers blocks of raw samples in its format. The blocks are converted and analyzed by the
+/// ConversionWorker and ProcessingWorker, no matter where they come from.
+/// Sources count the frames they deliver and the frames they lose between capturing and delivering, so gaps in the
+/// analyzed audio show up in the statistics.
+class AudioSource : public QObject
+{
+	Q_OBJECT
+
+public:
+	AudioSource(QObject * parent = 0)
+		: QObject(parent)
+		, m_deliveredFrames(0)
+		, m_lostFrames(0)
+		, m_discontinuities(0)
+	{
+	}
+	virtual ~AudioSource() {}
+
+	/// @brief Retrieve the format of the blocks delivered.
+	virtual QAudioFormat format() const = 0;
+
+	/// @brief Start delivering blocks.
+	/// @return False if the source can not be started.
+	virtual bool start() = 0;
+	/// @brief Stop delivering blocks. No block is delivered after this returns.
+	virtual void stop() = 0;
+	/// @brief Check if the source is delivering blocks.
+	virtual bool isActive() const = 0;
+
+	/// @brief Set the time between two blocks in ms. Takes effect immediately, also while active.
+	virtual void setInterval(int interval) = 0;
+
+	/// @brief Retrieve the number of frames delivered since the source was created.
+	qint64 deliveredFrames() const { return m_deliveredFrames; }
+	/// @brief Retrieve the number of frames captured, but lost before they could be delivered, e.g. because a buffer was full.
+	qint64 lostFrames() const { return m_lostFrames; }
+	/// @brief Retrieve how often frames were lost, e.g. the number of gaps in the delivered audio.
+	qint64 discontinuities() const { return m_discontinuities; }
+
+signals:
+	/// @brief Delivers a block of samples. May be emitted from a thread other than the one the source lives in.
+	/// @param data Raw samples.
+	/// @param format Format of the samples.
+	void dataReady(const QByteArray & data, const QAudioFormat & format);
+	/// @brief Emitted when the source starts or stops, also when it stops by itself, e.g. on errors.
+	void activeChanged(bool active);
+
+protected:
+	/// @brief Count the frames of a block and emit dataReady(). Can be called from any thread.
+	void deliver(const QByteArray & data, const QAudioFormat & format)
+	{
+		m_deliveredFrames += format.framesForBytes(data.size());
+		emit dataReady(data, format);
+	}
+
+	/// @brief Count frames that were lost as one gap. Can be called from any thread, but not from real-time callbacks.
+	void loseFrames(qint64 frames)
+	{
+		if (frames > 0)
+		{
+			m_lostFrames += frames;
+			++m_discontinuities;
+		}
+	}
+
+private:
+	std::atomic<qint64> m_deliveredFrames;
+	std::atomic<qint64> m_lostFrames;
+	std::atomic<qint64> m_discontinuities;
+};
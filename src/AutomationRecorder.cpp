@@ -0,0 +1,324 @@
+#include "AutomationRecorder.h"
+
+#include "MIDIClock.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+AutomationRecorder::AutomationRecorder(QObject * parent)
+	: QObject(parent)
+	, loop("loop", true)
+	, m_state(Stopped)
+	, m_startTime(0)
+	, m_playbackTime(0)
+	, m_length(0)
+{
+}
+
+void AutomationRecorder::toXML(QDomElement & parent) const
+{
+	//try to find element in parent
+	QDomElement element = parent.firstChildElement("Automation");
+	if (element.isNull())
+	{
+		//add the new element
+		element = parent.ownerDocument().createElement("Automation");
+		parent.appendChild(element);
+	}
+	//remove old lanes
+	QDomElement child = element.firstChildElement("AutomationLane");
+	while (!child.isNull())
+	{
+		QDomElement next = child.nextSiblingElement("AutomationLane");
+		element.removeChild(child);
+		child = next;
+	}
+	element.setAttribute("length", (qlonglong)m_length);
+	loop.toXML(element);
+	foreach(const Lane & lane, m_lanes)
+	{
+		QDomElement laneElement = parent.ownerDocument().createElement("AutomationLane");
+		laneElement.setAttribute("name", lane.parameter->name());
+		laneElement.setAttribute("parent", lane.parentName);
+		laneElement.setAttribute("samples", lane.sampleCount);
+		laneElement.appendChild(parent.ownerDocument().createTextNode(QString::fromLatin1(lane.data.toBase64())));
+		element.appendChild(laneElement);
+	}
+}
+
+AutomationRecorder & AutomationRecorder::fromXML(const QDomElement & parent)
+{
+	//try to find element in document
+	QDomElement element = parent.firstChildElement("Automation");
+	clear();
+	if (element.isNull())
+	{
+		//no automation stored yet
+		return *this;
+	}
+	loop.fromXML(element);
+	m_length = std::max((qlonglong)0, element.attribute("length").toLongLong());
+	//find the registered parameter for every lane
+	for (QDomElement child = element.firstChildElement("AutomationLane"); !child.isNull(); child = child.nextSiblingElement("AutomationLane"))
+	{
+		for (auto parameter : m_parameters)
+		{
+			if (parameter.first->name() == child.attribute("name") && parameter.second == child.attribute("parent"))
+			{
+				Lane lane;
+				lane.parameter = parameter.first;
+				lane.parentName = parameter.second;
+				lane.stepped = parameter.first->valueType() == NodeRanged::Bool;
+				lane.data = QByteArray::fromBase64(child.text().toLatin1());
+				lane.sampleCount = child.attribute("samples").toInt();
+				lane.lastTime = 0;
+				lane.lastValue = 0;
+				rewind(lane);
+				m_laneIndices[lane.parameter.get()] = m_lanes.size();
+				m_lanes.append(lane);
+				break;
+			}
+		}
+	}
+	return *this;
+}
+
+void AutomationRecorder::setParameters(const QVector<QPair<NodeRanged::SPtr, QString>> & parameters)
+{
+	m_parameters = parameters;
+}
+
+void AutomationRecorder::record(int64_t timestamp)
+{
+	stopInternal(timestamp);
+	m_lanes.clear();
+	m_laneIndices.clear();
+	m_length = 0;
+	m_startTime = timestamp;
+	//add a lane with the current value as first sample for every parameter, so playback starts from the same state
+	for (auto parameter : m_parameters)
+	{
+		Lane lane;
+		lane.parameter = parameter.first;
+		lane.parentName = parameter.second;
+		lane.stepped = parameter.first->valueType() == NodeRanged::Bool;
+		lane.sampleCount = 0;
+		lane.lastTime = 0;
+		lane.lastValue = 0;
+		appendSample(lane, 0, parameter.first->normalizedValue());
+		m_laneIndices[lane.parameter.get()] = m_lanes.size();
+		m_lanes.append(lane);
+		connect(parameter.first.get(), SIGNAL(changed(NodeBase *)), this, SLOT(parameterChanged(NodeBase *)));
+	}
+	m_state = Recording;
+	emit stateChanged(m_state);
+}
+
+void AutomationRecorder::play(int64_t timestamp)
+{
+	stopInternal(timestamp);
+	if (!m_lanes.isEmpty() && m_length > 0)
+	{
+		m_startTime = timestamp;
+		m_playbackTime = 0;
+		for (int i = 0; i < m_lanes.size(); ++i)
+		{
+			rewind(m_lanes[i]);
+		}
+		m_state = Playing;
+	}
+	emit stateChanged(m_state);
+}
+
+void AutomationRecorder::stop(int64_t timestamp)
+{
+	stopInternal(timestamp);
+	emit stateChanged(m_state);
+}
+
+void AutomationRecorder::stopInternal(int64_t timestamp)
+{
+	if (m_state == Recording)
+	{
+		m_length = std::max((int64_t)0, (timestamp - m_startTime) / 1000);
+		//drop lanes of parameters that never changed, so they can still be controlled live while playing back
+		QVector<Lane> lanes;
+		m_laneIndices.clear();
+		foreach(const Lane & lane, m_lanes)
+		{
+			disconnect(lane.parameter.get(), SIGNAL(changed(NodeBase *)), this, SLOT(parameterChanged(NodeBase *)));
+			if (lane.sampleCount > 1)
+			{
+				m_laneIndices[lane.parameter.get()] = lanes.size();
+				lanes.append(lane);
+			}
+		}
+		m_lanes = lanes;
+	}
+	m_state = Stopped;
+}
+
+void AutomationRecorder::clear()
+{
+	stopInternal(MIDIClock::now());
+	m_lanes.clear();
+	m_laneIndices.clear();
+	m_length = 0;
+	emit stateChanged(m_state);
+}
+
+void AutomationRecorder::update(int64_t timestamp)
+{
+	if (m_state != Playing)
+	{
+		return;
+	}
+	int64_t time = std::max((int64_t)0, (timestamp - m_startTime) / 1000);
+	const bool finished = !loop && time >= m_length;
+	if (finished)
+	{
+		time = m_length;
+	}
+	else if (time >= m_length)
+	{
+		time %= m_length;
+	}
+	if (time < m_playbackTime)
+	{
+		//looped. start decoding the lanes from the beginning
+		for (int i = 0; i < m_lanes.size(); ++i)
+		{
+			rewind(m_lanes[i]);
+		}
+	}
+	m_playbackTime = time;
+	for (int i = 0; i < m_lanes.size(); ++i)
+	{
+		Lane & lane = m_lanes[i];
+		//advance until the next sample is in the future
+		while (lane.hasSample1 && lane.time1 <= time)
+		{
+			lane.time0 = lane.time1;
+			lane.value0 = lane.value1;
+			lane.hasSample0 = true;
+			lane.hasSample1 = readSample(lane, lane.time1, lane.value1);
+		}
+		if (!lane.hasSample0)
+		{
+			continue;
+		}
+		double value = lane.value0 / 65535.0;
+		if (!lane.stepped && lane.hasSample1 && lane.time1 > lane.time0)
+		{
+			const double t = (double)(time - lane.time0) / (double)(lane.time1 - lane.time0);
+			value += t * ((int)lane.value1 - (int)lane.value0) / 65535.0;
+		}
+		lane.parameter->setNormalizedValue(value);
+	}
+	if (finished)
+	{
+		stop(timestamp);
+	}
+}
+
+void AutomationRecorder::parameterChanged(NodeBase * parameter)
+{
+	if (m_state != Recording)
+	{
+		return;
+	}
+	auto index = m_laneIndices.find(parameter);
+	if (index != m_laneIndices.end())
+	{
+		Lane & lane = m_lanes[index.value()];
+		appendSample(lane, std::max((int64_t)0, (MIDIClock::now() - m_startTime) / 1000), lane.parameter->normalizedValue());
+	}
+}
+
+void AutomationRecorder::appendSample(Lane & lane, int64_t time, double normalizedValue)
+{
+	const uint16_t value = (uint16_t)std::round(std::max(0.0, std::min(1.0, normalizedValue)) * 65535.0);
+	if (lane.sampleCount > 0 && value == lane.lastValue)
+	{
+		return;
+	}
+	//time delta as variable-length integer with 7 bits per byte, lowest bits first
+	uint64_t delta = (uint64_t)std::max((int64_t)0, time - lane.lastTime);
+	do
+	{
+		const uint8_t byte = delta & 0x7F;
+		delta >>= 7;
+		lane.data.append((char)(delta ? (byte | 0x80) : byte));
+	} while (delta);
+	//value as little-endian 16-bit integer
+	lane.data.append((char)(value & 0xFF));
+	lane.data.append((char)(value >> 8));
+	lane.lastTime = time;
+	lane.lastValue = value;
+	++lane.sampleCount;
+}
+
+bool AutomationRecorder::readSample(Lane & lane, int64_t & time, uint16_t & value)
+{
+	const uint8_t * data = (const uint8_t *)lane.data.constData();
+	const int size = lane.data.size();
+	uint64_t delta = 0;
+	int shift = 0;
+	while (lane.readOffset < size && shift < 64)
+	{
+		const uint8_t byte = data[lane.readOffset++];
+		delta |= (uint64_t)(byte & 0x7F) << shift;
+		shift += 7;
+		if ((byte & 0x80) == 0)
+		{
+			if (lane.readOffset + 2 > size)
+			{
+				break;
+			}
+			value = data[lane.readOffset] | (data[lane.readOffset + 1] << 8);
+			lane.readOffset += 2;
+			time += (int64_t)delta;
+			return true;
+		}
+	}
+	//truncated or corrupt data
+	lane.readOffset = size;
+	return false;
+}
+
+void AutomationRecorder::rewind(Lane & lane)
+{
+	lane.readOffset = 0;
+	lane.hasSample0 = false;
+	lane.time0 = 0;
+	lane.value0 = 0;
+	lane.time1 = 0;
+	lane.value1 = 0;
+	lane.hasSample1 = readSample(lane, lane.time1, lane.value1);
+}
+
+AutomationRecorder::State AutomationRecorder::state() const
+{
+	return m_state;
+}
+
+double AutomationRecorder::length() const
+{
+	return m_length / 1.0e6;
+}
+
+int AutomationRecorder::laneCount() const
+{
+	return m_lanes.size();
+}
+
+int AutomationRecorder::dataSize() const
+{
+	int size = 0;
+	foreach(const Lane & lane, m_lanes)
+	{
+		size += lane.data.size();
+	}
+	return size;
+}
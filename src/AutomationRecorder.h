@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QByteArray>
+#include <QDomElement>
+#include <cstdint>
+
+#include "Parameters.h"
+
+
+/// @brief Records changes of a set of parameters and plays them back.
+/// Changes from MIDI controllers and the GUI are recorded alike, because both end up changing the parameter.
+/// Every parameter gets a lane of samples stored in a compact binary format: the time delta to the previous sample
+/// in microseconds as a variable-length integer, followed by the normalized value as 16-bit integer. Most samples need 4 bytes.
+/// Playback samples the lanes at the frame time and interpolates linearly between samples.
+/// Boolean parameters, e.g. triggers, are not interpolated, but step at the sample time.
+class AutomationRecorder : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum State {Stopped, Recording, Playing};
+
+	AutomationRecorder(QObject * parent = NULL);
+
+	/// @brief Save the recording to an XML document. The lanes are stored as base64-encoded binary data.
+	/// @param parent The parent to append the recording to.
+	void toXML(QDomElement & parent) const;
+	/// @brief Read the recording from an XML document. Lanes for parameters that are not registered are ignored.
+	/// @param parent The parent element to load the recording from.
+	/// @note this will throw std::runtime_error if no recording is found in the document.
+	AutomationRecorder & fromXML(const QDomElement & parent);
+
+	/// @brief Set the parameters that can be recorded and played back. Call before recording or loading a recording.
+	/// @param parameters Parameters and the names of their parents, which identify the parameters in XML.
+	void setParameters(const QVector<QPair<NodeRanged::SPtr, QString>> & parameters);
+
+	/// @brief Start recording. Replaces the current recording.
+	/// @param timestamp Start time in nanoseconds on the steady clock.
+	void record(int64_t timestamp);
+	/// @brief Start playing back the current recording from the beginning.
+	/// @param timestamp Start time in nanoseconds on the steady clock.
+	void play(int64_t timestamp);
+	/// @brief Stop recording or playback.
+	/// @param timestamp Stop time in nanoseconds on the steady clock. Sets the length of a recording.
+	void stop(int64_t timestamp);
+
+	/// @brief Apply the automated parameter values for a point in time. Call once per frame before propagating parameters.
+	/// @param timestamp Frame time in nanoseconds on the same clock passed to play().
+	void update(int64_t timestamp);
+
+	State state() const;
+	/// @brief Retrieve the length of the recording in seconds.
+	double length() const;
+	/// @brief Retrieve the number of lanes, e.g. parameters that changed during recording.
+	int laneCount() const;
+	/// @brief Retrieve the size of the binary lane data in bytes.
+	int dataSize() const;
+
+	/// @brief If true playback restarts at the beginning when reaching the end of the recording.
+	ParameterBool loop;
+
+public slots:
+	/// @brief Stop and remove the current recording.
+	void clear();
+
+signals:
+	/// @brief Emitted when recording or playback starts or stops.
+	void stateChanged(int state);
+
+private slots:
+	void parameterChanged(NodeBase * parameter);
+
+private:
+	struct Lane
+	{
+		NodeRanged::SPtr parameter;
+		QString parentName;
+		bool stepped;
+		QByteArray data;
+		int sampleCount;
+		//recording state
+		int64_t lastTime; //time of the last sample in us
+		uint16_t lastValue;
+		//playback state. samples before and after the current time
+		int readOffset;
+		bool hasSample0;
+		bool hasSample1;
+		int64_t time0;
+		int64_t time1;
+		uint16_t value0;
+		uint16_t value1;
+	};
+
+	/// @brief Append a sample to a lane if the value differs from the last sample.
+	static void appendSample(Lane & lane, int64_t time, double normalizedValue);
+	/// @brief Decode the next sample of a lane.
+	/// @param time Time of the previous sample in us. Receives the time of the next sample.
+	/// @return False if the end of the lane is reached.
+	static bool readSample(Lane & lane, int64_t & time, uint16_t & value);
+	/// @brief Move the playback position of a lane to its start.
+	static void rewind(Lane & lane);
+	/// @brief Stop without emitting stateChanged().
+	void stopInternal(int64_t timestamp);
+
+	QVector<QPair<NodeRanged::SPtr, QString>> m_parameters;
+	State m_state;
+	int64_t m_startTime; //start of recording or playback in ns
+	int64_t m_playbackTime; //last playback position in us
+	int64_t m_length; //length of the recording in us
+	QVector<Lane> m_lanes;
+	QHash<NodeBase *, int> m_laneIndices;
+};
@@ -1,10 +1,14 @@
 #include "Deck.h"
 #include "ui_Deck.h"
 #include "ParameterQtConnect.h"
+#include "ParameterSmoother.h"
+#include "EffectStatistics.h"
+#include "ScriptList.h"
+#include "DisplayImageConverter.h"
 
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QDirIterator>
+#include <QDir>
 
 
 Deck::Deck(QWidget *parent)
@@ -12,6 +16,9 @@ Deck::Deck(QWidget *parent)
 	, ui(new Ui::CodeDeck)
 	, m_codeEdit(new CodeEdit())
 	, m_scriptTime(QTime::currentTime())
+	, m_beatPhase(0.0f)
+	, m_bar(0)
+	, m_bpm(120.0f)
 	, m_scriptModified(false)
 	, m_commentExp("^//(\\w+)\\s*=\\s*(\\S+)$")
 	, m_errorExp("\\b(ERROR|Error|error)\\b:\\s?(\\d+):\\s?(\\d+):\\s?(.*)\\n")
@@ -21,6 +28,10 @@ Deck::Deck(QWidget *parent)
 	, asynchronousCompilation("asynchronousCompilation", false)
 	, frameBufferWidth("frameBufferWidth", 128, 32, 1024)
 	, frameBufferHeight("frameBufferHeight", 72, 32, 1024)
+	, renderAtDisplaySize("renderAtDisplaySize", false)
+	, displayWidth("displayWidth", 32, DisplayImageConverter::MinimumWidth, DisplayImageConverter::MaximumWidth)
+	, displayHeight("displayHeight", 18, DisplayImageConverter::MinimumHeight, DisplayImageConverter::MaximumHeight)
+	, superSampling("superSampling", 4, 1, 8)
 	, valueA("valueA", 0, 0, 100)
 	, valueB("valueB", 0, 0, 100)
 	, valueC("valueC", 0, 0, 100)
@@ -29,6 +40,7 @@ Deck::Deck(QWidget *parent)
 	, triggerB("triggerB", false)
 	, autoCycleScripts("autoCycleScripts", false)
 	, autoCycleInterval("autoCycleInterval", 15, 1, 120)
+	, frameBudget("frameBudget", 10, 1, 100)
 {
     ui->setupUi(this);
 	QVBoxLayout * deckLayout = (QVBoxLayout*)ui->groupBox->layout();
@@ -39,7 +51,8 @@ Deck::Deck(QWidget *parent)
     //insert live editor
 	QSurfaceFormat::setDefaultFormat(LiveView::getDefaultFormat());
 	m_liveView = new LiveView(this);
-	m_liveView->setRenderSize(frameBufferWidth, frameBufferHeight);
+	m_liveView->setPreviewSize(frameBufferWidth, frameBufferHeight);
+	updateRenderSize();
 	m_liveView->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
 	QHBoxLayout * centerLayout = new QHBoxLayout();
 	deckLayout->insertLayout(1, centerLayout);
@@ -56,6 +69,10 @@ Deck::Deck(QWidget *parent)
 	connect(asynchronousCompilation.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), m_liveView, SLOT(enableAsynchronousCompilation(bool)));
 	connect(frameBufferWidth.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(setFrameBufferWidth(int)));
 	connect(frameBufferHeight.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(setFrameBufferHeight(int)));
+	connect(renderAtDisplaySize.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(updateRenderSize()));
+	connect(displayWidth.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(updateRenderSize()));
+	connect(displayHeight.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(updateRenderSize()));
+	connect(superSampling.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(updateRenderSize()));
 	//connect parameters for script autocycling
 	connect(autoCycleScripts.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(setAutoCycleScripts(bool)));
 	connect(autoCycleInterval.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(setAutoCycleInterval(int)));
@@ -66,6 +83,15 @@ Deck::Deck(QWidget *parent)
 	m_midiInterface->getParameterMapping()->registerMIDIParameter(valueD.GetSharedParameter());
 	m_midiInterface->getParameterMapping()->registerMIDIParameter(triggerA.GetSharedParameter());
 	m_midiInterface->getParameterMapping()->registerMIDIParameter(triggerB.GetSharedParameter());
+	//smooth script values, so coarse MIDI steps don't show up in effects
+	ParameterSmoother::SPtr smoother = ParameterSmoother::getInstance();
+	m_smoothingHandles[valueA.name()] = smoother->add(valueA.GetSharedParameter());
+	m_smoothingHandles[valueB.name()] = smoother->add(valueB.GetSharedParameter());
+	m_smoothingHandles[valueC.name()] = smoother->add(valueC.GetSharedParameter());
+	m_smoothingHandles[valueD.name()] = smoother->add(valueD.GetSharedParameter());
+	m_smoothingHandles[triggerA.name()] = smoother->add(triggerA.GetSharedParameter());
+	m_smoothingHandles[triggerB.name()] = smoother->add(triggerB.GetSharedParameter());
+	resetScriptSmoothing();
 	//set up regular expression for error parsing
 	m_commentExp.setMinimal(true);
 	m_errorExp.setMinimal(true);
@@ -92,6 +118,10 @@ Deck::Deck(QWidget *parent)
 
 Deck::~Deck()
 {
+	for (auto handle : m_smoothingHandles)
+	{
+		ParameterSmoother::getInstance()->remove(handle);
+	}
 }
 
 void Deck::toXML(QDomElement & parent) const
@@ -125,6 +155,7 @@ void Deck::toXML(QDomElement & parent) const
 	triggerB.toXML(element);
 	autoCycleScripts.toXML(element);
 	autoCycleInterval.toXML(element);
+	frameBudget.toXML(element);
 	parent.appendChild(element);
 }
 
@@ -161,6 +192,7 @@ Deck & Deck::fromXML(const QDomElement & parent)
 			asynchronousCompilation.fromXML(child);
 			autoCycleScripts.fromXML(child);
 			autoCycleInterval.fromXML(child);
+			frameBudget.fromXML(child);
 			return *this;
 		}
 	}
@@ -206,30 +238,32 @@ void Deck::loadNextScript()
 		QStringList scripts = buildScriptList(m_scriptPath);
 		if (!scripts.isEmpty())
 		{
-			//try to find current script in list of scripts
-			int scriptIndex = scripts.indexOf(m_currentScriptPath);
-			//go to next script and load it
-			scriptIndex = (scriptIndex + 1) % scripts.size();
-			loadScript(scripts.at(scriptIndex));
+			//try to find current script in list of scripts. the current path is relative, so make the list relative too
+			for (auto & script : scripts)
+			{
+				script = QDir::current().relativeFilePath(script);
+			}
+			const int currentIndex = scripts.indexOf(m_currentScriptPath);
+			//go to next script not known to exceed the frame budget and load it
+			EffectStatistics::SPtr statistics = EffectStatistics::getInstance();
+			for (int i = 1; i <= scripts.size(); ++i)
+			{
+				const QString & script = scripts.at((currentIndex + i) % scripts.size());
+				if (!statistics->isValid(script) || statistics->averageTime(script) <= frameBudget)
+				{
+					loadScript(script);
+					return;
+				}
+			}
+			//all scripts are too expensive. cycle anyway
+			loadScript(scripts.at((currentIndex + 1) % scripts.size()));
 		}
 	}
 }
 
 QStringList Deck::buildScriptList(const QString & path)
 {
-	QStringList list;
-	QDirIterator it(path, QStringList() << "*.fs", QDir::Files, QDirIterator::Subdirectories);
-	while (it.hasNext()) {
-		if (it.fileInfo().isDir())
-		{
-			list.append(buildScriptList(it.path()));
-		}
-		else
-		{
-			list << it.next();
-		}
-	}
-	return list;
+	return ::buildScriptList(path);
 }
 
 void Deck::setUpdateInterval(int interval)
@@ -241,13 +275,30 @@ void Deck::setUpdateInterval(int interval)
 void Deck::setFrameBufferWidth(int width)
 {
 	frameBufferWidth = width;
-	m_liveView->setRenderSize(frameBufferWidth, frameBufferHeight);
+	m_liveView->setPreviewSize(frameBufferWidth, frameBufferHeight);
+	updateRenderSize();
 }
 
 void Deck::setFrameBufferHeight(int height)
 {
 	frameBufferHeight = height;
-	m_liveView->setRenderSize(frameBufferWidth, frameBufferHeight);
+	m_liveView->setPreviewSize(frameBufferWidth, frameBufferHeight);
+	updateRenderSize();
+}
+
+void Deck::updateRenderSize()
+{
+	if (renderAtDisplaySize)
+	{
+		//render directly at LED resolution and let the GPU resolve the supersampled image
+		m_liveView->setRenderSize(displayWidth, displayHeight);
+		m_liveView->setSuperSampling(superSampling);
+	}
+	else
+	{
+		m_liveView->setRenderSize(frameBufferWidth, frameBufferHeight);
+		m_liveView->setSuperSampling(1);
+	}
 }
 
 void Deck::setScriptPath(const QString & scriptPath)
@@ -269,8 +320,9 @@ bool Deck::loadScript(const QString & path)
         {
             m_currentScriptPath = QDir::current().relativeFilePath(path);
         }
-		ui->groupBox->setTitle(objectName() + " (" + m_currentScriptPath + ")");
-		//find any variables in comments
+		updateTitle();
+		//find any variables in comments. smoothing not set by the script uses the defaults
+		resetScriptSmoothing();
 		QList<QByteArray> lines = data.split(QChar::LineFeed);
 		for (auto line : lines)
 		{
@@ -336,7 +388,7 @@ bool Deck::saveAsScript(const QString & path)
                 m_codeEdit->document()->setModified(false);
                 //make path relative
                 m_currentScriptPath = QDir::current().relativeFilePath(filePath);
-				ui->groupBox->setTitle(objectName() + " (" + m_currentScriptPath + ")");
+				updateTitle();
                 return true;
             }
         }
@@ -365,7 +417,23 @@ void Deck::scriptTextChanged()
 void Deck::scriptModified(bool modified)
 {
 	m_scriptModified = modified;
-	ui->groupBox->setTitle(objectName() + " (" + m_currentScriptPath + ")" + (m_scriptModified ? "*" : ""));
+	updateTitle();
+}
+
+void Deck::updateTitle()
+{
+	QString title = objectName() + " (" + m_currentScriptPath + ")" + (m_scriptModified ? "*" : "");
+	EffectStatistics::SPtr statistics = EffectStatistics::getInstance();
+	if (!m_scriptModified && statistics->isValid(m_currentScriptPath))
+	{
+		const float average = statistics->averageTime(m_currentScriptPath);
+		title += QString(" %1 ms").arg(average, 0, 'f', 2) + (m_liveView->hasGPUFrameTimes() ? "" : " (CPU)");
+		if (average > frameBudget)
+		{
+			title += tr(" over budget");
+		}
+	}
+	ui->groupBox->setTitle(title);
 }
 
 void Deck::scriptCompiledOk()
@@ -422,7 +490,11 @@ void Deck::setScriptParameter(ParameterInt parameter, const QString & value)
 
 void Deck::setScriptParameter(const QString & name, const QString & value)
 {
-	if (name == valueA.name())
+	if (name.endsWith("_smoothing"))
+	{
+		setScriptSmoothing(name.left(name.size() - 10), value);
+	}
+	else if (name == valueA.name())
 	{
 		setScriptParameter(valueA, value);
 	}
@@ -448,22 +520,60 @@ void Deck::setScriptParameter(const QString & name, const QString & value)
 	}
 }
 
+void Deck::setScriptSmoothing(const QString & name, const QString & value)
+{
+	//value is "none" or "<mode>:<time in seconds>", e.g. "spring:0.1"
+	ParameterSmoother::Mode mode;
+	float time;
+	if (m_smoothingHandles.contains(name) && ParameterSmoother::parseMode(value, mode, time))
+	{
+		ParameterSmoother::getInstance()->setMode(m_smoothingHandles.value(name), mode, time);
+	}
+}
+
+void Deck::resetScriptSmoothing()
+{
+	//dials are smoothed slightly, triggers must react immediately
+	ParameterSmoother::SPtr smoother = ParameterSmoother::getInstance();
+	smoother->setMode(m_smoothingHandles.value(valueA.name()), ParameterSmoother::OnePole, 0.05f);
+	smoother->setMode(m_smoothingHandles.value(valueB.name()), ParameterSmoother::OnePole, 0.05f);
+	smoother->setMode(m_smoothingHandles.value(valueC.name()), ParameterSmoother::OnePole, 0.05f);
+	smoother->setMode(m_smoothingHandles.value(valueD.name()), ParameterSmoother::OnePole, 0.05f);
+	smoother->setMode(m_smoothingHandles.value(triggerA.name()), ParameterSmoother::None, 0.0f);
+	smoother->setMode(m_smoothingHandles.value(triggerB.name()), ParameterSmoother::None, 0.0f);
+}
+
 void Deck::updateScriptValues()
 {
     //update properties in new active script
     m_liveView->setFragmentScriptProperty("time", (float)m_scriptTime.elapsed() / 1000.0f);
-	m_liveView->setFragmentScriptProperty(valueA.name(), valueA.normalizedValue());
-	m_liveView->setFragmentScriptProperty(valueB.name(), valueB.normalizedValue());
-	m_liveView->setFragmentScriptProperty(valueC.name(), valueC.normalizedValue());
-	m_liveView->setFragmentScriptProperty(valueD.name(), valueD.normalizedValue());
-	m_liveView->setFragmentScriptProperty(triggerA.name(), triggerA.normalizedValue());
-	m_liveView->setFragmentScriptProperty(triggerB.name(), triggerB.normalizedValue());
+	m_liveView->setFragmentScriptProperty("beatPhase", m_beatPhase);
+	m_liveView->setFragmentScriptProperty("bar", (float)m_bar);
+	m_liveView->setFragmentScriptProperty("bpm", m_bpm);
+	//dials and triggers are passed smoothed. the smoother is advanced once per frame
+	ParameterSmoother::SPtr smoother = ParameterSmoother::getInstance();
+	for (auto it = m_smoothingHandles.cbegin(); it != m_smoothingHandles.cend(); ++it)
+	{
+		m_liveView->setFragmentScriptProperty(it.key(), smoother->value(it.value()));
+	}
 }
 
 void Deck::render()
 {
 	updateScriptValues();
 	m_liveView->render();
+	//collect render times of the effect. edited scripts are not measured, because they're not the effect file anymore
+	float times[FrameTimer::StageCount];
+	if (m_liveView->takeFrameTimes(times) && !m_scriptModified)
+	{
+		EffectStatistics::getInstance()->add(m_currentScriptPath, times, m_liveView->hasGPUFrameTimes());
+	}
+	//show the render time twice a second
+	if (!m_titleTimer.isValid() || m_titleTimer.elapsed() >= 500)
+	{
+		m_titleTimer.start();
+		updateTitle();
+	}
 }
 
 void Deck::grabFramebufferAfterSwap()
@@ -476,6 +586,23 @@ QImage Deck::getGrabbedFramebuffer()
 	return m_liveView->getGrabbedFramebuffer();
 }
 
+GLuint Deck::outputTexture()
+{
+	return m_liveView->outputTexture();
+}
+
+QSize Deck::outputSize()
+{
+	return m_liveView->outputSize();
+}
+
+void Deck::setTempo(float beatPhase, int bar, float bpm)
+{
+	m_beatPhase = beatPhase;
+	m_bar = bar;
+	m_bpm = bpm;
+}
+
 void Deck::updateTime()
 {
 	m_liveView->setFragmentScriptProperty("time", (float)m_scriptTime.elapsed() / 1000.0f);
@@ -8,6 +8,8 @@
 #include <QWidget>
 #include <QTimer>
 #include <QTime>
+#include <QElapsedTimer>
+#include <QHash>
 
 namespace Ui { class CodeDeck; }
 
@@ -31,6 +33,11 @@ public:
 	ParameterBool asynchronousCompilation;
 	ParameterInt frameBufferWidth;
 	ParameterInt frameBufferHeight;
+	/// @brief If true the deck renders at display (LED) resolution times superSampling instead of the preview resolution.
+	ParameterBool renderAtDisplaySize;
+	ParameterInt displayWidth;
+	ParameterInt displayHeight;
+	ParameterInt superSampling;
 
 	ParameterInt valueA;
 	ParameterInt valueB;
@@ -41,11 +48,14 @@ public:
 
 	ParameterBool autoCycleScripts;
 	ParameterInt autoCycleInterval;
+	/// @brief Frame time in ms effects may take. Auto-cycling skips effects measured to take longer.
+	ParameterInt frameBudget;
 
 	void setScriptPath(const QString & scriptPath);
     bool loadScript(const QString & path);
     bool saveScript();
     bool saveAsScript(const QString & path = "");
+	/// @brief Find all effect scripts in a directory and its sub-directories.
 	static QStringList buildScriptList(const QString & path);
 
 	/// @brief Update view and emit signal renderingFinished when rendering and the asynchronous buffer swap have finished.
@@ -58,6 +68,18 @@ public:
 	/// @brief Retrieve the last grabbed framebuffer. Call void grabFrameBufferAfterSwap() to grab it after a buffer swap.
 	QImage getGrabbedFramebuffer();
 
+	/// @brief Retrieve the texture holding the last rendered image. It can be used in all contexts sharing resources with the deck.
+	GLuint outputTexture();
+
+	/// @brief Retrieve the size of the texture returned by outputTexture().
+	QSize outputSize();
+
+	/// @brief Set the musical position passed to effects as the uniforms "beatPhase", "bar" and "bpm".
+	/// @param beatPhase Position inside the current beat [0,1).
+	/// @param bar Number of bars since start.
+	/// @param bpm Tempo in beats per minute.
+	void setTempo(float beatPhase, int bar, float bpm);
+
     ~Deck();
 
 signals:
@@ -72,6 +94,7 @@ private slots:
 	void setUpdateInterval(int interval);
 	void setFrameBufferWidth(int width);
 	void setFrameBufferHeight(int height);
+	void updateRenderSize();
 	void parameterChanged(NodeBase * parameter);
 
     void scriptModified(bool modified);
@@ -84,10 +107,15 @@ private slots:
 	void setScriptParameter(ParameterBool parameter, const QString & value);
 	void setScriptParameter(ParameterInt parameter, const QString & value);
 	void setScriptParameter(const QString & name, const QString & value);
+	void setScriptSmoothing(const QString & name, const QString & value);
+	void resetScriptSmoothing();
 	void updateScriptValues();
     void updateTime();
 
 private:
+	/// @brief Show the script path, modification state and render time in the deck title.
+	void updateTitle();
+
 	QRegExp m_commentExp;
 	QRegExp m_errorExp;
 	QRegExp m_errorExp2;
@@ -97,6 +125,9 @@ private:
     CodeEdit * m_codeEdit;
     QTimer m_updateTimer;
     QTime m_scriptTime;
+	float m_beatPhase;
+	int m_bar;
+	float m_bpm;
 
     QString m_currentText;
 	bool m_scriptModified;
@@ -105,6 +136,10 @@ private:
 	QString m_scriptPath;
 
 	QTimer m_cycleTimer;
+	QElapsedTimer m_titleTimer;
+
+	/// @brief Handles of the script values in the parameter smoother by uniform name.
+	QHash<QString, int> m_smoothingHandles;
 
 	MIDIInterface::SPtr m_midiInterface;
 };
@@ -0,0 +1,199 @@
+#include "DeviceAudioSource.h"
+#include "SPSCRing.h"
+
+#include <QIODevice>
+#include <atomic>
+
+
+//write-only device QAudioInput writes the captured samples to. there is no position to seek and nothing is copied
+//except into the ring. holds about 3s of 16-bit mono audio at 44.1kHz
+class AudioCaptureBuffer : public QIODevice
+{
+public:
+	AudioCaptureBuffer(QObject * parent = nullptr)
+		: QIODevice(parent)
+		, m_lostBytes(0)
+		, m_writtenBytes(0)
+	{
+	}
+
+	bool isSequential() const
+	{
+		return true;
+	}
+
+	//take out the complete frames in the ring. call from the consumer thread only
+	QByteArray takeFrames(int bytesPerFrame)
+	{
+		const size_t size = (m_ring.size() / bytesPerFrame) * bytesPerFrame;
+		QByteArray data((int)size, Qt::Uninitialized);
+		m_ring.pop(data.data(), size);
+		return data;
+	}
+
+	//retrieve the number of bytes dropped since the last call
+	int takeLostBytes()
+	{
+		return m_lostBytes.exchange(0);
+	}
+
+	//retrieve the number of bytes QAudioInput wrote since the last call, stored or dropped
+	int takeWrittenBytes()
+	{
+		return m_writtenBytes.exchange(0);
+	}
+
+protected:
+	qint64 readData(char * /*data*/, qint64 /*maxSize*/)
+	{
+		return -1;
+	}
+
+	qint64 writeData(const char * data, qint64 size)
+	{
+		m_writtenBytes.fetch_add((int)size, std::memory_order_relaxed);
+		//only store complete writes, so a partial write can never shift the frames after it
+		if ((qint64)(m_ring.capacity() - m_ring.size()) >= size)
+		{
+			m_ring.push(data, (size_t)size);
+		}
+		else
+		{
+			m_lostBytes.fetch_add((int)size, std::memory_order_relaxed);
+		}
+		//report everything as written, so QAudioInput never stalls
+		return size;
+	}
+
+private:
+	SPSCRing<char, 256 * 1024> m_ring;
+	std::atomic<int> m_lostBytes;
+	std::atomic<int> m_writtenBytes;
+};
+
+DeviceAudioSource::DeviceAudioSource(const QAudioDeviceInfo & info, int sampleRate, int bitDepth, int interval, QObject * parent)
+	: AudioSource(parent)
+	, m_audioInput(nullptr)
+	, m_inputDevice(nullptr)
+	, m_writtenFrames(0)
+	, m_missingFrames(0)
+{
+	//create capture format
+	QAudioFormat format;
+	format.setSampleRate(sampleRate);
+	format.setChannelCount(1);
+	format.setSampleSize(bitDepth);
+	format.setCodec("audio/pcm");
+	format.setByteOrder(QAudioFormat::LittleEndian);
+	format.setSampleType(QAudioFormat::UnSignedInt);
+	if (!info.isFormatSupported(format))
+	{
+		//format not supported, try something similar
+		format = info.nearestFormat(format);
+	}
+	//create audio input
+	m_audioInput = new QAudioInput(info, format, this);
+	m_audioInput->setNotifyInterval(interval);
+	//allocate audio buffer sized twice the capture interval
+	m_audioInput->setBufferSize(m_audioInput->format().bytesForDuration(1000 * 2 * interval));
+	connect(m_audioInput, SIGNAL(notify()), this, SLOT(inputDataReady()));
+	connect(m_audioInput, SIGNAL(stateChanged(QAudio::State)), this, SLOT(inputStateChanged(QAudio::State)));
+}
+
+DeviceAudioSource::~DeviceAudioSource()
+{
+	stop();
+}
+
+QAudioFormat DeviceAudioSource::format() const
+{
+	return m_audioInput->format();
+}
+
+bool DeviceAudioSource::start()
+{
+	if (!m_inputDevice)
+	{
+		//create device receiving data
+		m_inputDevice = new AudioCaptureBuffer(this);
+		m_inputDevice->open(QIODevice::WriteOnly);
+		m_writtenFrames = 0;
+		m_missingFrames = 0;
+		m_audioInput->start(m_inputDevice);
+	}
+	return m_audioInput->error() == QAudio::NoError;
+}
+
+void DeviceAudioSource::stop()
+{
+	if (m_inputDevice)
+	{
+		m_audioInput->stop();
+		m_inputDevice->close();
+		delete m_inputDevice;
+		m_inputDevice = nullptr;
+	}
+}
+
+bool DeviceAudioSource::isActive() const
+{
+	return m_audioInput->state() == QAudio::ActiveState;
+}
+
+void DeviceAudioSource::setInterval(int interval)
+{
+	const bool inputActive = m_inputDevice && m_audioInput->state() == QAudio::ActiveState;
+	if (inputActive)
+	{
+		//if capturing stop input
+		m_audioInput->stop();
+		m_inputDevice->close();
+	}
+	//change callback interval and buffer size
+	m_audioInput->setNotifyInterval(interval);
+	m_audioInput->setBufferSize(m_audioInput->format().bytesForDuration(1000 * 2 * interval));
+	if (inputActive)
+	{
+		//if capturing, restart input. frames still in the ring are delivered with the next block
+		m_inputDevice->open(QIODevice::WriteOnly);
+		//processedUSecs() starts over, so does the count of written frames
+		m_inputDevice->takeWrittenBytes();
+		m_writtenFrames = 0;
+		m_missingFrames = 0;
+		m_audioInput->start(m_inputDevice);
+	}
+}
+
+void DeviceAudioSource::inputDataReady()
+{
+	if (m_inputDevice)
+	{
+		const QAudioFormat format = m_audioInput->format();
+		const int bytesPerFrame = format.bytesPerFrame();
+		if (bytesPerFrame > 0)
+		{
+			loseFrames(m_inputDevice->takeLostBytes() / bytesPerFrame);
+			//QAudioInput drops data itself on overruns without telling. compare what it captured to what it wrote.
+			//up to a buffer of data may still be on its way, so only count what is missing beyond that
+			m_writtenFrames += m_inputDevice->takeWrittenBytes() / bytesPerFrame;
+			const qint64 capturedFrames = format.framesForDuration(m_audioInput->processedUSecs());
+			const qint64 missingFrames = capturedFrames - m_writtenFrames - format.framesForBytes(m_audioInput->bufferSize()) - m_missingFrames;
+			if (missingFrames > 0)
+			{
+				loseFrames(missingFrames);
+				m_missingFrames += missingFrames;
+			}
+			//deliver only what was written since the last block
+			const QByteArray data = m_inputDevice->takeFrames(bytesPerFrame);
+			if (!data.isEmpty())
+			{
+				deliver(data, format);
+			}
+		}
+	}
+}
+
+void DeviceAudioSource::inputStateChanged(QAudio::State state)
+{
+	emit activeChanged(state == QAudio::ActiveState /* || state == QAudio::IdleState*/);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "AudioSource.h"
+
+#include <QAudio>
+#include <QAudioDeviceInfo>
+#include <QAudioInput>
+
+class AudioCaptureBuffer;
+
+
+/// @brief Captures audio from a sound card through QAudioInput.
+/// QAudioInput writes into a device that pushes the samples into a lock-free ring. Every capture interval all complete
+/// frames in the ring are delivered from the thread the source lives in, so every frame is delivered exactly once.
+/// If the ring is full when QAudioInput writes, the write is dropped and counted as lost. Frames QAudioInput captured,
+/// but never wrote, e.g. on overruns of its own buffer, are detected from processedUSecs() and counted as lost too.
+class DeviceAudioSource : public AudioSource
+{
+	Q_OBJECT
+
+public:
+	/// @brief Constructor.
+	/// @param info Capture device to use.
+	/// @param sampleRate Preferred sample rate. The device may use the nearest rate it supports.
+	/// @param bitDepth Preferred bits per sample.
+	/// @param interval Time between two blocks in ms.
+	DeviceAudioSource(const QAudioDeviceInfo & info, int sampleRate, int bitDepth, int interval, QObject * parent = 0);
+	~DeviceAudioSource();
+
+	QAudioFormat format() const;
+	bool start();
+	void stop();
+	bool isActive() const;
+	void setInterval(int interval);
+
+private slots:
+	void inputDataReady();
+	void inputStateChanged(QAudio::State state);
+
+private:
+	QAudioInput * m_audioInput;
+	AudioCaptureBuffer * m_inputDevice;
+	qint64 m_writtenFrames; //frames QAudioInput wrote since it was started
+	qint64 m_missingFrames; //frames QAudioInput captured, but did not write, that are already counted as lost
+};
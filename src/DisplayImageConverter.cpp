@@ -1,18 +1,25 @@
 #include "DisplayImageConverter.h"
 
 #include "ImageOperations.h"
-#include <QPainter>
 
 
+const int DisplayImageConverter::MinimumWidth;
+const int DisplayImageConverter::MaximumWidth;
+const int DisplayImageConverter::MinimumHeight;
+const int DisplayImageConverter::MaximumHeight;
+
 DisplayImageConverter::DisplayImageConverter(QObject * parent)
 	: QObject(parent)
-	, displayWidth("displayWidth", 32, 8, 64)
-	, displayHeight("displayHeight", 18, 4, 64)
+	, displayWidth("displayWidth", 32, MinimumWidth, MaximumWidth)
+	, displayHeight("displayHeight", 18, MinimumHeight, MaximumHeight)
 	, displayBrightness("displayBrightness", 0, -50, 50)
 	, displayContrast("displayContrast", 0, -50, 50)
 	, displayGamma("displayGamma", 220, 100, 400)
-	, crossFadeValue("crossFadeValue", 0, 0, 100)
+	, m_tableBrightness(0.0f)
+	, m_tableContrast(0.0f)
+	, m_tableGamma(0.0f)
 {
+	qRegisterMetaType<Image16>("Image16");
 }
 
 void DisplayImageConverter::toXML(QDomElement & parent) const
@@ -27,7 +34,6 @@ void DisplayImageConverter::toXML(QDomElement & parent) const
 	}
 	displayWidth.toXML(element);
 	displayHeight.toXML(element);
-	crossFadeValue.toXML(element);
 	displayBrightness.toXML(element);
 	displayContrast.toXML(element);
 	displayGamma.toXML(element);
@@ -43,47 +49,34 @@ DisplayImageConverter& DisplayImageConverter::fromXML(const QDomElement & parent
 	}
 	displayWidth.fromXML(element);
 	displayHeight.fromXML(element);
-	crossFadeValue.fromXML(element);
 	displayBrightness.fromXML(element);
 	displayContrast.fromXML(element);
 	displayGamma.fromXML(element);
 	return *this;
 }
 
-void DisplayImageConverter::convertImages(const QImage & a, const QImage & b)
+void DisplayImageConverter::convertImage(const Image16 & image)
 {
-	//allocate image if it isn't
-	if (m_previewImage.isNull() || m_previewImage.size() != a.size())
-	{
-		m_previewImage = QImage(a.size(), a.format());
-	}
-	//composite images
-	QPainter painter(&m_previewImage);
-	painter.setCompositionMode(QPainter::CompositionMode_Source);
-	painter.fillRect(m_previewImage.rect(), Qt::black);
-	qreal alphaB = crossFadeValue.normalizedValue();
-	qreal alphaA = 1.0 - alphaB;
-	if (alphaA <= alphaB)
-	{
-		painter.drawImage(0, 0, a);
-		painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-		painter.setOpacity(alphaB);
-		painter.drawImage(0, 0, b);
-	}
-	else
-	{
-		painter.drawImage(0, 0, b);
-		painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-		painter.setOpacity(alphaA);
-		painter.drawImage(0, 0, a);
-	}
-	//scale image down to real size
-	m_displayImage = m_previewImage.scaled(displayWidth, displayHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	convertImage(image, displayWidth, displayHeight);
+}
+
+void DisplayImageConverter::convertImage(const Image16 & image, int width, int height)
+{
+	m_previewImage = image.toImage();
+	//scale image down to real size. when the decks render at display size this has already been done on the GPU
+	m_displayImage = image.scaled(width, height);
 	//do image correction
 	float brightness = displayBrightness / 50.0f;
 	float contrast = (displayContrast + 50.0f) / 100.0f * 2.0f;
 	float gamma = displayGamma / 220.0f;
-	m_displayImage = changeImage(m_displayImage, brightness, contrast, gamma);
+	if (m_changeTable.isEmpty() || brightness != m_tableBrightness || contrast != m_tableContrast || gamma != m_tableGamma)
+	{
+		buildChangeTable(m_changeTable, brightness, contrast, gamma);
+		m_tableBrightness = brightness;
+		m_tableContrast = contrast;
+		m_tableGamma = gamma;
+	}
+	m_displayImage = changeImage(m_displayImage, m_changeTable);
 	//send results
 	displayImageChanged(m_displayImage);
 	previewImageChanged(m_previewImage);
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "Parameters.h"
+#include "Image16.h"
 
 #include <QObject>
 #include <QImage>
+#include <QVector>
 #include <QDomDocument>
 
 
@@ -12,6 +14,12 @@ class DisplayImageConverter : public QObject
 	Q_OBJECT
 
 public:
+	/// @brief Limits of the display size in LEDs. Every parameter holding the display size uses these.
+	static const int MinimumWidth = 8;
+	static const int MaximumWidth = 64;
+	static const int MinimumHeight = 4;
+	static const int MaximumHeight = 64;
+
 	DisplayImageConverter(QObject * parent = NULL);
 
 	/// @brief Save the current settings to an XML document.
@@ -23,18 +31,30 @@ public:
 
 	ParameterInt displayWidth;
 	ParameterInt displayHeight;
-	ParameterInt crossFadeValue; //[0,100]
 	ParameterInt displayGamma; //[150,350]
 	ParameterInt displayBrightness; //[-50,50]
 	ParameterInt displayContrast; //[-50,50]
 
-	void convertImages(const QImage & a, const QImage & b);
+	/// @brief Scale the mixed deck image to display size and apply color correction.
+	/// Color correction is done with 16 bits per channel. Reducing to 8 bits is left to the display.
+	/// @param image Mixed image from the decks.
+	void convertImage(const Image16 & image);
+	/// @brief Scale an image to any size and apply color correction, e.g. to render frames larger than the LED display.
+	/// @param image Image to convert.
+	/// @param width Width of the converted image. Not limited to MaximumWidth.
+	/// @param height Height of the converted image. Not limited to MaximumHeight.
+	void convertImage(const Image16 & image, int width, int height);
 
 signals:
 	void previewImageChanged(const QImage & image);
-	void displayImageChanged(const QImage & image);
+	void displayImageChanged(const Image16 & image);
 
 private:
 	QImage m_previewImage;
-	QImage m_displayImage;
+	Image16 m_displayImage;
+	//color correction table and the settings it was built for
+	QVector<quint16> m_changeTable;
+	float m_tableBrightness;
+	float m_tableContrast;
+	float m_tableGamma;
 };
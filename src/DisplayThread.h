@@ -2,15 +2,18 @@
 
 #include "Parameters.h"
 #include "ParameterScanlineDirection.h"
+#include "Image16.h"
 
 #include <QThread>
 #include <QMutex>
-#include <QWaitCondition>
 #include <QImage>
 #include <QDomDocument>
 #include <QStringList>
 
+class SerialWriter;
 
+
+/// @brief Thread sending images to the LED display. Runs an event loop with a SerialWriter doing the actual work.
 class DisplayThread : public QThread
 {
     Q_OBJECT
@@ -36,9 +39,25 @@ public:
 	ParameterBool flipHorizontal;
 	ParameterBool flipVertical;
 	ParameterScanlineDirection scanlineDirection;
+	/// @brief Send only changed LEDs if the device supports the extended LEDStream protocol.
+	ParameterBool extendedProtocol;
+	/// @brief Share the chroma of neighbouring LEDs to send less data, if the device supports it.
+	ParameterBool reducedColor;
+	/// @brief Carry the part of the colors that can't be shown with 8 bits over to the next frames.
+	ParameterBool dithering;
+	/// @brief Current a color channel of an LED draws at full brightness in mA.
+	ParameterInt ledCurrent;
+	/// @brief Current all LEDs may draw together in mA. 0 means no limit.
+	ParameterInt powerLimit;
+	/// @brief Number of segments of consecutive LEDs with their own power supply or injection.
+	ParameterInt powerSegments;
+	/// @brief Current the LEDs of a segment may draw in mA. 0 means no limit.
+	ParameterInt segmentPowerLimit;
 	ParameterBool sending;
 
-    void sendImage(const QImage &displayImage, int m_waitTimeout = 100);
+	/// @brief Queue an image for sending. If the display is still busy with an older image when this one arrives, the
+	/// older one is dropped, so the newest image is always sent next.
+    void sendImage(const Image16 &displayImage, int m_waitTimeout = 100);
 
 signals:
 	void portOpened(bool portOpen);
@@ -55,9 +74,9 @@ private slots:
 	void setBaudrate(int baudrate = 115200);
 
 private:
-    QImage m_displayImage;
-    int m_waitTimeout;
+	/// @brief Tell the writer to re-read the port settings.
+	void updateWriterSettings();
+
     QMutex m_mutex;
-    QWaitCondition m_condition;
-    bool m_quit;
+	SerialWriter * m_writer;
 };
@@ -0,0 +1,147 @@
+#include "EffectStatistics.h"
+
+#include <QFile>
+#include <QDir>
+#include <QTextStream>
+#include <algorithm>
+
+
+std::mutex EffectStatistics::s_mutex;
+
+EffectStatistics::SPtr & EffectStatistics::getInstance()
+{
+	static EffectStatistics::SPtr s_instance = nullptr;
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_instance)
+	{
+		s_instance.reset(new EffectStatistics());
+	}
+	return s_instance;
+}
+
+EffectStatistics::EffectStatistics()
+{
+}
+
+QString EffectStatistics::key(const QString & effect)
+{
+	//effects are referred to as "./effects/a.fs" or "effects/a.fs". use the relative path like Deck does
+	return effect.startsWith(":/") ? effect : QDir::current().relativeFilePath(effect);
+}
+
+void EffectStatistics::add(const QString & effect, const float times[FrameTimer::StageCount], bool gpu)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(key(effect));
+	if (it == m_entries.end())
+	{
+		Entry entry;
+		entry.totals.fill(0.0f, WindowSize);
+		entry.next = 0;
+		entry.frames = 0;
+		std::copy(times, times + FrameTimer::StageCount, entry.stages);
+		it = m_entries.insert(key(effect), entry);
+	}
+	Entry & entry = it.value();
+	float total = 0.0f;
+	for (int i = 0; i < FrameTimer::StageCount; ++i)
+	{
+		total += times[i];
+		entry.stages[i] += (times[i] - entry.stages[i]) / WindowSize;
+	}
+	entry.totals[entry.next] = total;
+	entry.next = (entry.next + 1) % WindowSize;
+	entry.frames++;
+	entry.gpu = gpu;
+}
+
+bool EffectStatistics::isValid(const QString & effect) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.constFind(key(effect));
+	return it != m_entries.constEnd() && it.value().frames >= MinimumFrames;
+}
+
+float EffectStatistics::averageTime(const QString & effect) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.constFind(key(effect));
+	if (it == m_entries.constEnd())
+	{
+		return -1.0f;
+	}
+	const int count = std::min(it.value().frames, WindowSize);
+	float sum = 0.0f;
+	for (int i = 0; i < count; ++i)
+	{
+		sum += it.value().totals.at(i);
+	}
+	return sum / count;
+}
+
+float EffectStatistics::peakTime(const QString & effect) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.constFind(key(effect));
+	if (it == m_entries.constEnd())
+	{
+		return -1.0f;
+	}
+	const int count = std::min(it.value().frames, WindowSize);
+	return *std::max_element(it.value().totals.cbegin(), it.value().totals.cbegin() + count);
+}
+
+bool EffectStatistics::exportCSV(const QString & fileName, const QStringList & effects) const
+{
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly | QFile::Text))
+	{
+		return false;
+	}
+	QStringList allEffects;
+	for (const QString & effect : effects)
+	{
+		allEffects.append(key(effect));
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it)
+		{
+			if (!allEffects.contains(it.key()))
+			{
+				allEffects.append(it.key());
+			}
+		}
+	}
+	QTextStream stream(&file);
+	stream << "effect,frames,average_ms,peak_ms,render_ms,resolve_ms,readback_ms,blit_ms,timer" << endl;
+	for (const QString & effect : allEffects)
+	{
+		stream << '"' << QString(effect).replace('"', "\"\"") << '"';
+		const float average = averageTime(effect);
+		const float peak = peakTime(effect);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.constFind(key(effect));
+		if (it != m_entries.constEnd())
+		{
+			stream << ',' << it.value().frames << ',' << average << ',' << peak;
+			for (int i = 0; i < FrameTimer::StageCount; ++i)
+			{
+				stream << ',' << it.value().stages[i];
+			}
+			stream << ',' << (it.value().gpu ? "gpu" : "cpu");
+		}
+		else
+		{
+			stream << ",0,,,,,,,";
+		}
+		stream << endl;
+	}
+	return stream.status() == QTextStream::Ok;
+}
+
+void EffectStatistics::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.clear();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "FrameTimer.h"
+
+#include <memory>
+#include <mutex>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+/// @brief Collects rolling render time statistics per effect script, so expensive effects can be found and avoided.
+/// The frame times of the last WindowSize frames of an effect are kept for the average and the peak.
+/// The split into stages is an exponential average over about the same number of frames.
+class EffectStatistics
+{
+public:
+	/// brief Shared pointer of EffectStatistics object.
+	typedef std::shared_ptr<EffectStatistics> SPtr;
+
+	/// @brief Number of frames the average and peak are computed from.
+	static const int WindowSize = 120;
+	/// @brief Number of frames an effect needs to be measured before its statistics are considered valid.
+	static const int MinimumFrames = 10;
+
+	/// @brief Retrieve or create the instance of the statistics.
+	static SPtr & getInstance();
+
+	/// @brief Add the stage times of a rendered frame.
+	/// @param effect Path of the effect script.
+	/// @param times Time of every stage in ms.
+	/// @param gpu True if the times were measured on the GPU.
+	void add(const QString & effect, const float times[FrameTimer::StageCount], bool gpu);
+
+	/// @brief Retrieve true if an effect has been measured for at least MinimumFrames frames.
+	bool isValid(const QString & effect) const;
+	/// @brief Retrieve the average frame time of an effect in ms or -1 if it has not been measured.
+	float averageTime(const QString & effect) const;
+	/// @brief Retrieve the longest frame time of an effect in ms or -1 if it has not been measured.
+	float peakTime(const QString & effect) const;
+
+	/// @brief Write the statistics as CSV with one line per effect. Effects not measured have empty fields.
+	/// @param fileName CSV file to write.
+	/// @param effects Effects to write. Effects measured, but not in the list, are appended.
+	/// @return False if the file could not be written.
+	bool exportCSV(const QString & fileName, const QStringList & effects) const;
+
+	/// @brief Forget all statistics.
+	void clear();
+
+private:
+	EffectStatistics();
+	EffectStatistics(EffectStatistics & es);
+	EffectStatistics & operator=(const EffectStatistics & es);
+
+	struct Entry
+	{
+		QVector<float> totals; //ring buffer of frame times
+		int next; //next index written in totals
+		int frames; //number of frames measured in total
+		float stages[FrameTimer::StageCount]; //exponential average of stage times
+		bool gpu;
+	};
+
+	/// @brief Retrieve the key an effect path is stored under.
+	static QString key(const QString & effect);
+
+	static std::mutex s_mutex;
+
+	mutable std::mutex m_mutex;
+	QHash<QString, Entry> m_entries;
+};
@@ -0,0 +1,264 @@
+#include "FileAudioSource.h"
+#include "WavReader.h"
+
+#include <QFile>
+#include <chrono>
+#include <cerrno>
+#include <stdexcept>
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <unistd.h>
+#endif
+
+
+//time to wait for data from a pipe before checking if the source was stopped in ms
+static const int PipeWaitTimeout = 100;
+//maximum time the real-time pacing may fall behind before it starts over instead of catching up
+static const std::chrono::seconds MaximumLag(1);
+
+//reads a raw file or pipe and opens it again at its end, which starts a file over and waits for the next writer of a pipe
+class RawReader
+{
+public:
+	RawReader(const QString & fileName)
+		: m_fileName(fileName)
+		, m_fd(-1)
+		, m_hasRead(false)
+	{
+	}
+
+	~RawReader()
+	{
+		close();
+	}
+
+	//read up to size bytes. returns the number of bytes read, which is 0 if no data arrived in time
+	int read(char * data, int size)
+	{
+		int result = 0;
+#ifndef _WIN32
+		if (m_fd < 0)
+		{
+			//open without blocking, so opening a pipe does not wait for a writer and stopping stays possible
+			m_fd = ::open(QFile::encodeName(m_fileName).constData(), O_RDONLY | O_NONBLOCK);
+			if (m_fd < 0)
+			{
+				return waitAfterEnd();
+			}
+			m_hasRead = false;
+		}
+		pollfd descriptor = {m_fd, POLLIN, 0};
+		if (poll(&descriptor, 1, PipeWaitTimeout) <= 0)
+		{
+			return 0;
+		}
+		const ssize_t count = ::read(m_fd, data, size);
+		if (count < 0 && (errno == EAGAIN || errno == EINTR))
+		{
+			return 0;
+		}
+		result = (int)count;
+#else
+		//Windows has no non-blocking reads on files. reading a pipe blocks until its writer sends data or closes it
+		if (!m_file.isOpen())
+		{
+			m_file.setFileName(m_fileName);
+			if (!m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+			{
+				return waitAfterEnd();
+			}
+			m_hasRead = false;
+		}
+		result = (int)m_file.read(data, size);
+#endif
+		if (result <= 0)
+		{
+			//end of the file, the writer closed the pipe or an error
+			close();
+			return waitAfterEnd();
+		}
+		m_hasRead = true;
+		return result;
+	}
+
+	void close()
+	{
+#ifndef _WIN32
+		if (m_fd >= 0)
+		{
+			::close(m_fd);
+			m_fd = -1;
+		}
+#else
+		m_file.close();
+#endif
+	}
+
+private:
+	//don't spin on files that can't be opened or are empty
+	int waitAfterEnd()
+	{
+		if (!m_hasRead)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(PipeWaitTimeout));
+		}
+		m_hasRead = false;
+		return 0;
+	}
+
+	QString m_fileName;
+	int m_fd;
+	QFile m_file;
+	bool m_hasRead; //if data has been read since the file was opened
+};
+
+FileAudioSource::FileAudioSource(const QString & fileName, int sampleRate, int interval, bool realTime, QObject * parent)
+	: AudioSource(parent)
+	, m_fileName(fileName)
+	, m_isWave(fileName.endsWith(".wav", Qt::CaseInsensitive))
+	, m_position(0)
+	, m_interval(interval)
+	, m_realTime(realTime)
+	, m_running(false)
+{
+	if (m_isWave)
+	{
+		//decode the whole file, so reading never waits for the disk. samples are delivered as float
+		try
+		{
+			WavReader reader(fileName);
+			m_samples = reader.samples();
+			if (!m_samples.isEmpty())
+			{
+				m_format.setSampleRate(reader.sampleRate());
+				m_format.setChannelCount(reader.channelCount());
+				m_format.setSampleSize(32);
+				m_format.setCodec("audio/pcm");
+				m_format.setByteOrder(QAudioFormat::LittleEndian);
+				m_format.setSampleType(QAudioFormat::Float);
+			}
+		}
+		catch (const std::runtime_error &)
+		{
+			m_samples.clear();
+		}
+	}
+	else
+	{
+		m_format.setSampleRate(sampleRate);
+		m_format.setChannelCount(1);
+		m_format.setSampleSize(16);
+		m_format.setCodec("audio/pcm");
+		m_format.setByteOrder(QAudioFormat::LittleEndian);
+		m_format.setSampleType(QAudioFormat::SignedInt);
+	}
+}
+
+FileAudioSource::~FileAudioSource()
+{
+	stop();
+}
+
+QAudioFormat FileAudioSource::format() const
+{
+	return m_format;
+}
+
+bool FileAudioSource::start()
+{
+	if (m_running)
+	{
+		return true;
+	}
+	if (!m_format.isValid())
+	{
+		return false;
+	}
+	m_running = true;
+	m_thread = std::thread(&FileAudioSource::run, this);
+	emit activeChanged(true);
+	return true;
+}
+
+void FileAudioSource::stop()
+{
+	if (m_thread.joinable())
+	{
+		m_running = false;
+		m_thread.join();
+		emit activeChanged(false);
+	}
+}
+
+bool FileAudioSource::isActive() const
+{
+	return m_running;
+}
+
+void FileAudioSource::setInterval(int interval)
+{
+	m_interval = interval;
+}
+
+void FileAudioSource::setRealTime(bool realTime)
+{
+	m_realTime = realTime;
+}
+
+void FileAudioSource::readWave(QByteArray & block)
+{
+	float * samples = (float *)block.data();
+	const int count = block.size() / sizeof(float);
+	for (int i = 0; i < count; ++i)
+	{
+		samples[i] = m_samples.at(m_position);
+		m_position = (m_position + 1) % m_samples.size();
+	}
+}
+
+void FileAudioSource::run()
+{
+	RawReader raw(m_fileName);
+	QByteArray block;
+	auto next = std::chrono::steady_clock::now();
+	while (m_running)
+	{
+		//a block is as long as the capture interval
+		block.resize(m_format.bytesForDuration((qint64)m_interval * 1000));
+		if (m_isWave)
+		{
+			readWave(block);
+		}
+		else
+		{
+			//fill the block completely, so all blocks have the same duration
+			int filled = 0;
+			while (m_running && filled < block.size())
+			{
+				filled += raw.read(block.data() + filled, block.size() - filled);
+			}
+			if (!m_running)
+			{
+				break;
+			}
+		}
+		deliver(block, m_format);
+		//wait until the block would have been captured completely. absolute times keep the rate from drifting
+		const auto now = std::chrono::steady_clock::now();
+		if (m_realTime)
+		{
+			next += std::chrono::microseconds(m_format.durationForBytes(block.size()));
+			if (next < now - MaximumLag)
+			{
+				//fell behind, e.g. while waiting for a pipe writer. don't deliver the missed blocks in a burst
+				next = now;
+			}
+			std::this_thread::sleep_until(next);
+		}
+		else
+		{
+			next = now;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "AudioSource.h"
+
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <thread>
+
+
+/// @brief Plays a WAVE file or reads raw PCM from a file or named pipe as if it was captured from a sound card.
+/// Files ending in ".wav" are decoded completely when starting and loop forever. Everything else is read as raw
+/// signed 16-bit little-endian mono samples, e.g. from "ffmpeg -i song.flac -f s16le -ac 1 -ar 44100 /tmp/audio.fifo".
+/// Raw files restart at the end too. When the writer of a pipe closes it, the source waits for the next writer.
+/// Blocks are read and delivered in a thread of the source, either paced in real time or as fast as the receiver
+/// of dataReady() takes them. Connect with Qt::BlockingQueuedConnection to limit the speed to the analysis.
+class FileAudioSource : public AudioSource
+{
+	Q_OBJECT
+
+public:
+	/// @brief Constructor. WAVE files are decoded here. If that fails, format() is invalid and start() fails.
+	/// @param fileName WAVE file, raw PCM file or named pipe to read.
+	/// @param sampleRate Sample rate of raw PCM data. WAVE files use their own rate.
+	/// @param interval Time between two blocks in ms.
+	/// @param realTime If true, blocks are delivered at the rate they would be captured at, else as fast as possible.
+	FileAudioSource(const QString & fileName, int sampleRate, int interval, bool realTime, QObject * parent = 0);
+	~FileAudioSource();
+
+	QAudioFormat format() const;
+	/// @brief Start reading. Returns false if a WAVE file could not be decoded.
+	bool start();
+	void stop();
+	bool isActive() const;
+	void setInterval(int interval);
+
+	/// @brief Switch between real-time pacing and reading as fast as possible. Takes effect immediately.
+	void setRealTime(bool realTime);
+
+private:
+	void run();
+	/// @brief Fill a block with samples from the WAVE file, wrapping around at the end.
+	void readWave(QByteArray & block);
+
+	QString m_fileName;
+	QAudioFormat m_format;
+	bool m_isWave;
+	QVector<float> m_samples; //decoded WAVE samples
+	int m_position; //index of the next WAVE sample
+	std::atomic<int> m_interval;
+	std::atomic<bool> m_realTime;
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+};
@@ -0,0 +1,142 @@
+#include "FrameTimer.h"
+
+#include <QOpenGLContext>
+
+
+FrameTimer::FrameTimer()
+	: m_current(0)
+	, m_usesGPU(false)
+	, m_running(false)
+	, m_nextStage(0)
+	, m_hasResult(false)
+{
+	m_recordedSamples[0] = 0;
+	m_recordedSamples[1] = 0;
+	for (int i = 0; i < StageCount; ++i)
+	{
+		m_result[i] = 0.0f;
+	}
+}
+
+void FrameTimer::initialize()
+{
+	initializeOpenGLFunctions();
+	m_usesGPU = false;
+#if !defined(QT_OPENGL_ES_2)
+	//time monitors fail to create if the context has no timer queries, e.g. on OpenGL ES
+	QOpenGLContext * context = QOpenGLContext::currentContext();
+	if (context && !context->isOpenGLES())
+	{
+		m_usesGPU = true;
+		for (int i = 0; i < 2; ++i)
+		{
+			m_monitors[i].setSampleCount(StageCount + 1);
+			m_usesGPU = m_usesGPU && m_monitors[i].create();
+		}
+		if (!m_usesGPU)
+		{
+			destroy();
+		}
+	}
+#endif
+	m_current = 0;
+	m_recordedSamples[0] = 0;
+	m_recordedSamples[1] = 0;
+	m_running = false;
+	m_hasResult = false;
+}
+
+void FrameTimer::destroy()
+{
+#if !defined(QT_OPENGL_ES_2)
+	for (int i = 0; i < 2; ++i)
+	{
+		if (m_monitors[i].isCreated())
+		{
+			m_monitors[i].destroy();
+		}
+	}
+#endif
+	m_usesGPU = false;
+}
+
+bool FrameTimer::usesGPU() const
+{
+	return m_usesGPU;
+}
+
+void FrameTimer::begin()
+{
+	m_nextStage = 0;
+	m_running = true;
+#if !defined(QT_OPENGL_ES_2)
+	if (m_usesGPU)
+	{
+		//switch monitors. the other one holds the previous frame, this one the frame before it
+		m_current = 1 - m_current;
+		//only complete frames are read. querying a result that was never recorded is an OpenGL error
+		QOpenGLTimeMonitor & monitor = m_monitors[m_current];
+		if (m_recordedSamples[m_current] == StageCount + 1 && monitor.isResultAvailable())
+		{
+			const QVector<GLuint64> intervals = monitor.waitForIntervals();
+			for (int i = 0; i < StageCount; ++i)
+			{
+				m_result[i] = intervals.at(i) / 1.0e6f;
+			}
+			m_hasResult = true;
+		}
+		//results not ready after two frames are dropped
+		monitor.reset();
+		monitor.recordSample();
+		m_recordedSamples[m_current] = 1;
+		return;
+	}
+#endif
+	glFinish();
+	m_cpuTimer.start();
+	m_cpuMarks[0] = 0;
+}
+
+void FrameTimer::mark(Stage stage)
+{
+	//stages must be marked in order and each only once
+	if (!m_running || stage != m_nextStage)
+	{
+		return;
+	}
+	m_nextStage++;
+#if !defined(QT_OPENGL_ES_2)
+	if (m_usesGPU)
+	{
+		m_monitors[m_current].recordSample();
+		m_recordedSamples[m_current]++;
+		m_running = m_nextStage < StageCount;
+		return;
+	}
+#endif
+	glFinish();
+	m_cpuMarks[m_nextStage] = m_cpuTimer.nsecsElapsed();
+	if (m_nextStage >= StageCount)
+	{
+		for (int i = 0; i < StageCount; ++i)
+		{
+			m_result[i] = (m_cpuMarks[i + 1] - m_cpuMarks[i]) / 1.0e6f;
+		}
+		m_hasResult = true;
+		m_running = false;
+	}
+}
+
+bool FrameTimer::takeResult(float times[StageCount])
+{
+	if (!m_hasResult)
+	{
+		return false;
+	}
+	for (int i = 0; i < StageCount; ++i)
+	{
+		times[i] = m_result[i];
+	}
+	m_hasResult = false;
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QOpenGLFunctions>
+#include <QOpenGLTimeMonitor>
+#include <QElapsedTimer>
+
+
+/// @brief Measures how long the stages of rendering a frame take on the GPU.
+/// Uses timer queries (GL_ARB_timer_query / OpenGL 3.3) when available. Results of a frame are read two frames later,
+/// so measuring never waits for the GPU. Without timer queries the stages are timed on the CPU and glFinish() is called
+/// after every stage. This is exact too, but costs some throughput.
+/// Call begin() when starting a frame, then mark() once for every stage in order. Stages not rendered are marked anyway.
+class FrameTimer : protected QOpenGLFunctions
+{
+public:
+	enum Stage {
+		Render, ///< Rendering the effect script.
+		Resolve, ///< Resolving the supersampled image.
+		Readback, ///< Reading the image back to the CPU.
+		Blit, ///< Drawing the image to the widget.
+		StageCount
+	};
+
+	FrameTimer();
+
+	/// @brief Set up timer queries. Call with the context current the frames are rendered in.
+	void initialize();
+	/// @brief Release timer queries. Call with the context current.
+	void destroy();
+
+	/// @brief Retrieve true if stages are timed with GPU timer queries, false if timed on the CPU.
+	bool usesGPU() const;
+
+	/// @brief Start timing a frame.
+	void begin();
+	/// @brief Mark the end of a stage. The frame is complete when the last stage has been marked.
+	void mark(Stage stage);
+
+	/// @brief Retrieve the stage times of the newest measured frame, if it has not been retrieved yet.
+	/// @param times Receives the time of every stage in ms.
+	/// @return True if a new result was available.
+	bool takeResult(float times[StageCount]);
+
+private:
+	FrameTimer(const FrameTimer &);
+	FrameTimer & operator=(const FrameTimer &);
+
+#if !defined(QT_OPENGL_ES_2)
+	//two monitors are used alternately, so the results of the last frame are ready when they're read
+	QOpenGLTimeMonitor m_monitors[2];
+#endif
+	int m_current;
+	int m_recordedSamples[2];
+	bool m_usesGPU;
+	bool m_running;
+	QElapsedTimer m_cpuTimer;
+	qint64 m_cpuMarks[StageCount + 1];
+	int m_nextStage;
+	float m_result[StageCount];
+	bool m_hasResult;
+};
@@ -0,0 +1,189 @@
+#include "Image16.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <algorithm>
+
+
+Image16::Image16()
+	: m_width(0)
+	, m_height(0)
+{
+}
+
+Image16::Image16(int width, int height)
+	: m_width(width)
+	, m_height(height)
+	, m_data(width * height * 4)
+{
+}
+
+bool Image16::isNull() const
+{
+	return m_width <= 0 || m_height <= 0;
+}
+
+int Image16::width() const
+{
+	return m_width;
+}
+
+int Image16::height() const
+{
+	return m_height;
+}
+
+quint16 * Image16::scanLine(int y)
+{
+	return m_data.data() + y * m_width * 4;
+}
+
+const quint16 * Image16::constScanLine(int y) const
+{
+	return m_data.constData() + y * m_width * 4;
+}
+
+Image16 Image16::scaled(int width, int height) const
+{
+	if (isNull() || width <= 0 || height <= 0)
+	{
+		return Image16();
+	}
+	if (width == m_width && height == m_height)
+	{
+		return *this;
+	}
+	Image16 result(width, height);
+	for (int y = 0; y < height; ++y)
+	{
+		//source rows covered by this row. when upscaling this is a single row
+		const int y0 = y * m_height / height;
+		const int y1 = std::max((y + 1) * m_height / height, y0 + 1);
+		quint16 * destination = result.scanLine(y);
+		for (int x = 0; x < width; ++x)
+		{
+			const int x0 = x * m_width / width;
+			const int x1 = std::max((x + 1) * m_width / width, x0 + 1);
+			quint32 sum[4] = {0, 0, 0, 0};
+			for (int sy = y0; sy < y1; ++sy)
+			{
+				const quint16 * source = constScanLine(sy);
+				for (int sx = x0 * 4; sx < x1 * 4; sx += 4)
+				{
+					sum[0] += source[sx];
+					sum[1] += source[sx + 1];
+					sum[2] += source[sx + 2];
+					sum[3] += source[sx + 3];
+				}
+			}
+			const quint32 count = (x1 - x0) * (y1 - y0);
+			for (int c = 0; c < 4; ++c)
+			{
+				destination[x * 4 + c] = (quint16)((sum[c] + count / 2) / count);
+			}
+		}
+	}
+	return result;
+}
+
+Image16 Image16::mirrored(bool horizontal, bool vertical) const
+{
+	Image16 result(m_width, m_height);
+	for (int y = 0; y < m_height; ++y)
+	{
+		const quint16 * source = constScanLine(vertical ? m_height - 1 - y : y);
+		quint16 * destination = result.scanLine(y);
+		for (int x = 0; x < m_width; ++x)
+		{
+			const int sx = horizontal ? m_width - 1 - x : x;
+			std::copy(source + sx * 4, source + sx * 4 + 4, destination + x * 4);
+		}
+	}
+	return result;
+}
+
+QImage Image16::toImage() const
+{
+	if (isNull())
+	{
+		return QImage();
+	}
+	QImage result(m_width, m_height, QImage::Format_ARGB32);
+	for (int y = 0; y < m_height; ++y)
+	{
+		const quint16 * source = constScanLine(y);
+		QRgb * destination = (QRgb *)result.scanLine(y);
+		for (int x = 0; x < m_width; ++x)
+		{
+			//divide by 257 with rounding
+			destination[x] = qRgba((source[x * 4] + 128) / 257, (source[x * 4 + 1] + 128) / 257, (source[x * 4 + 2] + 128) / 257, (source[x * 4 + 3] + 128) / 257);
+		}
+	}
+	return result;
+}
+
+Image16 Image16::fromImage(const QImage & image)
+{
+	if (image.isNull())
+	{
+		return Image16();
+	}
+	const QImage argbImage = image.convertToFormat(QImage::Format_ARGB32);
+	Image16 result(argbImage.width(), argbImage.height());
+	for (int y = 0; y < argbImage.height(); ++y)
+	{
+		const QRgb * source = (const QRgb *)argbImage.constScanLine(y);
+		quint16 * destination = result.scanLine(y);
+		for (int x = 0; x < argbImage.width(); ++x)
+		{
+			//multiplying by 257 maps 255 to 65535
+			destination[x * 4] = qRed(source[x]) * 257;
+			destination[x * 4 + 1] = qGreen(source[x]) * 257;
+			destination[x * 4 + 2] = qBlue(source[x]) * 257;
+			destination[x * 4 + 3] = qAlpha(source[x]) * 257;
+		}
+	}
+	return result;
+}
+
+Image16 Image16::fromFrameBuffer(QOpenGLFramebufferObject * frameBuffer)
+{
+#if !defined(QT_OPENGL_ES_2)
+	QOpenGLContext * context = QOpenGLContext::currentContext();
+	if (context && !context->isOpenGLES() && frameBuffer->format().internalTextureFormat() == GL_RGBA16)
+	{
+		Image16 result(frameBuffer->width(), frameBuffer->height());
+		Image16 flipped(frameBuffer->width(), frameBuffer->height());
+		const bool wasBound = frameBuffer->isBound();
+		if (!wasBound)
+		{
+			frameBuffer->bind();
+		}
+		context->functions()->glReadPixels(0, 0, flipped.width(), flipped.height(), GL_RGBA, GL_UNSIGNED_SHORT, flipped.m_data.data());
+		if (!wasBound)
+		{
+			frameBuffer->release();
+		}
+		//OpenGL starts at the bottom row
+		for (int y = 0; y < result.height(); ++y)
+		{
+			const quint16 * source = flipped.constScanLine(result.height() - 1 - y);
+			std::copy(source, source + result.width() * 4, result.scanLine(y));
+		}
+		return result;
+	}
+#endif
+	return fromImage(frameBuffer->toImage());
+}
+
+GLenum Image16::frameBufferFormat()
+{
+#if !defined(QT_OPENGL_ES_2)
+	QOpenGLContext * context = QOpenGLContext::currentContext();
+	if (context && !context->isOpenGLES())
+	{
+		return GL_RGBA16;
+	}
+#endif
+	return QOpenGLFramebufferObjectFormat().internalTextureFormat();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QImage>
+#include <QVector>
+#include <QMetaType>
+#include <QOpenGLFramebufferObject>
+
+
+/// @brief Image with 16 bits per channel in the order R, G, B, A.
+/// Used for the output chain from the mixer to the LEDs, so dark gradients are not quantized to 8 bits before
+/// color correction. The data is implicitly shared like a QImage, so images can be passed around cheaply.
+class Image16
+{
+public:
+	Image16();
+	Image16(int width, int height);
+
+	bool isNull() const;
+	int width() const;
+	int height() const;
+	quint16 * scanLine(int y);
+	const quint16 * constScanLine(int y) const;
+
+	/// @brief Scale the image. Downscaling averages all pixels covered by a destination pixel.
+	Image16 scaled(int width, int height) const;
+	/// @brief Flip the image horizontally and / or vertically.
+	Image16 mirrored(bool horizontal, bool vertical) const;
+
+	/// @brief Round to an 8-bit image in Format_ARGB32.
+	QImage toImage() const;
+	/// @brief Expand an 8-bit image.
+	static Image16 fromImage(const QImage & image);
+	/// @brief Read back a frame buffer with the full precision it has. The frame buffer's context must be current.
+	/// Frame buffers created with frameBufferFormat() keep 16 bits per channel on desktop OpenGL.
+	static Image16 fromFrameBuffer(QOpenGLFramebufferObject * frameBuffer);
+	/// @brief Internal format for frame buffers that are read back with fromFrameBuffer().
+	/// This is GL_RGBA16 on desktop OpenGL and the default format on OpenGL ES, which has no 16-bit render targets.
+	/// The context the frame buffer is created in must be current.
+	static GLenum frameBufferFormat();
+
+private:
+	int m_width;
+	int m_height;
+	QVector<quint16> m_data;
+};
+
+Q_DECLARE_METATYPE(Image16)
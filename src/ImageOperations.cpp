@@ -1,5 +1,13 @@
 #include "ImageOperations.h"
 
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+#endif
+
 
 QImage & changeImage(QImage & image, float brightness, float contrast, float gamma)
 {
@@ -45,4 +53,96 @@ QImage & changeImage(QImage & image, float brightness, float contrast, float gam
 			break;
 	}
 	return image;
-}
\ No newline at end of file
+}
+
+void buildChangeTable(QVector<quint16> & table, float brightness, float contrast, float gamma)
+{
+	table.resize(65536);
+	for (int i = 0; i < table.size(); ++i)
+	{
+		float v = i / 65535.0f;
+		v = v + brightness;
+		v = ((v - 0.5f) * contrast) + 0.5f;
+		v = std::pow(kClamp(v, 0.0f, 1.0f), gamma);
+		table[i] = (quint16)(v * 65535.0f + 0.5f);
+	}
+}
+
+Image16 & changeImage(Image16 & image, const QVector<quint16> & table)
+{
+	const quint16 * lookup = table.constData();
+	for (int y = 0; y < image.height(); ++y)
+	{
+		quint16 * scanLine = image.scanLine(y);
+		for (int x = 0; x < image.width() * 4; x += 4)
+		{
+			scanLine[x] = lookup[scanLine[x]];
+			scanLine[x + 1] = lookup[scanLine[x + 1]];
+			scanLine[x + 2] = lookup[scanLine[x + 2]];
+		}
+	}
+	return image;
+}
+
+void ditherTo8Bit(const quint16 * source, quint16 * residual, unsigned char * destination, int count, quint16 scale)
+{
+	//scaling keeps the upper 16 bits of value * scale, so it is skipped when unscaled to keep 65535 intact
+	const bool scaled = scale != 65535;
+	//values are scaled to 8.8 fixed point with v - v / 256, which maps 65535 to 0xFF00 exactly.
+	//the residual is added and the upper byte is output. the lower byte is the error carried over
+	int i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128i half = _mm_set1_epi16(0x80);
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	const __m128i factor = _mm_set1_epi16((short)scale);
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(source + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(source + i + 8));
+		if (scaled)
+		{
+			a = _mm_mulhi_epu16(a, factor);
+			b = _mm_mulhi_epu16(b, factor);
+		}
+		a = _mm_sub_epi16(a, _mm_srli_epi16(a, 8));
+		b = _mm_sub_epi16(b, _mm_srli_epi16(b, 8));
+		a = _mm_add_epi16(a, residual ? _mm_loadu_si128((const __m128i *)(residual + i)) : half);
+		b = _mm_add_epi16(b, residual ? _mm_loadu_si128((const __m128i *)(residual + i + 8)) : half);
+		if (residual)
+		{
+			_mm_storeu_si128((__m128i *)(residual + i), _mm_and_si128(a, mask));
+			_mm_storeu_si128((__m128i *)(residual + i + 8), _mm_and_si128(b, mask));
+		}
+		_mm_storeu_si128((__m128i *)(destination + i), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const uint16x8_t half = vdupq_n_u16(0x80);
+	const uint16x8_t mask = vdupq_n_u16(0xFF);
+	const uint16x4_t factor = vdup_n_u16(scale);
+	for (; i + 8 <= count; i += 8)
+	{
+		uint16x8_t a = vld1q_u16(source + i);
+		if (scaled)
+		{
+			a = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(a), factor), 16), vshrn_n_u32(vmull_u16(vget_high_u16(a), factor), 16));
+		}
+		a = vsubq_u16(a, vshrq_n_u16(a, 8));
+		a = vaddq_u16(a, residual ? vld1q_u16(residual + i) : half);
+		if (residual)
+		{
+			vst1q_u16(residual + i, vandq_u16(a, mask));
+		}
+		vst1_u8(destination + i, vshrn_n_u16(a, 8));
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const quint16 v = scaled ? (quint16)(((quint32)source[i] * scale) >> 16) : source[i];
+		const quint16 value = (quint16)(v - (v >> 8) + (residual ? residual[i] : 0x80));
+		if (residual)
+		{
+			residual[i] = value & 0xFF;
+		}
+		destination[i] = (unsigned char)(value >> 8);
+	}
+}
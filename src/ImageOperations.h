@@ -1,7 +1,9 @@
 #pragma once
 
 #include "ColorOperations.h"
+#include "Image16.h"
 #include <QImage>
+#include <QVector>
 
 
 /// @brief Change image brightness, contrast and gamma value.
@@ -11,3 +13,28 @@
 /// @param gamma Gamma factor to apply to image.
 /// @return Updated image.
 QImage & changeImage(QImage & image, float brightness, float contrast, float gamma);
+
+
+/// @brief Build a table mapping 16-bit values to brightness, contrast and gamma changed 16-bit values.
+/// @param table Table to build. Resized to 65536 entries.
+/// @param brightness Brightness offset to add to image.
+/// @param contrast Factor to multiply image by.
+/// @param gamma Gamma factor to apply to image.
+void buildChangeTable(QVector<quint16> & table, float brightness, float contrast, float gamma);
+
+/// @brief Change image brightness, contrast and gamma value using a table built with buildChangeTable().
+/// @param image Image to change.
+/// @param table Table to map the color channels with.
+/// @return Updated image.
+Image16 & changeImage(Image16 & image, const QVector<quint16> & table);
+
+/// @brief Reduce 16-bit values to 8 bits with temporal error diffusion.
+/// The part of a value that can not be shown with 8 bits is carried over to the next frame, so the average over
+/// several frames has the full precision. Uses SSE2 or NEON if available.
+/// @param source 16-bit values.
+/// @param residual Error carried over per value. Initialize to 0x80 and pass the same array every frame.
+/// Pass nullptr to round without dithering.
+/// @param destination 8-bit values.
+/// @param count Number of values.
+/// @param scale Factor to scale the values with before reducing them, where 65535 means unscaled.
+void ditherTo8Bit(const quint16 * source, quint16 * residual, unsigned char * destination, int count, quint16 scale = 65535);
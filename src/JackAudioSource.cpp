@@ -0,0 +1,159 @@
+#include "JackAudioSource.h"
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+
+const char * JackAudioSource::DeviceName = "JACK";
+const int JackAudioSource::BlockFrames;
+
+JackAudioSource::JackAudioSource(QObject * parent)
+	: AudioSource(parent)
+	, m_client(nullptr)
+	, m_port(nullptr)
+	, m_droppedFrames(0)
+	, m_running(false)
+	, m_serverGone(false)
+{
+	jack_status_t status;
+	m_client = jack_client_open("NerDisco", JackNoStartServer, &status);
+	if (m_client)
+	{
+		m_port = jack_port_register(m_client, "input", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+		if (m_port)
+		{
+			jack_set_process_callback(m_client, processCallback, this);
+			jack_on_shutdown(m_client, shutdownCallback, this);
+			//JACK always uses mono 32-bit float ports
+			m_format.setSampleRate((int)jack_get_sample_rate(m_client));
+			m_format.setChannelCount(1);
+			m_format.setSampleSize(32);
+			m_format.setCodec("audio/pcm");
+			m_format.setByteOrder(QAudioFormat::LittleEndian);
+			m_format.setSampleType(QAudioFormat::Float);
+		}
+	}
+}
+
+JackAudioSource::~JackAudioSource()
+{
+	stop();
+	if (m_client)
+	{
+		jack_client_close(m_client);
+	}
+}
+
+QAudioFormat JackAudioSource::format() const
+{
+	return m_format;
+}
+
+bool JackAudioSource::start()
+{
+	if (m_thread.joinable())
+	{
+		return true;
+	}
+	if (!m_client || !m_port || m_serverGone || jack_activate(m_client) != 0)
+	{
+		return false;
+	}
+	//connect to the first capture port. ports can only be connected while the client is active
+	const char ** ports = jack_get_ports(m_client, nullptr, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsOutput);
+	if (ports)
+	{
+		if (ports[0])
+		{
+			jack_connect(m_client, ports[0], jack_port_name(m_port));
+		}
+		jack_free(ports);
+	}
+	m_droppedFrames = 0;
+	m_running = true;
+	m_thread = std::thread(&JackAudioSource::run, this);
+	emit activeChanged(true);
+	return true;
+}
+
+void JackAudioSource::stop()
+{
+	if (m_thread.joinable())
+	{
+		m_running = false;
+		m_thread.join();
+		if (!m_serverGone)
+		{
+			jack_deactivate(m_client);
+		}
+		//throw away what was not delivered anymore
+		Block block;
+		while (m_blocks.pop(block))
+		{
+		}
+		emit activeChanged(false);
+	}
+}
+
+bool JackAudioSource::isActive() const
+{
+	return m_running;
+}
+
+void JackAudioSource::setInterval(int /*interval*/)
+{
+}
+
+int JackAudioSource::processCallback(jack_nframes_t frames, void * userData)
+{
+	//this runs in the real-time thread of the server. only copy the samples
+	JackAudioSource * source = reinterpret_cast<JackAudioSource *>(userData);
+	const float * input = (const float *)jack_port_get_buffer(source->m_port, frames);
+	Block block;
+	for (jack_nframes_t start = 0; start < frames; start += BlockFrames)
+	{
+		block.frames = (int)std::min<jack_nframes_t>(BlockFrames, frames - start);
+		memcpy(block.samples, input + start, block.frames * sizeof(float));
+		if (!source->m_blocks.push(block))
+		{
+			source->m_droppedFrames.fetch_add(block.frames, std::memory_order_relaxed);
+		}
+	}
+	return 0;
+}
+
+void JackAudioSource::shutdownCallback(void * userData)
+{
+	//the server is gone. the delivering thread stops the source
+	JackAudioSource * source = reinterpret_cast<JackAudioSource *>(userData);
+	source->m_serverGone = true;
+}
+
+void JackAudioSource::run()
+{
+	//look for new blocks twice per period
+	const int64_t periodUs = (int64_t)jack_get_buffer_size(m_client) * 1000000 / std::max(m_format.sampleRate(), 1);
+	const std::chrono::microseconds wait(std::max<int64_t>(periodUs / 2, 500));
+	Block block;
+	while (m_running && !m_serverGone)
+	{
+		QByteArray data;
+		while (m_blocks.pop(block))
+		{
+			data.append((const char *)block.samples, block.frames * sizeof(float));
+		}
+		//64-bit atomics might not be lock-free, so lost frames are counted here instead of in the callback
+		loseFrames(m_droppedFrames.exchange(0));
+		if (!data.isEmpty())
+		{
+			deliver(data, m_format);
+		}
+		std::this_thread::sleep_for(wait);
+	}
+	if (m_serverGone)
+	{
+		m_running = false;
+		emit activeChanged(false);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "AudioSource.h"
+#include "SPSCRing.h"
+
+#include <atomic>
+#include <thread>
+#include <jack/jack.h>
+
+
+/// @brief Captures audio from a JACK server, e.g. jackd or PipeWire through its JACK library, one period at a time.
+/// The process callback of the server copies every period into a lock-free ring and never blocks or allocates.
+/// A thread of the source collects the blocks about twice per period and delivers them, so the latency is about one
+/// period instead of the capture interval. Set the server to 64-256 frames per period for low latency.
+/// The input port is connected to the first physical capture port. Rewire it with any JACK patchbay if needed.
+/// Only available if NerDisco was configured with WITH_JACK.
+class JackAudioSource : public AudioSource
+{
+	Q_OBJECT
+
+public:
+	/// @brief Name of the source in the list of capture devices.
+	static const char * DeviceName;
+	/// @brief Maximum number of frames in a block. Longer periods are split into several blocks.
+	static const int BlockFrames = 256;
+
+	/// @brief Constructor. Connects to a running JACK server, but does not start one.
+	/// If no server is running, format() is invalid and start() fails.
+	JackAudioSource(QObject * parent = 0);
+	~JackAudioSource();
+
+	QAudioFormat format() const;
+	bool start();
+	void stop();
+	bool isActive() const;
+	/// @brief Does nothing. The block size is the period of the JACK server.
+	void setInterval(int interval);
+
+private:
+	struct Block
+	{
+		float samples[BlockFrames];
+		int frames;
+	};
+
+	static int processCallback(jack_nframes_t frames, void * userData);
+	static void shutdownCallback(void * userData);
+	void run();
+
+	jack_client_t * m_client;
+	jack_port_t * m_port;
+	QAudioFormat m_format;
+	//blocks written by the process callback and read by the delivering thread
+	SPSCRing<Block, 64> m_blocks;
+	std::atomic<int> m_droppedFrames; //frames that did not fit into the ring and are not counted as lost yet
+	std::atomic<bool> m_running;
+	std::atomic<bool> m_serverGone;
+	std::thread m_thread;
+};
@@ -0,0 +1,397 @@
+#include "LEDStream.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+
+
+//runs are at most this long, so the length fits into 7 bits
+static const int MaximumRunLength = 128;
+//with reduced color, LEDs closer than this to what the device shows are not sent again.
+//quantization of the shared chroma would otherwise make them change in every frame
+static const int ReducedColorTolerance = 3;
+
+LEDStreamEncoder::LEDStreamEncoder()
+	: m_keyFrameRequested(true)
+	, m_lastReducedColor(false)
+	, m_keyFrameInterval(50)
+	, m_framesSinceKeyFrame(0)
+{
+}
+
+QByteArray LEDStreamEncoder::encodeAdalight(const QByteArray & colors)
+{
+	const unsigned int count = colors.size() / 3;
+	const unsigned char hi = (count >> 8) & 0xFF;
+	const unsigned char lo = count & 0xFF;
+	QByteArray data;
+	data.reserve(6 + colors.size());
+	data.append("Ada");
+	data.append(hi);
+	data.append(lo);
+	data.append(hi ^ lo ^ 0x55);
+	data.append(colors);
+	return data;
+}
+
+QByteArray LEDStreamEncoder::encode(const QByteArray & colors, bool reducedColor)
+{
+	const int count = colors.size() / 3;
+	//decide if the device state is known well enough to send differences
+	const bool keyFrame = m_keyFrameRequested || m_deviceColors.size() != count * 3 || reducedColor != m_lastReducedColor
+		|| (m_keyFrameInterval > 0 && m_framesSinceKeyFrame >= m_keyFrameInterval);
+	if (keyFrame)
+	{
+		//the device clears all LEDs before decoding a key frame
+		m_deviceColors.fill(0, count * 3);
+		m_keyFrameRequested = false;
+		m_framesSinceKeyFrame = 0;
+	}
+	m_lastReducedColor = reducedColor;
+	++m_framesSinceKeyFrame;
+	//build header
+	const unsigned char hi = (count >> 8) & 0xFF;
+	const unsigned char lo = count & 0xFF;
+	const unsigned char flags = (keyFrame ? KeyFrame : 0) | (reducedColor ? ReducedColorFrame : 0);
+	QByteArray data;
+	data.reserve(9 + colors.size() + colors.size() / MaximumRunLength + 1);
+	data.append("Adx");
+	data.append(hi);
+	data.append(lo);
+	data.append(flags);
+	data.append(hi ^ lo ^ flags ^ 0x55);
+	//find runs of changed and unchanged LEDs
+	const int tolerance = reducedColor ? ReducedColorTolerance : 0;
+	const uint8_t * source = (const uint8_t *)colors.constData();
+	//data() detaches the array now, so the pointer stays valid when appendRun() writes to it
+	const uint8_t * device = (const uint8_t *)m_deviceColors.data();
+	int runStart = 0;
+	bool runChanged = false;
+	for (int i = 0; i <= count; ++i)
+	{
+		bool changed = false;
+		if (i < count)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				changed = changed || std::abs((int)source[i * 3 + c] - (int)device[i * 3 + c]) > tolerance;
+			}
+		}
+		//close the current run if the state changes, the run is full or all LEDs have been checked
+		if (i > runStart && (i == count || changed != runChanged || i - runStart == MaximumRunLength))
+		{
+			appendRun(data, runStart, i - runStart, runChanged, colors, reducedColor);
+			runStart = i;
+		}
+		if (i == runStart)
+		{
+			runChanged = changed;
+		}
+	}
+	//append checksum of what the device should show now
+	const uint16_t sum = checksum((const uint8_t *)m_deviceColors.constData(), m_deviceColors.size());
+	data.append((sum >> 8) & 0xFF);
+	data.append(sum & 0xFF);
+	return data;
+}
+
+void LEDStreamEncoder::appendRun(QByteArray & data, int start, int length, bool changed, const QByteArray & colors, bool reducedColor)
+{
+	if (!changed)
+	{
+		data.append(0x80 | (length - 1));
+		return;
+	}
+	data.append(length - 1);
+	const uint8_t * source = (const uint8_t *)colors.constData() + start * 3;
+	uint8_t * device = (uint8_t *)m_deviceColors.data() + start * 3;
+	if (!reducedColor)
+	{
+		data.append((const char *)source, length * 3);
+		std::copy(source, source + length * 3, device);
+		return;
+	}
+	//send pairs with shared chroma and decode them like the device does
+	int i = 0;
+	for (; i + 1 < length; i += 2)
+	{
+		int y0, co0, cg0, y1, co1, cg1;
+		toYCoCg(source + i * 3, y0, co0, cg0);
+		toYCoCg(source + i * 3 + 3, y1, co1, cg1);
+		const uint8_t co = quantizeChroma((co0 + co1) / 2);
+		const uint8_t cg = quantizeChroma((cg0 + cg1) / 2);
+		data.append((char)y0);
+		data.append((char)y1);
+		data.append((char)co);
+		data.append((char)cg);
+		fromYCoCg(y0, co, cg, device + i * 3);
+		fromYCoCg(y1, co, cg, device + i * 3 + 3);
+	}
+	if (i < length)
+	{
+		int y, co, cg;
+		toYCoCg(source + i * 3, y, co, cg);
+		data.append((char)y);
+		data.append((char)quantizeChroma(co));
+		data.append((char)quantizeChroma(cg));
+		fromYCoCg(y, quantizeChroma(co), quantizeChroma(cg), device + i * 3);
+	}
+}
+
+void LEDStreamEncoder::reset()
+{
+	m_keyFrameRequested = true;
+}
+
+void LEDStreamEncoder::setKeyFrameInterval(int interval)
+{
+	m_keyFrameInterval = interval;
+}
+
+const QByteArray & LEDStreamEncoder::deviceColors() const
+{
+	return m_deviceColors;
+}
+
+bool LEDStreamEncoder::parseDeviceMessages(QByteArray & received, int & capabilities, int & acknowledged)
+{
+	bool keyFrameRequested = false;
+	while (!received.isEmpty())
+	{
+		//skip to the start of the next message
+		const int start = received.indexOf('A');
+		if (start < 0)
+		{
+			received.clear();
+			break;
+		}
+		received.remove(0, start);
+		if (received.startsWith("Adk\n"))
+		{
+			keyFrameRequested = true;
+			received.remove(0, 4);
+		}
+		else if (received.startsWith("Adr\n"))
+		{
+			acknowledged++;
+			received.remove(0, 4);
+		}
+		else if (received.startsWith("Ada\n"))
+		{
+			received.remove(0, 4);
+		}
+		else if (received.startsWith("Adx") && received.size() >= 5 && received.at(4) == '\n' && isxdigit((unsigned char)received.at(3)))
+		{
+			capabilities = QByteArray(1, received.at(3)).toInt(nullptr, 16);
+			received.remove(0, 5);
+		}
+		else if (received.size() < 5 && (QByteArray("Adk\n").startsWith(received) || QByteArray("Adr\n").startsWith(received) || QByteArray("Ada\n").startsWith(received) || QByteArray("Adx").startsWith(received.left(3))))
+		{
+			//message is incomplete. wait for the rest
+			break;
+		}
+		else
+		{
+			received.remove(0, 1);
+		}
+	}
+	if (keyFrameRequested)
+	{
+		m_keyFrameRequested = true;
+	}
+	return keyFrameRequested;
+}
+
+uint16_t LEDStreamEncoder::checksum(const uint8_t * data, int size)
+{
+	//Fletcher-style checksum modulo 256, which is cheap on 8-bit microcontrollers
+	uint8_t sum1 = 0;
+	uint8_t sum2 = 0;
+	for (int i = 0; i < size; ++i)
+	{
+		sum1 += data[i];
+		sum2 += sum1;
+	}
+	return (sum2 << 8) | sum1;
+}
+
+void LEDStreamEncoder::toYCoCg(const uint8_t * color, int & y, int & co, int & cg)
+{
+	const int g = color[0];
+	const int r = color[1];
+	const int b = color[2];
+	co = r - b;
+	const int t = b + (co >> 1);
+	cg = g - t;
+	y = t + (cg >> 1);
+}
+
+uint8_t LEDStreamEncoder::quantizeChroma(int chroma)
+{
+	return (uint8_t)std::min(std::max((chroma + 257) >> 1, 0), 255);
+}
+
+void LEDStreamEncoder::fromYCoCg(int y, uint8_t co, uint8_t cg, uint8_t * color)
+{
+	const int coValue = (int)co * 2 - 256;
+	const int cgValue = (int)cg * 2 - 256;
+	const int t = y - (cgValue >> 1);
+	const int g = cgValue + t;
+	const int b = t - (coValue >> 1);
+	const int r = b + coValue;
+	color[0] = (uint8_t)std::min(std::max(g, 0), 255);
+	color[1] = (uint8_t)std::min(std::max(r, 0), 255);
+	color[2] = (uint8_t)std::min(std::max(b, 0), 255);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+LEDStreamDecoder::LEDStreamDecoder(int ledCount)
+	: m_colors(ledCount * 3, 0)
+{
+}
+
+bool LEDStreamDecoder::decode(const QByteArray & frame)
+{
+	const uint8_t * data = (const uint8_t *)frame.constData();
+	const int size = frame.size();
+	const int ledCount = m_colors.size() / 3;
+	uint8_t * leds = (uint8_t *)m_colors.data();
+	if (size >= 6 && frame.startsWith("Ada"))
+	{
+		const int count = (data[3] << 8) | data[4];
+		if (data[5] != (data[3] ^ data[4] ^ 0x55) || size != 6 + count * 3)
+		{
+			return false;
+		}
+		m_colors.fill(0);
+		std::copy(data + 6, data + 6 + std::min(count, ledCount) * 3, leds);
+		return true;
+	}
+	if (size < 9 || !frame.startsWith("Adx") || data[6] != (data[3] ^ data[4] ^ data[5] ^ 0x55))
+	{
+		return false;
+	}
+	const int count = (data[3] << 8) | data[4];
+	const uint8_t flags = data[5];
+	if (flags & LEDStreamEncoder::KeyFrame)
+	{
+		m_colors.fill(0);
+	}
+	//decode runs. LEDs the device does not have are read, but dropped
+	int position = 7;
+	int led = 0;
+	uint8_t dropped[6];
+	while (led < count)
+	{
+		if (position >= size)
+		{
+			return false;
+		}
+		const uint8_t control = data[position++];
+		int length = (control & 0x7F) + 1;
+		if (control & 0x80)
+		{
+			led += length;
+			continue;
+		}
+		if (flags & LEDStreamEncoder::ReducedColorFrame)
+		{
+			for (; length >= 2; length -= 2, led += 2, position += 4)
+			{
+				if (position + 4 > size)
+				{
+					return false;
+				}
+				LEDStreamEncoder::fromYCoCg(data[position], data[position + 2], data[position + 3], led < ledCount ? leds + led * 3 : dropped);
+				LEDStreamEncoder::fromYCoCg(data[position + 1], data[position + 2], data[position + 3], led + 1 < ledCount ? leds + led * 3 + 3 : dropped + 3);
+			}
+			if (length == 1)
+			{
+				if (position + 3 > size)
+				{
+					return false;
+				}
+				LEDStreamEncoder::fromYCoCg(data[position], data[position + 1], data[position + 2], led < ledCount ? leds + led * 3 : dropped);
+				led++;
+				position += 3;
+			}
+		}
+		else
+		{
+			for (; length > 0; --length, ++led, position += 3)
+			{
+				if (position + 3 > size)
+				{
+					return false;
+				}
+				if (led < ledCount)
+				{
+					std::copy(data + position, data + position + 3, leds + led * 3);
+				}
+			}
+		}
+	}
+	if (led != count || position + 2 != size)
+	{
+		return false;
+	}
+	//the checksum covers all LEDs sent, so it can only be checked if the device has all of them
+	const uint16_t sum = (data[position] << 8) | data[position + 1];
+	return count > ledCount || sum == LEDStreamEncoder::checksum(leds, count * 3);
+}
+
+int LEDStreamDecoder::frameLength(const QByteArray & data)
+{
+	const uint8_t * bytes = (const uint8_t *)data.constData();
+	const int size = data.size();
+	if (size < 3)
+	{
+		return QByteArray("Ada").startsWith(data) || QByteArray("Adx").startsWith(data) ? 0 : -1;
+	}
+	if (data.startsWith("Ada"))
+	{
+		if (size < 6)
+		{
+			return 0;
+		}
+		return bytes[5] == (bytes[3] ^ bytes[4] ^ 0x55) ? 6 + ((bytes[3] << 8) | bytes[4]) * 3 : -1;
+	}
+	if (!data.startsWith("Adx"))
+	{
+		return -1;
+	}
+	if (size < 7)
+	{
+		return 0;
+	}
+	if (bytes[6] != (bytes[3] ^ bytes[4] ^ bytes[5] ^ 0x55))
+	{
+		return -1;
+	}
+	//walk the runs to find the end of the frame
+	const int count = (bytes[3] << 8) | bytes[4];
+	const bool reducedColor = (bytes[5] & LEDStreamEncoder::ReducedColorFrame) != 0;
+	int position = 7;
+	for (int led = 0; led < count;)
+	{
+		if (position >= size)
+		{
+			return 0;
+		}
+		const uint8_t control = bytes[position++];
+		const int length = (control & 0x7F) + 1;
+		if (!(control & 0x80))
+		{
+			position += reducedColor ? (length / 2) * 4 + (length & 1) * 3 : length * 3;
+		}
+		led += length;
+	}
+	//add frame checksum
+	return position + 2 <= size ? position + 2 : 0;
+}
+
+const QByteArray & LEDStreamDecoder::colors() const
+{
+	return m_colors;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QByteArray>
+#include <cstdint>
+
+
+/// @brief Encoder for the LED serial protocols understood by the LEDStream firmware.
+/// The Adalight protocol ("Ada") sends every LED in every frame. The extended protocol ("Adx") sends only LEDs
+/// that changed since the previous frame, as runs of unchanged and changed LEDs, and can optionally share the
+/// chroma of two neighbouring LEDs (similar to 4:2:2 chroma subsampling) to save another third of the data.
+/// Extended frame layout:
+/// "Adx", LED count high byte, LED count low byte, flags, header checksum (count bytes XOR flags XOR 0x55),
+/// runs, frame checksum high byte, frame checksum low byte.
+/// A run starts with a control byte. Bit 7 set means (control & 0x7F) + 1 LEDs are unchanged. Bit 7 clear means
+/// (control & 0x7F) + 1 LEDs follow. With full color these are 3 bytes per LED. With reduced color pairs of LEDs are
+/// sent as Y0, Y1, Co, Cg and a single remaining LED as Y, Co, Cg (see ReducedColor).
+/// The frame checksum is computed over the decoded frame, so the device can detect a frame that was decoded against
+/// a wrong previous frame, e.g. after a transmission error. It then sends "Adk\n" to request a key frame.
+/// Devices announce the extended protocol with "Adx" followed by a hexadecimal capability digit and "\n".
+/// Devices with the Acknowledge capability send "Adr\n" after showing a frame, so the host never sends faster than
+/// the device can display.
+/// Color bytes are opaque for full color. For reduced color they are expected in the order NerDisco sends them: G, R, B.
+class LEDStreamEncoder
+{
+public:
+	enum Capability {
+		DeltaCoding = 0x01, ///< Device decodes "Adx" frames with runs of unchanged LEDs.
+		ReducedColor = 0x02, ///< Device decodes pairs of LEDs with shared chroma.
+		Acknowledge = 0x04 ///< Device acknowledges every frame shown.
+	};
+
+	enum Flag {
+		KeyFrame = 0x01, ///< Frame is decoded against black instead of the previous frame.
+		ReducedColorFrame = 0x02 ///< Changed LEDs are sent with shared chroma.
+	};
+
+	LEDStreamEncoder();
+
+	/// @brief Build an Adalight frame sending all LEDs.
+	/// @param colors 3 bytes per LED in the order they're sent.
+	static QByteArray encodeAdalight(const QByteArray & colors);
+
+	/// @brief Build an extended frame, sending only LEDs that differ from the state the device has.
+	/// A key frame is sent for the first frame, after reset(), when the LED count or color mode changes,
+	/// when requested by the device and every keyFrameInterval frames.
+	/// @param colors 3 bytes per LED in the order they're sent.
+	/// @param reducedColor Pass true to send pairs of LEDs with shared chroma.
+	QByteArray encode(const QByteArray & colors, bool reducedColor = false);
+
+	/// @brief Forget the state of the device. The next frame will be a key frame.
+	void reset();
+
+	/// @brief Send a key frame every interval frames, so the device recovers from lost data even if it can't answer.
+	void setKeyFrameInterval(int interval);
+
+	/// @brief Retrieve the LED colors the device shows after decoding the last frame.
+	const QByteArray & deviceColors() const;
+
+	/// @brief Parse data received from the device for capability announcements, acknowledgements and key frame requests.
+	/// Parsed messages are removed from received. Incomplete messages are kept.
+	/// @param received Data received from the device. Data that is not a message is dropped.
+	/// @param capabilities Set to the capabilities announced if an announcement was found.
+	/// @param acknowledged Number of frames the device acknowledged is added to this.
+	/// @return True if the device requested a key frame.
+	bool parseDeviceMessages(QByteArray & received, int & capabilities, int & acknowledged);
+
+	/// @brief Checksum over decoded LED colors, as computed by the firmware.
+	static uint16_t checksum(const uint8_t * data, int size);
+
+	/// @brief Reduce colors to luma and chroma. Same as YCoCg-R, but with the channel order G, R, B.
+	static void toYCoCg(const uint8_t * color, int & y, int & co, int & cg);
+	/// @brief Quantize a chroma value in [-255,255] to a byte.
+	static uint8_t quantizeChroma(int chroma);
+	/// @brief Decode luma and quantized chroma to a color as the firmware does.
+	static void fromYCoCg(int y, uint8_t co, uint8_t cg, uint8_t * color);
+
+private:
+	void appendRun(QByteArray & data, int start, int length, bool changed, const QByteArray & colors, bool reducedColor);
+
+	QByteArray m_deviceColors;
+	bool m_keyFrameRequested;
+	bool m_lastReducedColor;
+	int m_keyFrameInterval;
+	int m_framesSinceKeyFrame;
+};
+
+/// @brief Decodes frames like the LEDStream firmware does. Used to verify the encoder.
+class LEDStreamDecoder
+{
+public:
+	/// @brief Constructor.
+	/// @param ledCount Number of LEDs of the simulated device.
+	LEDStreamDecoder(int ledCount);
+
+	/// @brief Decode one complete "Ada" or "Adx" frame.
+	/// @return False if the frame is malformed or its checksum does not match the decoded colors.
+	bool decode(const QByteArray & frame);
+
+	/// @brief Find the length of the frame at the start of a stream of data.
+	/// @return The frame length in bytes, 0 if more data is needed to tell or -1 if the data does not start with a valid frame header.
+	static int frameLength(const QByteArray & data);
+
+	/// @brief Retrieve the colors of all LEDs, 3 bytes per LED.
+	const QByteArray & colors() const;
+
+private:
+	QByteArray m_colors;
+};
@@ -1,7 +1,10 @@
 #include "LiveView.h"
+#include "Image16.h"
+#include "AudioFeatures.h"
 
 #include <QResizeEvent>
 #include <QDebug>
+#include <algorithm>
 
 
 
@@ -61,6 +64,27 @@ void main() {\n\
 	//gl_FragColor = vec4(texcoordVar, 0.0, 1.0);\n\
 }";
 
+const char * LiveView::m_resolveFragmentCode = "\
+uniform sampler2D frameBufferTexture;\n\
+uniform vec2 sourceTexelSize;\n\
+uniform int superSampling;\n\
+\n\
+varying vec2 texcoordVar;\n\
+\n\
+void main() {\n\
+	//step from the center of the destination pixel to the center of the first source sample\n\
+	vec2 start = texcoordVar - sourceTexelSize * (float(superSampling) - 1.0) * 0.5;\n\
+	vec4 sum = vec4(0.0);\n\
+	for (int y = 0; y < 8; ++y) {\n\
+		if (y >= superSampling) break;\n\
+		for (int x = 0; x < 8; ++x) {\n\
+			if (x >= superSampling) break;\n\
+			sum += texture2D(frameBufferTexture, start + vec2(float(x), float(y)) * sourceTexelSize);\n\
+		}\n\
+	}\n\
+	gl_FragColor = sum / float(superSampling * superSampling);\n\
+}";
+
 
 LiveView::LiveView(QWidget * parent)
 	: QOpenGLWidget(parent)
@@ -69,6 +93,8 @@ LiveView::LiveView(QWidget * parent)
 	, m_shaderProgram(nullptr)
 	, m_fragmentScript(m_defaultFragmentCode)
 	, m_scriptChanged(false)
+	, m_audioFeatures(0)
+	, m_compiledAudioFeatures(0)
 //	, m_swapThread(nullptr)
 	, m_compileThread(nullptr)
 	, m_asynchronousCompilation(false)
@@ -80,8 +106,13 @@ LiveView::LiveView(QWidget * parent)
 	, m_frameBufferShaderProgram(nullptr)
 	, m_frameBufferWidth(-1)
 	, m_frameBufferHeight(-1)
+	, m_previewWidth(-1)
+	, m_previewHeight(-1)
+	, m_superSampling(1)
 	, m_keepAspect(false)
 	, m_frameBufferObject(nullptr)
+	, m_resolveFrameBufferObject(nullptr)
+	, m_resolveShaderProgram(nullptr)
 {
 	//create buffer swapping thread
 	//m_swapThread = new SwapThread(this);
@@ -94,6 +125,7 @@ LiveView::~LiveView()
 {
 	//make context current so resources can be released
 	makeCurrent();
+	m_frameTimer.destroy();
 	delete m_vertexShader;
 	delete m_fragmentShader;
 	delete m_shaderProgram;
@@ -101,6 +133,8 @@ LiveView::~LiveView()
 	delete m_frameBufferFragmentShader;
 	delete m_frameBufferShaderProgram;
 	delete m_frameBufferObject;
+	delete m_resolveShaderProgram;
+	delete m_resolveFrameBufferObject;
 	doneCurrent();
 }
 
@@ -111,15 +145,30 @@ bool LiveView::hasHeightForWidth() const
 
 int LiveView::heightForWidth(int width) const
 {
-	return ((qreal)m_frameBufferHeight * (qreal)width / (qreal)m_frameBufferWidth);
+	return ((qreal)m_previewHeight * (qreal)width / (qreal)m_previewWidth);
 }
 
 QSize LiveView::sizeHint() const
 {
-	int w = m_frameBufferWidth;
+	int w = m_previewWidth;
 	return QSize(w, heightForWidth(w));
 }
 
+void LiveView::setPreviewSize(int width, int height)
+{
+	m_previewWidth = width;
+	m_previewHeight = height;
+	//update widget geometry
+	updateGeometry();
+}
+
+void LiveView::setSuperSampling(int factor)
+{
+	QMutexLocker locker(&m_grabMutex);
+	//clamp to what the resolve shader can handle
+	m_superSampling = std::max(1, std::min(8, factor));
+}
+
 void LiveView::setRenderSize(int width, int height)
 {
 	m_frameBufferWidth = width;
@@ -135,8 +184,11 @@ void LiveView::setRenderSize(int width, int height)
 	{
 		m_projectionMatrix.ortho(-0.5f, 0.5f, -0.5f / aspect, 0.5f / aspect, 0.0f, 10.0f);
 	}
-	//update widget geometry
-	updateGeometry();
+	//if no preview size has been set, use the render size
+	if (m_previewWidth == -1 || m_previewHeight == -1)
+	{
+		setPreviewSize(width, height);
+	}
 }
 
 QSurfaceFormat LiveView::getDefaultFormat()
@@ -154,6 +206,21 @@ QSurfaceFormat LiveView::getDefaultFormat()
 	return format;
 }
 
+QString LiveView::vertexShaderCode(bool openGLES)
+{
+	return QString(openGLES ? m_vertexPrefixGLES2 : m_vertexPrefixGL2) + m_defaultVertexCode;
+}
+
+QString LiveView::fragmentScriptPrefix(bool openGLES)
+{
+	return openGLES ? m_fragmentPrefixGLES2 : m_fragmentPrefixGL2;
+}
+
+QString LiveView::resolveFragmentCode(bool openGLES)
+{
+	return fragmentScriptPrefix(openGLES) + m_resolveFragmentCode;
+}
+
 void LiveView::enableAsynchronousCompilation(bool enabled)
 {
 	m_asynchronousCompilation = enabled;
@@ -206,6 +273,8 @@ void LiveView::initializeGL()
 		m_fragmentPrefix = context()->isOpenGLES() ? m_fragmentPrefixGLES2 : m_fragmentPrefixGL2;
 		//initialize opengl function bindings
 		initializeOpenGLFunctions();
+		//use timer queries if the context has them
+		m_frameTimer.initialize();
 		//setup some OpenGL stuff
 		glDisable(GL_CULL_FACE);
 		glDisable(GL_LIGHTING);
@@ -272,14 +341,33 @@ void LiveView::CreateFrameBufferShader()
 	}
 }
 
+void LiveView::CreateResolveShader()
+{
+	if (!m_resolveShaderProgram)
+	{
+		m_resolveShaderProgram = new QOpenGLShaderProgram();
+		if (!m_resolveShaderProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, m_vertexPrefix + m_defaultVertexCode)
+			|| !m_resolveShaderProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, m_fragmentPrefix + m_resolveFragmentCode)
+			|| !m_resolveShaderProgram->link())
+		{
+			qDebug() << "Failed to create shader for resolving the framebuffer:" << m_resolveShaderProgram->log();
+			delete m_resolveShaderProgram;
+			m_resolveShaderProgram = nullptr;
+		}
+	}
+}
+
 void LiveView::CreateFrameBuffer()
 {
-	if (!m_frameBufferObject || m_frameBufferWidth == -1 || m_frameBufferHeight == -1)
+	if (m_frameBufferWidth == -1 || m_frameBufferHeight == -1)
 	{
 		m_frameBufferWidth = width();
 		m_frameBufferHeight = height();
 	}
-	if (!m_frameBufferObject || m_frameBufferObject->width() != m_frameBufferWidth || m_frameBufferObject->height() != m_frameBufferHeight)
+	//the scene is rendered at a multiple of the render size when supersampling
+	const int sampleWidth = m_frameBufferWidth * m_superSampling;
+	const int sampleHeight = m_frameBufferHeight * m_superSampling;
+	if (!m_frameBufferObject || m_frameBufferObject->width() != sampleWidth || m_frameBufferObject->height() != sampleHeight)
 	{
 		//destroy old framebuffer first
 		if (m_frameBufferObject)
@@ -287,13 +375,37 @@ void LiveView::CreateFrameBuffer()
 			delete m_frameBufferObject;
 		}
 		//create new framebuffer
+		//use 16 bits per channel where possible, so gradients keep their precision up to the LEDs
 		QOpenGLFramebufferObjectFormat format;
 		format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+		format.setInternalTextureFormat(Image16::frameBufferFormat());
 		//format.setMipmap(false);
 		//format.setTextureTarget(GL_TEXTURE_2D);
-		m_frameBufferObject = new QOpenGLFramebufferObject(m_frameBufferWidth, m_frameBufferHeight, format);
+		m_frameBufferObject = new QOpenGLFramebufferObject(sampleWidth, sampleHeight, format);
 		qDebug() << "Framebuffer" << m_frameBufferObject->size();
 	}
+	//allocate or free the framebuffer the supersampled image is resolved to
+	if (m_superSampling > 1)
+	{
+		if (!m_resolveFrameBufferObject || m_resolveFrameBufferObject->width() != m_frameBufferWidth || m_resolveFrameBufferObject->height() != m_frameBufferHeight)
+		{
+			delete m_resolveFrameBufferObject;
+			QOpenGLFramebufferObjectFormat format;
+			format.setInternalTextureFormat(Image16::frameBufferFormat());
+			m_resolveFrameBufferObject = new QOpenGLFramebufferObject(m_frameBufferWidth, m_frameBufferHeight, format);
+			qDebug() << "Resolve framebuffer" << m_resolveFrameBufferObject->size();
+		}
+	}
+	else if (m_resolveFrameBufferObject)
+	{
+		delete m_resolveFrameBufferObject;
+		m_resolveFrameBufferObject = nullptr;
+	}
+}
+
+QOpenGLFramebufferObject * LiveView::outputFrameBuffer() const
+{
+	return (m_superSampling > 1 && m_resolveFrameBufferObject) ? m_resolveFrameBufferObject : m_frameBufferObject;
 }
 
 void LiveView::paintGL()
@@ -307,6 +419,7 @@ void LiveView::paintGL()
 		makeCurrent();
 		//allocate framebuffer frament shader and object
 		CreateFrameBufferShader();
+		CreateResolveShader();
 		CreateFrameBuffer();
 		//allocate compile thread
 		if (!m_compileThread)
@@ -319,34 +432,37 @@ void LiveView::paintGL()
 			m_scriptChanged = true;
 			m_fragmentScript = m_defaultFragmentCode;
 		}
-		//if the script changed, compile it
+		//if the script changed, compile it. only the audio features the script asks for will be set
 		if (m_compileThread && m_scriptChanged)
 		{
+			m_compiledAudioFeatures = AudioFeatures::parseFeatures(m_fragmentScript);
+			const QString fragmentCode = m_fragmentPrefix + m_fragmentScript;
 			if (m_asynchronousCompilation)
 			{
-				m_compileThread->compileAndLink(m_vertexPrefix + m_defaultVertexCode, m_fragmentPrefix + m_fragmentScript, m_asynchronousCompilation);
+				m_compileThread->compileAndLink(m_vertexPrefix + m_defaultVertexCode, fragmentCode, m_asynchronousCompilation);
 			}
 			else
 			{
 				locker.unlock();
-				m_compileThread->compileAndLink(m_vertexPrefix + m_defaultVertexCode, m_fragmentPrefix + m_fragmentScript, m_asynchronousCompilation);
+				m_compileThread->compileAndLink(m_vertexPrefix + m_defaultVertexCode, fragmentCode, m_asynchronousCompilation);
 				return;
 			}
 		}
 		//check if we have a working shader
 		if (m_frameBufferShaderProgram && m_frameBufferShaderProgram->isLinked() && m_shaderProgram && m_shaderProgram->isLinked())
 		{
+			m_frameTimer.begin();
 			//unbind default framebuffer and bind our framebuffer
 			m_frameBufferObject->bind();
 			//set up viewport for framebuffer size
-			glViewport(0, 0, m_frameBufferWidth, m_frameBufferHeight);
+			glViewport(0, 0, m_frameBufferObject->width(), m_frameBufferObject->height());
 			//clear view
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			//now render script with shader
 			m_shaderProgram->bind();
 			//set all uniforms values
 			m_shaderProgram->setUniformValue("projectionMatrix", m_projectionMatrix);
-			m_shaderProgram->setUniformValue("renderSize", QVector2D(m_frameBufferWidth, m_frameBufferHeight));
+			m_shaderProgram->setUniformValue("renderSize", QVector2D(m_frameBufferObject->width(), m_frameBufferObject->height()));
 			setShaderUniformsFromMap(m_shaderProgram, m_shaderValues2d);
 			setShaderUniformsFromMap(m_shaderProgram, m_shaderValues3d);
 			setShaderUniformsFromMap(m_shaderProgram, m_shaderValues4d);
@@ -354,6 +470,10 @@ void LiveView::paintGL()
 			setShaderUniformsFromMap(m_shaderProgram, m_shaderValuesui);
 			setShaderUniformsFromMap(m_shaderProgram, m_shaderValuesi);
 			setShaderUniformsFromMap(m_shaderProgram, m_shaderValuesb);
+			if (m_audioFeatures != AudioFeatures::None)
+			{
+				AudioFeatures::getInstance()->setUniforms(m_shaderProgram, m_audioFeatures);
+			}
 			//enable attributes in shader
 			int position = m_shaderProgram->attributeLocation("position");
 			int texcoord0 = m_shaderProgram->attributeLocation("texcoord0");
@@ -367,15 +487,50 @@ void LiveView::paintGL()
 			//disable attributes again
 			glDisableVertexAttribArray(position);
 			glDisableVertexAttribArray(texcoord0);
+			//undbind framebuffer and shader
+			m_frameBufferObject->release();
+			m_shaderProgram->release();
+			m_frameTimer.mark(FrameTimer::Render);
+			//if supersampling, resolve the framebuffer to the render size
+			if (m_superSampling > 1 && m_resolveFrameBufferObject && m_resolveShaderProgram)
+			{
+				m_resolveFrameBufferObject->bind();
+				glViewport(0, 0, m_frameBufferWidth, m_frameBufferHeight);
+				m_resolveShaderProgram->bind();
+				//bind supersampled framebuffer texture
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, m_frameBufferObject->texture());
+				//set all uniforms values
+				m_resolveShaderProgram->setUniformValue("projectionMatrix", m_blitMatrix);
+				m_resolveShaderProgram->setUniformValue("frameBufferTexture", 0);
+				m_resolveShaderProgram->setUniformValue("sourceTexelSize", QVector2D(1.0f / m_frameBufferObject->width(), 1.0f / m_frameBufferObject->height()));
+				m_resolveShaderProgram->setUniformValue("superSampling", m_superSampling);
+				//enable attributes in shader
+				position = m_resolveShaderProgram->attributeLocation("position");
+				texcoord0 = m_resolveShaderProgram->attributeLocation("texcoord0");
+				glEnableVertexAttribArray(position); //position
+				glEnableVertexAttribArray(texcoord0); //texture coordinates
+				//setup vertex buffers
+				glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), &m_quadData[0]);
+				glVertexAttribPointer(texcoord0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), &m_quadData[3]);
+				//render screen-sized quad
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+				//de-init everything again
+				glDisableVertexAttribArray(position);
+				glDisableVertexAttribArray(texcoord0);
+				m_resolveShaderProgram->release();
+				m_resolveFrameBufferObject->release();
+			}
+			m_frameTimer.mark(FrameTimer::Resolve);
+			//submit rendering, so contexts sharing the output texture see the result
+			glFlush();
 			//grab framebuffer now if needed
 			if (m_grabFramebuffer)
 			{
-				m_grabbedFramebuffer = m_frameBufferObject->toImage();
+				m_grabbedFramebuffer = outputFrameBuffer()->toImage();
 				m_grabFramebuffer = false;
 			}
-			//undbind framebuffer and shader
-			m_frameBufferObject->release();
-			m_shaderProgram->release();
+			m_frameTimer.mark(FrameTimer::Readback);
 			//bind default widget framebuffer
 			glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
 			//set viewport size to widget size
@@ -384,7 +539,7 @@ void LiveView::paintGL()
 			m_frameBufferShaderProgram->bind();
 			//bind framebuffer texture
 			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, m_frameBufferObject->texture());
+			glBindTexture(GL_TEXTURE_2D, outputFrameBuffer()->texture());
 			//set all uniforms values
 			m_frameBufferShaderProgram->setUniformValue("projectionMatrix", m_blitMatrix);
 			m_frameBufferShaderProgram->setUniformValue("renderSize", QVector2D(width(), height()));
@@ -403,6 +558,7 @@ void LiveView::paintGL()
 			glDisableVertexAttribArray(position);
 			glDisableVertexAttribArray(texcoord0);
 			m_frameBufferShaderProgram->release();
+			m_frameTimer.mark(FrameTimer::Blit);
 			locker.unlock();
 			//return and let the system do compositing etc. and send a frameSwapped signal
 		}
@@ -455,6 +611,31 @@ QImage LiveView::getGrabbedFramebuffer()
 	return m_grabbedFramebuffer;
 }
 
+GLuint LiveView::outputTexture()
+{
+	QMutexLocker locker(&m_grabMutex);
+	QOpenGLFramebufferObject * frameBuffer = outputFrameBuffer();
+	return frameBuffer ? frameBuffer->texture() : 0;
+}
+
+bool LiveView::takeFrameTimes(float times[FrameTimer::StageCount])
+{
+	QMutexLocker locker(&m_grabMutex);
+	return m_frameTimer.takeResult(times);
+}
+
+bool LiveView::hasGPUFrameTimes() const
+{
+	return m_frameTimer.usesGPU();
+}
+
+QSize LiveView::outputSize()
+{
+	QMutexLocker locker(&m_grabMutex);
+	QOpenGLFramebufferObject * frameBuffer = outputFrameBuffer();
+	return frameBuffer ? frameBuffer->size() : QSize();
+}
+
 void LiveView::setFragmentScript(const QString & script)
 {
 	QMutexLocker locker(&m_grabMutex);
@@ -482,6 +663,7 @@ void LiveView::compilationFinished(QOpenGLShader * vertex, QOpenGLShader * fragm
 		m_vertexShader = vertex;
 		m_fragmentShader = fragment;
 		m_shaderProgram = program;
+		m_audioFeatures = m_compiledAudioFeatures;
 		locker.unlock();
 		emit fragmentScriptChanged();
 	}
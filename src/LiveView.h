@@ -2,6 +2,7 @@
 
 //#include "SwapThread.h"
 #include "GLSLCompileThread.h"
+#include "FrameTimer.h"
 
 #include <QMap>
 #include <QMutex>
@@ -30,6 +31,15 @@ public:
 	/// @brief Get the default OpenGL format used for the live view.
 	static QSurfaceFormat getDefaultFormat();
 
+	/// @brief Retrieve the vertex shader code scripts are rendered with.
+	/// This and the functions below allow rendering scripts exactly like the live view does, but without a widget.
+	/// @param openGLES Pass true to get the code for OpenGL ES 2.0, false for OpenGL 2.1.
+	static QString vertexShaderCode(bool openGLES);
+	/// @brief Retrieve the prefix applied to fragment scripts to make them compilable.
+	static QString fragmentScriptPrefix(bool openGLES);
+	/// @brief Retrieve the fragment shader code used to resolve a supersampled framebuffer.
+	static QString resolveFragmentCode(bool openGLES);
+
 	/// @brief Call when you want the framebuffer after the next buffer swap.
 	/// You can retrieve the last grabbed framebuffer using QImage getGrabbedFrameBuffer().
 	void grabFramebufferAfterSwap();
@@ -37,6 +47,13 @@ public:
 	/// @brief Retrieve the last grabbed framebuffer. Call void grabFrameBufferAfterSwap() to grab it after a buffer swap.
 	QImage getGrabbedFramebuffer();
 
+	/// @brief Retrieve the texture holding the last rendered (and resolved) image.
+	/// The texture can be used in all contexts sharing resources with this widget.
+	GLuint outputTexture();
+
+	/// @brief Retrieve the size of the texture returned by outputTexture().
+	QSize outputSize();
+
 	/// @brief Set new render script, actually a fragment shader
     void setFragmentScript(const QString & script);
 
@@ -58,6 +75,24 @@ public:
 	/// This is the size the image will be rendered in. It will the be rescaled to the widget size.
 	void setRenderSize(int width, int height);
 
+	/// @brief Set the size the widget would like to have in the layout.
+	/// This is independent of the render size, so rendering can happen at e.g. LED resolution.
+	void setPreviewSize(int width, int height);
+
+	/// @brief Set the supersampling factor. The scene is rendered at render size * factor
+	/// and resolved to render size on the GPU by averaging factor * factor samples.
+	/// @param factor Supersampling factor in [1,8]. 1 disables supersampling.
+	void setSuperSampling(int factor);
+
+	/// @brief Retrieve how long the stages of the newest measured frame took, if not retrieved yet.
+	/// Frames are measured on the GPU, so the result is a few frames old.
+	/// @param times Receives the time of every stage in ms.
+	/// @return True if a new result was available.
+	bool takeFrameTimes(float times[FrameTimer::StageCount]);
+
+	/// @brief Retrieve true if frame times are measured with GPU timer queries, false if measured on the CPU.
+	bool hasGPUFrameTimes() const;
+
 public slots:
 	/// @brief Toggle asynchronous shader compilation. This crashes on some systems.
 	/// @param enabled Pass true to enable. Default is disabled.
@@ -92,7 +127,10 @@ protected slots:
 
 private:
 	void CreateFrameBufferShader();
+	void CreateResolveShader();
 	void CreateFrameBuffer();
+	/// @brief Retrieve the framebuffer holding the final image, which is the resolve framebuffer when supersampling.
+	QOpenGLFramebufferObject * outputFrameBuffer() const;
 
 	static const float m_quadData[20];
 	static const char * m_vertexPrefixGLES2;
@@ -102,6 +140,7 @@ private:
 	static const char * m_defaultVertexCode;
 	static const char * m_defaultFragmentCode;
 	static const char * m_frameBufferFragmentCode;
+	static const char * m_resolveFragmentCode;
 	QString m_vertexPrefix;
 	QString m_fragmentPrefix;
 
@@ -110,12 +149,18 @@ private:
 
 	int m_frameBufferWidth;
 	int m_frameBufferHeight;
+	int m_previewWidth;
+	int m_previewHeight;
+	int m_superSampling;
 	bool m_keepAspect;
 	QOpenGLFramebufferObject * m_frameBufferObject;
+	QOpenGLFramebufferObject * m_resolveFrameBufferObject;
+	QOpenGLShaderProgram * m_resolveShaderProgram;
 	QOpenGLShader * m_frameBufferVertexShader;
 	QOpenGLShader * m_frameBufferFragmentShader;
 	QOpenGLShaderProgram * m_frameBufferShaderProgram;
 	QMatrix4x4 m_blitMatrix;
+	FrameTimer m_frameTimer;
 
 	QMatrix4x4 m_projectionMatrix;
 	QMap<QString, QVector2D> m_shaderValues2d;
@@ -130,6 +175,8 @@ private:
 	QOpenGLShaderProgram * m_shaderProgram;
 	QString m_fragmentScript;
 	bool m_scriptChanged;
+	int m_audioFeatures; //audio features used by the current shader program
+	int m_compiledAudioFeatures; //audio features of the script compiled last
 
 	//SwapThread * m_swapThread;
 	GLSLCompileThread * m_compileThread;
@@ -0,0 +1,211 @@
+#include "MIDIClock.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+
+//gains of the alpha-beta filter once it has settled. lower values filter more jitter, but follow tempo changes slower
+static const double ClockAlpha = 0.1;
+static const double ClockBeta = 0.005;
+//gain for smoothing the time code position
+static const double TimeCodeAlpha = 0.2;
+//tick period for 120 bpm, used before the first tick has been received
+static const double DefaultTickPeriod = 60.0e9 / (120.0 * 24.0);
+//tempo limits in bpm
+static const double MinimumBpm = 20.0;
+static const double MaximumBpm = 400.0;
+//clock and time code are considered lost if nothing was received for this long
+static const int64_t ClockTimeout = 1000000000;
+static const int64_t TimeCodeTimeout = 500000000;
+
+
+MIDIClock::MIDIClock()
+	: m_running(false)
+	, m_tickCount(0)
+	, m_stoppedTickCount(0)
+	, m_tickTime(0.0)
+	, m_tickPeriod(DefaultTickPeriod)
+	, m_lastTickTimestamp(0)
+	, m_ticksSinceStart(0)
+	, m_mtcPiecesReceived(0)
+	, m_mtcSeconds(0.0)
+	, m_mtcTimestamp(0)
+	, m_stoppedBeats(0.0)
+	, m_freeRunningBeats(0.0)
+	, m_freeRunningStart(now())
+{
+	std::fill(m_mtcPieces, m_mtcPieces + 8, 0);
+}
+
+int64_t MIDIClock::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool MIDIClock::message(const uint8_t * data, int size, int64_t timestamp)
+{
+	if (size < 1)
+	{
+		return false;
+	}
+	switch (data[0])
+	{
+		case 0xF8:
+			tick(timestamp);
+			return true;
+		case 0xFA:
+			//start from the beginning of the song. the next tick is beat 0
+			m_running = true;
+			m_tickCount = 0;
+			m_stoppedTickCount = 0;
+			m_stoppedBeats = 0.0;
+			return true;
+		case 0xFB:
+			//continue from the current position
+			m_running = true;
+			m_stoppedTickCount = 0;
+			return true;
+		case 0xFC:
+			//remember where we stopped
+			m_stoppedBeats = m_tickCount > 0 ? (double)(m_tickCount - 1) / TicksPerBeat : 0.0;
+			m_stoppedTickCount = 0;
+			m_running = false;
+			return true;
+		case 0xF1:
+			if (size >= 2)
+			{
+				quarterFrame(data[1], timestamp);
+			}
+			return true;
+		default:
+			return false;
+	}
+}
+
+void MIDIClock::tick(int64_t timestamp)
+{
+	if (m_lastTickTimestamp == 0 || (timestamp - m_lastTickTimestamp) > ClockTimeout)
+	{
+		//(re-)acquire the clock. keep the last tempo estimate
+		m_tickTime = (double)timestamp;
+		m_ticksSinceStart = 0;
+	}
+	else
+	{
+		++m_ticksSinceStart;
+		//use least-squares gains for the first ticks, so the filter locks quickly, then settle to the fixed gains.
+		//the acquiring tick is the first measurement, so this is measurement n
+		const double n = (double)m_ticksSinceStart + 1.0;
+		const double alpha = std::max(ClockAlpha, 2.0 * (2.0 * n - 1.0) / (n * (n + 1.0)));
+		const double beta = std::max(ClockBeta, 6.0 / (n * (n + 1.0)));
+		//predict when this tick should have arrived and correct phase and period by the error
+		const double predicted = m_tickTime + m_tickPeriod;
+		const double error = (double)timestamp - predicted;
+		m_tickTime = predicted + alpha * error;
+		m_tickPeriod += beta * error;
+		m_tickPeriod = std::max(60.0e9 / (MaximumBpm * TicksPerBeat), std::min(60.0e9 / (MinimumBpm * TicksPerBeat), m_tickPeriod));
+	}
+	m_lastTickTimestamp = timestamp;
+	if (m_running)
+	{
+		++m_tickCount;
+	}
+	else
+	{
+		//keep the phase moving while stopped, e.g. if the master was started before us or only sends clock
+		++m_stoppedTickCount;
+	}
+	anchorFreeRunning(timestamp);
+}
+
+void MIDIClock::quarterFrame(uint8_t data, int64_t timestamp)
+{
+	const int piece = (data >> 4) & 0x07;
+	m_mtcPieces[piece] = data & 0x0F;
+	//restart assembly if pieces arrive out of order, e.g. after a locate
+	m_mtcPiecesReceived = piece == 0 ? 1 : m_mtcPiecesReceived + 1;
+	if (piece == 7 && m_mtcPiecesReceived >= 8)
+	{
+		static const double frameRates[4] = {24.0, 25.0, 30000.0 / 1001.0, 30.0};
+		const double fps = frameRates[(m_mtcPieces[7] >> 1) & 0x03];
+		const int frames = m_mtcPieces[0] | (m_mtcPieces[1] << 4);
+		const int seconds = m_mtcPieces[2] | (m_mtcPieces[3] << 4);
+		const int minutes = m_mtcPieces[4] | (m_mtcPieces[5] << 4);
+		const int hours = m_mtcPieces[6] | ((m_mtcPieces[7] & 0x01) << 4);
+		//the 8 quarter frames of a time code span two frames
+		const double measured = hours * 3600.0 + minutes * 60.0 + seconds + (frames + 2.0) / fps;
+		const double predicted = m_mtcSeconds + (double)(timestamp - m_mtcTimestamp) / 1.0e9;
+		const double error = measured - predicted;
+		if (m_mtcTimestamp == 0 || (timestamp - m_mtcTimestamp) > TimeCodeTimeout || std::abs(error) > 0.5)
+		{
+			//first time code or a jump. take it as it is
+			m_mtcSeconds = measured;
+		}
+		else
+		{
+			m_mtcSeconds = predicted + TimeCodeAlpha * error;
+		}
+		m_mtcTimestamp = timestamp;
+		anchorFreeRunning(timestamp);
+	}
+}
+
+double MIDIClock::freeRunningBeats(int64_t timestamp) const
+{
+	return m_freeRunningBeats + (double)(timestamp - m_freeRunningStart) / m_tickPeriod / TicksPerBeat;
+}
+
+void MIDIClock::anchorFreeRunning(int64_t timestamp)
+{
+	//if clock and time code are lost the position continues from here instead of jumping
+	bool synced = false;
+	m_freeRunningBeats = beatsAt(timestamp, synced);
+	m_freeRunningStart = timestamp;
+}
+
+MIDIClock::Position MIDIClock::position(int64_t timestamp) const
+{
+	Position result;
+	result.bpm = (float)(60.0e9 / (m_tickPeriod * TicksPerBeat));
+	const double beats = beatsAt(timestamp, result.synced);
+	result.beatPhase = (float)(beats - std::floor(beats));
+	result.bar = (int)std::floor(beats / BeatsPerBar);
+	return result;
+}
+
+double MIDIClock::beatsAt(int64_t timestamp, bool & synced) const
+{
+	double beats = 0.0;
+	const bool hasClock = m_lastTickTimestamp != 0 && (timestamp - m_lastTickTimestamp) <= ClockTimeout;
+	const bool hasTimeCode = m_mtcTimestamp != 0 && (timestamp - m_mtcTimestamp) <= TimeCodeTimeout;
+	if (hasClock)
+	{
+		//extrapolate from the filtered time of the last tick, but never further than one tick
+		const double sinceTick = std::max(0.0, std::min(1.0, ((double)timestamp - m_tickTime) / m_tickPeriod));
+		if (m_running && m_tickCount > 0)
+		{
+			beats = ((double)(m_tickCount - 1) + sinceTick) / TicksPerBeat;
+		}
+		else if (m_stoppedTickCount > 0)
+		{
+			//ticks without a running transport. count on from where it stopped
+			beats = m_stoppedBeats + ((double)(m_stoppedTickCount - 1) + sinceTick) / TicksPerBeat;
+		}
+		else
+		{
+			beats = m_stoppedBeats;
+		}
+	}
+	else if (hasTimeCode)
+	{
+		const double seconds = m_mtcSeconds + (double)(timestamp - m_mtcTimestamp) / 1.0e9;
+		beats = seconds * 1.0e9 / (m_tickPeriod * TicksPerBeat);
+	}
+	else
+	{
+		beats = freeRunningBeats(timestamp);
+	}
+	synced = hasClock || hasTimeCode;
+	return beats;
+}
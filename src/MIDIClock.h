@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+
+/// @brief Follows MIDI clock (0xF8 ticks, 0xFA start, 0xFB continue, 0xFC stop) and MIDI Time Code quarter frames (0xF1).
+/// Tick times are jittery, because they pass through USB and the OS, so tempo and phase are estimated with
+/// an alpha-beta filter (a steady-state Kalman filter) that tracks the tick period and the time of the last tick.
+/// Between ticks the beat position is extrapolated, so it can be sampled at any time with sub-tick accuracy.
+/// Ticks also move the phase while the transport is stopped, e.g. if the master was started before NerDisco.
+/// Without MIDI clock, MTC is used as the time base with the last known tempo. Without either the clock free-runs
+/// from the last synced position.
+class MIDIClock
+{
+public:
+	/// @brief Estimated musical position.
+	struct Position
+	{
+		float beatPhase; //[0,1) position inside the current beat
+		int bar; //number of bars since start. 4 beats per bar
+		float bpm; //estimated tempo in beats per minute
+		bool synced; //true if the position follows MIDI clock or MTC
+	};
+
+	MIDIClock();
+
+	/// @brief Feed a system message to the clock.
+	/// @param data Message bytes. Only 0xF1, 0xF8, 0xFA, 0xFB and 0xFC are used.
+	/// @param size Number of bytes.
+	/// @param timestamp Receive time in nanoseconds on the steady clock.
+	/// @return True if the message was used by the clock.
+	bool message(const uint8_t * data, int size, int64_t timestamp);
+
+	/// @brief Estimate the position at a point in time.
+	/// @param timestamp Time in nanoseconds on the steady clock, usually "now".
+	Position position(int64_t timestamp) const;
+
+	/// @brief Return the current time in nanoseconds on the steady clock.
+	static int64_t now();
+
+private:
+	void tick(int64_t timestamp);
+	void quarterFrame(uint8_t data, int64_t timestamp);
+	double freeRunningBeats(int64_t timestamp) const;
+	/// @brief Estimate the beat position at a point in time and whether it follows MIDI clock or MTC.
+	double beatsAt(int64_t timestamp, bool & synced) const;
+	/// @brief Continue free-running from the synced position at a point in time.
+	void anchorFreeRunning(int64_t timestamp);
+
+	static const int TicksPerBeat = 24;
+	static const int BeatsPerBar = 4;
+
+	//clock state
+	bool m_running;
+	int64_t m_tickCount;
+	int64_t m_stoppedTickCount; //ticks received since the transport stopped or since the clock was acquired without a start
+	double m_tickTime; //filtered time of the last tick in ns
+	double m_tickPeriod; //filtered tick period in ns
+	int64_t m_lastTickTimestamp; //unfiltered time of the last tick in ns
+	int m_ticksSinceStart;
+
+	//time code state
+	uint8_t m_mtcPieces[8];
+	int m_mtcPiecesReceived;
+	double m_mtcSeconds; //time code position at m_mtcTimestamp
+	int64_t m_mtcTimestamp;
+
+	//position where the clock stopped
+	double m_stoppedBeats;
+	//position the clock free-runs from and its time. moved along with the synced position
+	double m_freeRunningBeats;
+	int64_t m_freeRunningStart;
+};
@@ -0,0 +1,272 @@
+#include "MIDIDecoder.h"
+
+#include <cstring>
+
+
+MIDIDecoder::MIDIDecoder()
+{
+	reset();
+}
+
+void MIDIDecoder::reset()
+{
+	m_status = 0;
+	m_data[0] = 0;
+	m_data[1] = 0;
+	m_dataCount = 0;
+	m_inSysEx = false;
+	m_timestamp = 0;
+	m_heldCount = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		ChannelState & state = m_channels[i];
+		memset(state.msb, 0, sizeof(state.msb));
+		memset(state.hasLSB, 0, sizeof(state.hasLSB));
+		memset(state.msbHeld, 0, sizeof(state.msbHeld));
+		memset(state.msbTime, 0, sizeof(state.msbTime));
+		state.nrpn = NoParameter;
+		state.nrpnMSB = 0;
+		state.nrpnLSB = 0;
+		state.dataMSB = 0;
+		state.hasDataLSB = false;
+		state.dataMSBHeld = false;
+		state.dataMSBTime = 0;
+	}
+}
+
+void MIDIDecoder::decode(const uint8_t * data, size_t size, int64_t timestamp, std::vector<MIDIControlEvent> & events)
+{
+	m_timestamp = timestamp;
+	for (size_t i = 0; i < size; ++i)
+	{
+		const uint8_t byte = data[i];
+		if (byte >= 0xF8)
+		{
+			//real-time messages can appear anywhere and do not affect running status
+			continue;
+		}
+		else if (byte == 0xF0)
+		{
+			//start of system exclusive message. skip everything until its end
+			m_inSysEx = true;
+			m_status = 0;
+			m_dataCount = 0;
+			continue;
+		}
+		else if (byte >= 0xF1)
+		{
+			//end of system exclusive or system common message. both cancel running status
+			m_inSysEx = false;
+			m_status = 0;
+			m_dataCount = 0;
+			continue;
+		}
+		else if (byte & 0x80)
+		{
+			//new channel status. it stays valid for following data bytes (running status)
+			m_inSysEx = false;
+			m_status = byte;
+			m_dataCount = 0;
+			continue;
+		}
+		//data byte. ignore it if we don't know what it belongs to
+		if (m_inSysEx || m_status == 0)
+		{
+			continue;
+		}
+		m_data[m_dataCount++] = byte;
+		//program change and channel pressure have one data byte, all others two
+		const uint8_t type = m_status & 0xF0;
+		const int dataNeeded = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+		if (m_dataCount >= dataNeeded)
+		{
+			decodeChannelMessage(events);
+			m_dataCount = 0;
+		}
+	}
+}
+
+void MIDIDecoder::decodeChannelMessage(std::vector<MIDIControlEvent> & events)
+{
+	const uint8_t type = m_status & 0xF0;
+	const uint8_t channel = m_status & 0x0F;
+	MIDIControlEvent event;
+	event.channel = channel;
+	switch (type)
+	{
+		case 0x80:
+			event.type = MIDIControlEvent::Note;
+			event.number = m_data[0];
+			event.value = 0.0f;
+			events.push_back(event);
+			break;
+		case 0x90:
+			//note on with zero velocity is a note off
+			event.type = MIDIControlEvent::Note;
+			event.number = m_data[0];
+			event.value = (float)m_data[1] / 127.0f;
+			events.push_back(event);
+			break;
+		case 0xB0:
+			decodeControlChange(channel, m_data[0], m_data[1], events);
+			break;
+		case 0xE0:
+			event.type = MIDIControlEvent::PitchBend;
+			event.number = 0;
+			event.value = (float)(m_data[0] | (m_data[1] << 7)) / 16383.0f;
+			events.push_back(event);
+			break;
+		default:
+			//aftertouch, program change and channel pressure are not used
+			break;
+	}
+}
+
+void MIDIDecoder::decodeControlChange(uint8_t channel, uint8_t controller, uint8_t value, std::vector<MIDIControlEvent> & events)
+{
+	ChannelState & state = m_channels[channel];
+	MIDIControlEvent event;
+	event.channel = channel;
+	if (controller == 99 || controller == 98)
+	{
+		//NRPN parameter number selection. a value still waiting for its LSB belongs to the previous parameter
+		releaseDataMSB(channel, events);
+		if (controller == 99)
+		{
+			state.nrpnMSB = value;
+		}
+		else
+		{
+			state.nrpnLSB = value;
+		}
+		state.nrpn = (uint16_t)((state.nrpnMSB << 7) | state.nrpnLSB);
+		state.dataMSB = 0;
+		state.hasDataLSB = false;
+		return;
+	}
+	else if (controller == 101 || controller == 100)
+	{
+		//RPN selection. RPN data entry is not mapped
+		releaseDataMSB(channel, events);
+		state.nrpn = NoParameter;
+		return;
+	}
+	else if (controller == 6 && state.nrpn != NoParameter)
+	{
+		//NRPN data entry MSB
+		state.dataMSB = value;
+		if (state.hasDataLSB)
+		{
+			//wait for the LSB, like for 14-bit controllers
+			if (!state.dataMSBHeld)
+			{
+				state.dataMSBHeld = true;
+				++m_heldCount;
+			}
+			state.dataMSBTime = m_timestamp;
+			return;
+		}
+		event.type = MIDIControlEvent::NRPN;
+		event.number = state.nrpn;
+		event.value = (float)value / 127.0f;
+		events.push_back(event);
+		return;
+	}
+	else if (controller == 38 && state.nrpn != NoParameter)
+	{
+		//NRPN data entry LSB
+		state.hasDataLSB = true;
+		if (state.dataMSBHeld)
+		{
+			state.dataMSBHeld = false;
+			--m_heldCount;
+		}
+		event.type = MIDIControlEvent::NRPN;
+		event.number = state.nrpn;
+		event.value = (float)((state.dataMSB << 7) | value) / 16383.0f;
+		events.push_back(event);
+		return;
+	}
+	event.type = MIDIControlEvent::ControlChange;
+	if (controller < 32)
+	{
+		//MSB of a possibly 14-bit controller
+		state.msb[controller] = value;
+		if (state.hasLSB[controller])
+		{
+			//wait for the LSB, so the value does not jump to the coarse step first
+			if (!state.msbHeld[controller])
+			{
+				state.msbHeld[controller] = true;
+				++m_heldCount;
+			}
+			state.msbTime[controller] = m_timestamp;
+			return;
+		}
+		event.number = controller;
+		event.value = (float)value / 127.0f;
+	}
+	else if (controller < 64)
+	{
+		//LSB of controllers 0-31. report the combined value on the MSB controller number
+		const uint8_t msbController = controller - 32;
+		state.hasLSB[msbController] = true;
+		if (state.msbHeld[msbController])
+		{
+			state.msbHeld[msbController] = false;
+			--m_heldCount;
+		}
+		event.number = msbController;
+		event.value = (float)((state.msb[msbController] << 7) | value) / 16383.0f;
+	}
+	else
+	{
+		event.number = controller;
+		event.value = (float)value / 127.0f;
+	}
+	events.push_back(event);
+}
+
+void MIDIDecoder::flush(int64_t timestamp, std::vector<MIDIControlEvent> & events)
+{
+	for (int channel = 0; channel < 16 && m_heldCount > 0; ++channel)
+	{
+		ChannelState & state = m_channels[channel];
+		if (state.dataMSBHeld && timestamp - state.dataMSBTime >= LSBTimeout)
+		{
+			releaseDataMSB((uint8_t)channel, events);
+		}
+		for (int controller = 0; controller < 32; ++controller)
+		{
+			if (state.msbHeld[controller] && timestamp - state.msbTime[controller] >= LSBTimeout)
+			{
+				//the LSB did not follow. report the MSB alone
+				state.msbHeld[controller] = false;
+				--m_heldCount;
+				MIDIControlEvent event;
+				event.type = MIDIControlEvent::ControlChange;
+				event.channel = (uint8_t)channel;
+				event.number = (uint16_t)controller;
+				event.value = (float)(state.msb[controller] << 7) / 16383.0f;
+				events.push_back(event);
+			}
+		}
+	}
+}
+
+void MIDIDecoder::releaseDataMSB(uint8_t channel, std::vector<MIDIControlEvent> & events)
+{
+	ChannelState & state = m_channels[channel];
+	if (state.dataMSBHeld)
+	{
+		//the LSB did not follow. report the MSB alone
+		state.dataMSBHeld = false;
+		--m_heldCount;
+		MIDIControlEvent event;
+		event.type = MIDIControlEvent::NRPN;
+		event.channel = channel;
+		event.number = state.nrpn;
+		event.value = (float)(state.dataMSB << 7) / 16383.0f;
+		events.push_back(event);
+	}
+}
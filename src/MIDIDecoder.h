@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+/// @brief A decoded MIDI control event with a value in the range [0,1].
+struct MIDIControlEvent
+{
+	enum Type {
+		ControlChange, ///< 7-bit or 14-bit controller. number is the controller [0,127].
+		Note, ///< Note on/off. number is the note [0,127], value is the velocity or 0 for note off.
+		PitchBend, ///< Pitch bend. number is always 0.
+		NRPN ///< Non-registered parameter number. number is the 14-bit parameter number [0,16383].
+	};
+
+	Type type;
+	uint8_t channel; //[0,15]
+	uint16_t number;
+	float value; //[0,1]
+};
+
+/// @brief Turns a raw MIDI byte stream into high-resolution control events.
+/// Handles running status, note on/off, pitch bend, 14-bit controller pairs (MSB 0-31 + LSB 32-63) and NRPN data entry.
+/// A controller is treated as 14-bit as soon as its LSB has been received once, so 7-bit controllers still span the full range.
+/// The MSB of a 14-bit controller or of NRPN data entry is held until its LSB arrives, so the value does not jump to
+/// the coarse step first.
+/// If the LSB does not follow within LSBTimeout, flush() reports the MSB alone.
+class MIDIDecoder
+{
+public:
+	/// @brief Time to wait for the LSB of a 14-bit controller in nanoseconds.
+	static const int64_t LSBTimeout = 5000000;
+
+	MIDIDecoder();
+
+	/// @brief Decode MIDI bytes. Incomplete messages are continued with the next call.
+	/// @param data Raw MIDI bytes.
+	/// @param size Number of bytes.
+	/// @param timestamp Time the bytes were received in nanoseconds on the steady clock.
+	/// @param events Decoded events are appended here.
+	void decode(const uint8_t * data, size_t size, int64_t timestamp, std::vector<MIDIControlEvent> & events);
+
+	/// @brief Report held MSBs of 14-bit controllers whose LSB did not arrive within LSBTimeout.
+	/// @param timestamp Current time in nanoseconds on the steady clock.
+	/// @param events Decoded events are appended here.
+	void flush(int64_t timestamp, std::vector<MIDIControlEvent> & events);
+
+	/// @brief Reset running status and all controller state.
+	void reset();
+
+private:
+	void decodeChannelMessage(std::vector<MIDIControlEvent> & events);
+	void decodeControlChange(uint8_t channel, uint8_t controller, uint8_t value, std::vector<MIDIControlEvent> & events);
+	/// @brief Report a held NRPN data entry MSB alone, e.g. before another parameter is selected.
+	void releaseDataMSB(uint8_t channel, std::vector<MIDIControlEvent> & events);
+
+	static const uint16_t NoParameter = 0xFFFF;
+
+	uint8_t m_status;
+	uint8_t m_data[2];
+	int m_dataCount;
+	bool m_inSysEx;
+	int64_t m_timestamp; //time of the bytes being decoded
+	int m_heldCount; //number of MSBs waiting for their LSB
+
+	struct ChannelState
+	{
+		uint8_t msb[32];
+		bool hasLSB[32];
+		bool msbHeld[32]; //MSB received, but not reported yet
+		int64_t msbTime[32]; //time the held MSB was received
+		uint16_t nrpn; //currently selected NRPN or NoParameter if none or an RPN is selected
+		uint8_t nrpnMSB;
+		uint8_t nrpnLSB;
+		uint8_t dataMSB;
+		bool hasDataLSB;
+		bool dataMSBHeld; //data entry MSB received, but not reported yet
+		int64_t dataMSBTime; //time the held data entry MSB was received
+	};
+	ChannelState m_channels[16];
+};
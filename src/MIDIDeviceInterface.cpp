@@ -5,21 +5,26 @@
 #include <QDebug>
 
 
+const char * MIDIDeviceInterface::VirtualFeedbackPortName = "NerDisco feedback";
+
 MIDIDeviceInterface::MIDIDeviceInterface(QObject *parent)
 	: QObject(parent)
 	, m_midiIn(new RtMidiIn())
+	, m_midiOut(new RtMidiOut())
+	, m_feedbackOpen(false)
 	, m_midiWorker(new MIDIWorker(m_midiIn))
 	, captureDevice("captureDevice", "")
 	, capturing("capturing", false)
+	, feedbackDevice("feedbackDevice", "")
 {
 	//do all possible connections to worker objects
 	connect(&m_workerThread, &QThread::finished, m_midiWorker, &QObject::deleteLater);
 	//connect returning signals
-	connect(m_midiWorker, SIGNAL(midiMessage(double, const QByteArray &)), this, SLOT(messageReceived(double, const QByteArray &)));
 	connect(m_midiWorker, SIGNAL(captureDeviceChanged(const QString &)), captureDevice.GetSharedParameter().get(), SLOT(setValue(const QString &)));
 	connect(m_midiWorker, SIGNAL(captureStateChanged(bool)), capturing.GetSharedParameter().get(), SLOT(setValue(bool)));
 	connect(captureDevice.GetSharedParameter().get(), SIGNAL(valueChanged(const QString &)), this, SLOT(setCaptureDevice(const QString &)));
 	connect(capturing.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(setCaptureState(bool)));
+	connect(feedbackDevice.GetSharedParameter().get(), SIGNAL(valueChanged(const QString &)), this, SLOT(setFeedbackDevice(const QString &)));
 	//move worker objects to thread and run thread
 	m_midiWorker->moveToThread(&m_workerThread);
 	m_workerThread.start();
@@ -31,6 +36,7 @@ MIDIDeviceInterface::~MIDIDeviceInterface()
 	m_workerThread.quit();
 	m_workerThread.wait();
 	delete m_midiIn;
+	delete m_midiOut;
 }
 
 void MIDIDeviceInterface::toXML(QDomElement & parent) const
@@ -45,6 +51,7 @@ void MIDIDeviceInterface::toXML(QDomElement & parent) const
 	}
 	capturing.toXML(element);
 	captureDevice.toXML(element);
+	feedbackDevice.toXML(element);
 	parent.appendChild(element);
 }
 
@@ -59,6 +66,14 @@ MIDIDeviceInterface & MIDIDeviceInterface::fromXML(const QDomElement & parent)
 	//read device name from element
 	captureDevice.fromXML(element);
 	capturing.fromXML(element);
+	try
+	{
+		feedbackDevice.fromXML(element);
+	}
+	catch (std::runtime_error e)
+	{
+		//older settings have no feedback device
+	}
 	return *this;
 }
 
@@ -88,19 +103,101 @@ QString MIDIDeviceInterface::defaultInputDeviceName() const
 	return m_midiWorker->defaultInputDeviceName();
 }
 
-void MIDIDeviceInterface::messageReceived(double deltaTime, const QByteArray & message)
+QStringList MIDIDeviceInterface::outputDeviceNames() const
 {
-	if (message.size() >= 3)
+	QStringList result;
+	const unsigned int count = m_midiOut->getPortCount();
+	for (unsigned int i = 0; i < count; ++i)
 	{
-		//qDebug() << "MIDI message" << message;
-		//check if it is a controller message
-		const unsigned char type = message.at(0);
-		if ((type & 0xF0) == 0xB0)
+		result.append(QString::fromStdString(m_midiOut->getPortName(i)));
+	}
+	return result;
+}
+
+void MIDIDeviceInterface::setFeedbackDevice(const QString & outputName)
+{
+	m_midiOut->closePort();
+	m_feedbackOpen = false;
+	if (outputName.isEmpty())
+	{
+		return;
+	}
+	try
+	{
+		if (outputName == VirtualFeedbackPortName)
+		{
+			//a virtual port lets you connect e.g. to ALSA sequencer clients without a device attached
+			m_midiOut->openVirtualPort(VirtualFeedbackPortName);
+			m_feedbackOpen = true;
+		}
+		else
 		{
-			//split data
-			const unsigned char controller = message.at(1);
-			const QByteArray data = message.mid(2);
-			emit midiControlMessage(deltaTime, controller, data);
+			const int portNumber = outputDeviceNames().indexOf(outputName);
+			if (portNumber >= 0)
+			{
+				m_midiOut->openPort(portNumber);
+				m_feedbackOpen = m_midiOut->isPortOpen();
+			}
 		}
 	}
+	catch (RtMidiError rme)
+	{
+		qDebug() << "Failed to open MIDI feedback device" << outputName << ":" << QString::fromStdString(rme.getMessage());
+		m_midiOut->closePort();
+		m_feedbackOpen = false;
+	}
+}
+
+void MIDIDeviceInterface::sendFeedback(const std::vector<std::vector<unsigned char>> & messages)
+{
+	//RtMidi does not report virtual ports as open, so we keep track ourselves
+	if (!m_feedbackOpen)
+	{
+		return;
+	}
+	try
+	{
+		for (const auto & message : messages)
+		{
+			m_midiOut->sendMessage(&message);
+		}
+	}
+	catch (RtMidiError rme)
+	{
+		qDebug() << "Failed to send MIDI feedback:" << QString::fromStdString(rme.getMessage());
+	}
+}
+
+void MIDIDeviceInterface::processEvents()
+{
+	//drain the event ring the worker fills from the RtMidi callback
+	MIDIRawEvent rawEvent;
+	while (m_midiWorker->popEvent(rawEvent))
+	{
+		//system messages go to the clock. they carry no control data
+		if (rawEvent.data[0] >= 0xF0)
+		{
+			m_clock.message(rawEvent.data, rawEvent.size, rawEvent.timestamp);
+			continue;
+		}
+		//decode message into control events
+		m_events.clear();
+		m_decoder.decode(rawEvent.data, rawEvent.size, rawEvent.timestamp, m_events);
+		for (const auto & event : m_events)
+		{
+			emit midiControlMessage(rawEvent.deltaTime, event);
+		}
+	}
+	//report 14-bit controllers whose LSB did not arrive
+	m_events.clear();
+	m_decoder.flush(MIDIClock::now(), m_events);
+	for (const auto & event : m_events)
+	{
+		emit midiControlMessage(0.0, event);
+	}
+}
+
+MIDIClock::Position MIDIDeviceInterface::clockPosition(int64_t timestamp) const
+{
+	return m_clock.position(timestamp);
 }
@@ -7,8 +7,11 @@
 #include <QStringList>
 #include <QDomDocument>
 #include "Parameters.h"
+#include "MIDIDecoder.h"
+#include "MIDIClock.h"
 
 class RtMidiIn;
+class RtMidiOut;
 class MIDIWorker;
 
 
@@ -29,21 +32,44 @@ public:
 
 	ParameterQString captureDevice;
 	ParameterBool capturing;
+	/// @brief Output device that parameter changes are sent back to. Empty means no feedback.
+	/// Set to VirtualFeedbackPortName to create a virtual port other applications can connect to (not on Windows).
+	ParameterQString feedbackDevice;
+
+	/// @brief Name of the virtual feedback output port.
+	static const char * VirtualFeedbackPortName;
 
 	QStringList inputDeviceNames() const;
 	QString defaultInputDeviceName() const;
+	QStringList outputDeviceNames() const;
+
+	/// @brief Send messages to the feedback output device. Does nothing if no feedback device is open.
+	/// @param messages Complete MIDI messages.
+	void sendFeedback(const std::vector<std::vector<unsigned char>> & messages);
+
+	/// @brief Decode all MIDI messages received since the last call and emit them as control messages.
+	/// Call once per frame, so parameter updates happen at a deterministic point.
+	void processEvents();
+
+	/// @brief Retrieve the musical position estimated from MIDI clock or time code.
+	/// @param timestamp Time in nanoseconds on the steady clock. Use MIDIClock::now() for the current time.
+	MIDIClock::Position clockPosition(int64_t timestamp) const;
 
 signals:
-	void midiControlMessage(double deltaTime, unsigned char controller, const QByteArray & data);
+	void midiControlMessage(double deltaTime, const MIDIControlEvent & event);
 
 protected slots:
 	void setCaptureDevice(const QString & inputName);
 	void setCaptureState(bool capture);
-
-	void messageReceived(double deltaTime, const QByteArray & message);
+	void setFeedbackDevice(const QString & outputName);
 
 private:
 	RtMidiIn * m_midiIn;
+	RtMidiOut * m_midiOut;
+	bool m_feedbackOpen;
 	MIDIWorker * m_midiWorker;
+	MIDIDecoder m_decoder;
+	MIDIClock m_clock;
+	std::vector<MIDIControlEvent> m_events;
 	QThread m_workerThread;
 };
\ No newline at end of file
@@ -26,12 +26,22 @@ MIDIParameterMapping * MIDIInterface::getParameterMapping()
 	return m_mapping;
 }
 
+void MIDIInterface::sendFeedback()
+{
+	std::vector<std::vector<unsigned char>> messages;
+	m_mapping->collectFeedback(messages);
+	if (!messages.empty())
+	{
+		m_interface->sendFeedback(messages);
+	}
+}
+
 MIDIInterface::MIDIInterface()
 	: m_interface(new MIDIDeviceInterface())
 	, m_mapping(new MIDIParameterMapping())
 {
 	m_interface->captureDevice.connect(m_mapping->deviceName);
-	QObject::connect(m_interface, SIGNAL(midiControlMessage(double, unsigned char, const QByteArray &)), m_mapping, SLOT(midiControlMessage(double, unsigned char, const QByteArray &)));
+	QObject::connect(m_interface, SIGNAL(midiControlMessage(double, const MIDIControlEvent &)), m_mapping, SLOT(midiControlMessage(double, const MIDIControlEvent &)));
 }
 
 MIDIInterface::~MIDIInterface()
@@ -29,6 +29,9 @@ public:
 	/// @return Pointer to MIDI parameter mapping object.
 	MIDIParameterMapping * getParameterMapping();
 
+	/// @brief Send changed values of mapped parameters back to the feedback output device. Call once per frame.
+	void sendFeedback();
+
 	/// @Destructor. We delete the QObjects here.
 	~MIDIInterface();
 
@@ -4,12 +4,16 @@
 
 
 MIDIParameterConnection::MIDIParameterConnection()
-	: m_controller(0)
+	: m_type(MIDIControlEvent::ControlChange)
+	, m_channel(AnyChannel)
+	, m_controller(0)
 {
 }
 
-MIDIParameterConnection::MIDIParameterConnection(unsigned char controller, NodeRanged::SPtr parameter, const QString & parameterParentName)
-	: m_controller(controller)
+MIDIParameterConnection::MIDIParameterConnection(unsigned short controller, NodeRanged::SPtr parameter, const QString & parameterParentName, int channel, MIDIControlEvent::Type type)
+	: m_type(type)
+	, m_channel(channel)
+	, m_controller(controller)
 	, m_parameter(parameter)
 	, m_parameterParentName(parameterParentName)
 {
@@ -22,6 +26,14 @@ void MIDIParameterConnection::toXML(QDomElement & parent) const
 	element.setAttribute("parameterName", m_parameter->name());
 	element.setAttribute("parameterParentName", m_parameterParentName);
 	element.setAttribute("controller", m_controller);
+	if (m_channel != AnyChannel)
+	{
+		element.setAttribute("channel", m_channel);
+	}
+	if (m_type != MIDIControlEvent::ControlChange)
+	{
+		element.setAttribute("type", m_type == MIDIControlEvent::Note ? "note" : (m_type == MIDIControlEvent::PitchBend ? "pitchbend" : "nrpn"));
+	}
 	parent.appendChild(element);
 }
 
@@ -34,13 +46,20 @@ MIDIParameterConnection & MIDIParameterConnection::fromXML(const QDomElement & e
 	m_parameter.reset();
 	m_parameterName = element.attribute("parameterName");
 	m_parameterParentName = element.attribute("parameterParentName");
-	m_controller = element.attribute("controller", 0).toUInt();
+	m_controller = element.attribute("controller", 0).toUInt() & 0x3FFF;
+	const QString type = element.attribute("type", "cc");
+	m_type = type == "note" ? MIDIControlEvent::Note : (type == "pitchbend" ? MIDIControlEvent::PitchBend : (type == "nrpn" ? MIDIControlEvent::NRPN : MIDIControlEvent::ControlChange));
+	m_channel = element.attribute("channel", QString::number(AnyChannel)).toInt();
+	if (m_channel < AnyChannel || m_channel > 15)
+	{
+		m_channel = AnyChannel;
+	}
 	return *this;
 }
 
 bool operator==(const MIDIParameterConnection & a, const MIDIParameterConnection & b)
 {
-	return (a.m_controller == b.m_controller && a.m_parameter == b.m_parameter && a.m_parameterName == b.m_parameterName && a.m_parameterParentName == b.m_parameterParentName);
+	return (a.m_type == b.m_type && a.m_channel == b.m_channel && a.m_controller == b.m_controller && a.m_parameter == b.m_parameter && a.m_parameterName == b.m_parameterName && a.m_parameterParentName == b.m_parameterParentName);
 }
 
 bool operator!=(const MIDIParameterConnection & a, const MIDIParameterConnection & b)
@@ -4,18 +4,24 @@
 #include <QObject>
 #include <QDomElement>
 #include "NodeRanged.h"
+#include "MIDIDecoder.h"
 
 
 class MIDIParameterConnection
 {
 public:
-	unsigned char m_controller;
+	/// @brief Channel value for connections that react to a controller on all channels.
+	static const int AnyChannel = -1;
+
+	MIDIControlEvent::Type m_type;
+	int m_channel;
+	unsigned short m_controller; //controller, note or NRPN number, depending on m_type
 	QString m_parameterName;
 	QString m_parameterParentName;
 	NodeRanged::SPtr m_parameter;
 
 	MIDIParameterConnection();
-	MIDIParameterConnection(unsigned char controller, NodeRanged::SPtr parameter, const QString & parameterParentName);
+	MIDIParameterConnection(unsigned short controller, NodeRanged::SPtr parameter, const QString & parameterParentName, int channel = AnyChannel, MIDIControlEvent::Type type = MIDIControlEvent::ControlChange);
 
 	void toXML(QDomElement & parent) const;
 	MIDIParameterConnection & fromXML(const QDomElement & element);
@@ -3,6 +3,13 @@
 #include <QAbstractSlider>
 #include <QAbstractButton>
 #include <stdexcept>
+#include <algorithm>
+
+
+//minimum time between two feedback updates in ms and maximum number of messages per update.
+//this keeps the feedback well below the bandwidth of a USB MIDI link
+static const int FeedbackInterval = 20;
+static const int MaxFeedbackMessages = 32;
 
 
 MIDIParameterMapping::MIDIParameterMapping(QObject * parent)
@@ -12,7 +19,14 @@ MIDIParameterMapping::MIDIParameterMapping(QObject * parent)
 	, learnMode("learnMode", false)
 	, m_learnedGuiSide(false)
 	, m_learnedMidiSide(false)
+	, m_eventCount(0)
+	, m_appliedCount(0)
+	, m_eventsPerSecond(0.0f)
+	, m_coalesceRatio(1.0f)
 {
+	std::fill(m_pendingValues, m_pendingValues + NrOfChannels * SlotsPerChannel, -1.0f);
+	m_statisticsTimer.start();
+	m_feedbackTimer.start();
 	connect(learnMode.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(setLearnMode(bool)));
 }
 
@@ -92,6 +106,7 @@ MIDIParameterMapping & MIDIParameterMapping::fromXML(const QDomElement & parent)
 						//simply ignore unknown/bad nodes...
 					}
 				}
+				updateDispatchTable();
 				return *this;
 			}
 			throw std::runtime_error("No MIDI mappings found for current device!");
@@ -122,6 +137,17 @@ void MIDIParameterMapping::registerMIDIParameter(NodeRanged::SPtr parameter, con
 	connect(parameter.get(), SIGNAL(changed(NodeBase *)), this, SLOT(parameterChanged(NodeBase *)));
 }
 
+QVector<QPair<NodeRanged::SPtr, QString>> MIDIParameterMapping::registeredParameters() const
+{
+	QMutexLocker locker(&m_mutex);
+	QVector<QPair<NodeRanged::SPtr, QString>> result;
+	foreach(const ControlEntry & control, m_controls)
+	{
+		result.append(qMakePair(control.parameter, control.parentName));
+	}
+	return result;
+}
+
 void MIDIParameterMapping::parameterChanged(NodeBase * parameter)
 {
 	QMutexLocker locker(&m_mutex);
@@ -148,14 +174,20 @@ void MIDIParameterMapping::parameterChanged(NodeBase * parameter)
 			}
 		}
 	}
+	else if (m_feedbackConnections.contains(parameter) && !m_feedbackPending.contains(parameter))
+	{
+		m_feedbackPending.append(parameter);
+	}
 }
 
-void MIDIParameterMapping::midiControlMessage(double /*deltaTime*/, unsigned char controller, const QByteArray & data)
+void MIDIParameterMapping::midiControlMessage(double /*deltaTime*/, const MIDIControlEvent & event)
 {
 	QMutexLocker locker(&m_mutex);
 	if (learnMode)
 	{
-		m_learnConnection.m_controller = controller;
+		m_learnConnection.m_type = event.type;
+		m_learnConnection.m_channel = event.channel & 0x0F;
+		m_learnConnection.m_controller = event.number;
 		if (!m_learnedMidiSide)
 		{
 			m_learnedMidiSide = true;
@@ -164,36 +196,218 @@ void MIDIParameterMapping::midiControlMessage(double /*deltaTime*/, unsigned cha
 		//if we have already learned the both GUI side and MIDI side, change the GUI value
 		if (m_learnedGuiSide && m_learnedMidiSide)
 		{
-			//this does not take into account LSB/MSB-values, but we'll leave it like this for now...
-			const float value = (float)data.at(0) / 127.0f;
-			//set new value in object
-			m_learnConnection.m_parameter->setNormalizedValue(value);
+			m_learnConnection.m_parameter->setNormalizedValue(event.value);
 		}
 	}
 	else
 	{
-		if (data.size() > 0)
+		++m_eventCount;
+		//look up connections directly and only store the latest value. it is applied on the next frame
+		const int index = dispatchIndex(event.type, event.channel, event.number);
+		if (index >= 0)
+		{
+			if (!m_dispatchTable[index].isEmpty())
+			{
+				if (m_pendingValues[index] < 0.0f)
+				{
+					m_pendingIndices.append(index);
+				}
+				m_pendingValues[index] = event.value;
+			}
+		}
+		else
 		{
-			//find connection in the list
-			foreach (const MIDIParameterConnection & connection, m_connections)
+			const int key = nrpnKey(event.channel, event.number);
+			if (m_nrpnDispatchTable.contains(key))
 			{
-				if (connection.m_controller == controller)
+				m_pendingNRPNValues[key] = event.value;
+			}
+		}
+	}
+}
+
+void MIDIParameterMapping::applyPendingValues()
+{
+	QMutexLocker locker(&m_mutex);
+	for (auto index : m_pendingIndices)
+	{
+		const float value = m_pendingValues[index];
+		m_pendingValues[index] = -1.0f;
+		//the controller already shows this value, so don't send it back
+		const int channel = index / SlotsPerChannel;
+		const int slot = index % SlotsPerChannel;
+		const MIDIControlEvent::Type type = slot < 128 ? MIDIControlEvent::ControlChange : (slot < 256 ? MIDIControlEvent::Note : MIDIControlEvent::PitchBend);
+		recordReceivedValue(type, channel, slot & 0x7F, feedbackValue(type, value));
+		//set new value in all connected objects
+		for (auto & parameter : m_dispatchTable[index])
+		{
+			parameter->setNormalizedValue(value);
+		}
+	}
+	for (auto iter = m_pendingNRPNValues.cbegin(); iter != m_pendingNRPNValues.cend(); ++iter)
+	{
+		recordReceivedValue(MIDIControlEvent::NRPN, iter.key() >> 14, iter.key() & 0x3FFF, feedbackValue(MIDIControlEvent::NRPN, iter.value()));
+		for (auto & parameter : m_nrpnDispatchTable[iter.key()])
+		{
+			parameter->setNormalizedValue(iter.value());
+		}
+	}
+	m_appliedCount += m_pendingIndices.size() + m_pendingNRPNValues.size();
+	m_pendingIndices.clear();
+	m_pendingNRPNValues.clear();
+	//update statistics
+	const qint64 elapsed = m_statisticsTimer.elapsed();
+	if (elapsed >= 1000)
+	{
+		m_eventsPerSecond = (float)m_eventCount * 1000.0f / (float)elapsed;
+		m_coalesceRatio = m_appliedCount > 0 ? (float)m_eventCount / (float)m_appliedCount : 1.0f;
+		m_eventCount = 0;
+		m_appliedCount = 0;
+		m_statisticsTimer.restart();
+	}
+}
+
+float MIDIParameterMapping::eventsPerSecond() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_eventsPerSecond;
+}
+
+float MIDIParameterMapping::coalesceRatio() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_coalesceRatio;
+}
+
+int MIDIParameterMapping::dispatchIndex(MIDIControlEvent::Type type, int channel, int number)
+{
+	switch (type)
+	{
+		case MIDIControlEvent::ControlChange:
+			return channel * SlotsPerChannel + (number & 0x7F);
+		case MIDIControlEvent::Note:
+			return channel * SlotsPerChannel + 128 + (number & 0x7F);
+		case MIDIControlEvent::PitchBend:
+			return channel * SlotsPerChannel + 256;
+		default:
+			return -1;
+	}
+}
+
+int MIDIParameterMapping::nrpnKey(int channel, int number)
+{
+	return (channel << 14) | (number & 0x3FFF);
+}
+
+int MIDIParameterMapping::feedbackKey(MIDIControlEvent::Type type, int channel, int number)
+{
+	return ((int)type << 18) | ((channel & 0x0F) << 14) | (number & 0x3FFF);
+}
+
+int MIDIParameterMapping::feedbackValue(MIDIControlEvent::Type type, float value)
+{
+	const float resolution = (type == MIDIControlEvent::PitchBend || type == MIDIControlEvent::NRPN) ? 16383.0f : 127.0f;
+	return qRound(std::max(0.0f, std::min(1.0f, value)) * resolution);
+}
+
+void MIDIParameterMapping::recordReceivedValue(MIDIControlEvent::Type type, int channel, int number, int value)
+{
+	m_lastFeedbackValues[feedbackKey(type, channel, number)] = value;
+	//connections for any channel send their feedback to the channel the controller uses
+	m_lastReceivedChannels[feedbackKey(type, 0, number)] = channel;
+}
+
+void MIDIParameterMapping::collectFeedback(std::vector<std::vector<unsigned char>> & messages)
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_feedbackPending.isEmpty() || m_feedbackTimer.elapsed() < FeedbackInterval)
+	{
+		return;
+	}
+	m_feedbackTimer.restart();
+	//count the messages, not the values. a NRPN takes four messages
+	const size_t firstMessage = messages.size();
+	while (!m_feedbackPending.isEmpty() && messages.size() - firstMessage < (size_t)MaxFeedbackMessages)
+	{
+		NodeBase * parameter = m_feedbackPending.takeFirst();
+		for (auto index : m_feedbackConnections.value(parameter))
+		{
+			const MIDIParameterConnection & connection = m_connections.at(index);
+			//connections for any channel send on the channel last received from or on the first channel if nothing was received yet
+			const unsigned char channel = connection.m_channel == MIDIParameterConnection::AnyChannel ?
+				(unsigned char)m_lastReceivedChannels.value(feedbackKey(connection.m_type, 0, connection.m_controller), 0) : (unsigned char)connection.m_channel;
+			const int value = feedbackValue(connection.m_type, connection.m_parameter->normalizedValue());
+			const int key = feedbackKey(connection.m_type, channel, connection.m_controller);
+			if (m_lastFeedbackValues.value(key, -1) == value)
+			{
+				continue;
+			}
+			m_lastFeedbackValues[key] = value;
+			switch (connection.m_type)
+			{
+				case MIDIControlEvent::ControlChange:
+					messages.push_back({(unsigned char)(0xB0 | channel), (unsigned char)(connection.m_controller & 0x7F), (unsigned char)value});
+					break;
+				case MIDIControlEvent::Note:
+					messages.push_back({(unsigned char)(0x90 | channel), (unsigned char)(connection.m_controller & 0x7F), (unsigned char)value});
+					break;
+				case MIDIControlEvent::PitchBend:
+					messages.push_back({(unsigned char)(0xE0 | channel), (unsigned char)(value & 0x7F), (unsigned char)(value >> 7)});
+					break;
+				case MIDIControlEvent::NRPN:
+					messages.push_back({(unsigned char)(0xB0 | channel), 99, (unsigned char)(connection.m_controller >> 7)});
+					messages.push_back({(unsigned char)(0xB0 | channel), 98, (unsigned char)(connection.m_controller & 0x7F)});
+					messages.push_back({(unsigned char)(0xB0 | channel), 6, (unsigned char)(value >> 7)});
+					messages.push_back({(unsigned char)(0xB0 | channel), 38, (unsigned char)(value & 0x7F)});
+					break;
+			}
+		}
+	}
+}
+
+void MIDIParameterMapping::updateDispatchTable()
+{
+	QMutexLocker locker(&m_mutex);
+	for (int i = 0; i < NrOfChannels * SlotsPerChannel; ++i)
+	{
+		m_dispatchTable[i].clear();
+		m_pendingValues[i] = -1.0f;
+	}
+	m_pendingIndices.clear();
+	m_nrpnDispatchTable.clear();
+	m_pendingNRPNValues.clear();
+	m_feedbackConnections.clear();
+	m_feedbackPending.clear();
+	for (int i = 0; i < m_connections.size(); ++i)
+	{
+		const MIDIParameterConnection & connection = m_connections.at(i);
+		if (connection.m_parameter)
+		{
+			m_feedbackConnections[connection.m_parameter.get()].append(i);
+			//connections for any channel are entered for all channels
+			const int firstChannel = connection.m_channel == MIDIParameterConnection::AnyChannel ? 0 : connection.m_channel;
+			const int lastChannel = connection.m_channel == MIDIParameterConnection::AnyChannel ? NrOfChannels - 1 : connection.m_channel;
+			for (int channel = firstChannel; channel <= lastChannel; ++channel)
+			{
+				const int index = dispatchIndex(connection.m_type, channel, connection.m_controller);
+				if (index >= 0)
+				{
+					m_dispatchTable[index].append(connection.m_parameter);
+				}
+				else
 				{
-					//this does not take into account LSB/MSB-values, but we'll leave it like this for now...
-					const float value = (float)data.at(0) / 127.0f;
-					//set new value in object
-					connection.m_parameter->setNormalizedValue(value);
+					m_nrpnDispatchTable[nrpnKey(channel, connection.m_controller)].append(connection.m_parameter);
 				}
 			}
 		}
 	}
 }
 
-void MIDIParameterMapping::addConnection(unsigned char controller, NodeRanged::SPtr parameter, const QString & parameterParentName)
+void MIDIParameterMapping::addConnection(unsigned short controller, NodeRanged::SPtr parameter, const QString & parameterParentName, int channel, MIDIControlEvent::Type type)
 {
 	QMutexLocker locker(&m_mutex);
 	//check if connection is already in the list
-	MIDIParameterConnection newConnnection(controller, parameter, parameterParentName);
+	MIDIParameterConnection newConnnection(controller, parameter, parameterParentName, channel, type);
 	bool found = false;
 	foreach(const MIDIParameterConnection & connection, m_connections)
 	{
@@ -207,6 +421,7 @@ void MIDIParameterMapping::addConnection(unsigned char controller, NodeRanged::S
 	{
 		//add connection to list
 		m_connections.append(newConnnection);
+		updateDispatchTable();
 	}
 }
 
@@ -214,6 +429,7 @@ void MIDIParameterMapping::clearConnections()
 {
 	QMutexLocker locker(&m_mutex);
 	m_connections.clear();
+	updateDispatchTable();
 }
 
 void MIDIParameterMapping::setLearnMode(bool learn)
@@ -222,6 +438,8 @@ void MIDIParameterMapping::setLearnMode(bool learn)
 	m_learnConnection.m_parameter.reset();
 	m_learnConnection.m_parameterName = "";
 	m_learnConnection.m_parameterParentName = "";
+	m_learnConnection.m_type = MIDIControlEvent::ControlChange;
+	m_learnConnection.m_channel = MIDIParameterConnection::AnyChannel;
 	m_learnConnection.m_controller = 0;
 	m_learnedGuiSide = false;
 	m_learnedMidiSide = false;
@@ -235,11 +453,13 @@ void MIDIParameterMapping::storeLearnedConnection()
 	if (learnMode && m_learnedGuiSide && m_learnedMidiSide)
 	{
 		//store connection
-		addConnection(m_learnConnection.m_controller, m_learnConnection.m_parameter, m_learnConnection.m_parameterParentName);
+		addConnection(m_learnConnection.m_controller, m_learnConnection.m_parameter, m_learnConnection.m_parameterParentName, m_learnConnection.m_channel, m_learnConnection.m_type);
 		//clear connection for next round
 		m_learnConnection.m_parameter.reset();
 		m_learnConnection.m_parameterName = "";
 		m_learnConnection.m_parameterParentName = "";
+		m_learnConnection.m_type = MIDIControlEvent::ControlChange;
+	m_learnConnection.m_channel = MIDIParameterConnection::AnyChannel;
 		m_learnConnection.m_controller = 0;
 		m_learnedGuiSide = false;
 		m_learnedMidiSide = false;
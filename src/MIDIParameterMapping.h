@@ -3,9 +3,14 @@
 #include <QObject>
 #include <QString>
 #include <QVector>
+#include <QHash>
+#include <QPair>
+#include <vector>
 #include <QMutex>
+#include <QElapsedTimer>
 
 #include "MIDIParameterConnection.h"
+#include "MIDIDecoder.h"
 #include "Parameters.h"
 
 
@@ -23,6 +28,8 @@ public:
 	/// @param parameterParentName Name of parent of parameter. Use if you have parameters of the same name with different parents.
 	/// @note Call this before loading a mapping or using a mapping for all controls you want to use!
 	void registerMIDIParameter(NodeRanged::SPtr parameter, const QString & parameterParentName = "");
+	/// @brief Retrieve all registered parameters and the names of their parents.
+	QVector<QPair<NodeRanged::SPtr, QString>> registeredParameters() const;
 
 	/// @brief Save the current device mapping to an XML document.
 	/// @param parent The parent to append the mapping to.
@@ -32,6 +39,22 @@ public:
 	/// @note this will throw std::runtime_error if no mapping with the current device name is found in the document.
 	MIDIParameterMapping & fromXML(const QDomElement & parent);
 
+	/// @brief Apply the latest value received for every controller since the last call. Call once per frame.
+	/// Multiple messages for the same controller are coalesced, so only the last value is applied.
+	void applyPendingValues();
+
+	/// @brief Build MIDI messages for mapped parameters that changed, so controller LEDs and motorized faders follow.
+	/// Messages are rate-limited and only sent if the value on the controller would actually change.
+	/// Values that were just received from a controller are not echoed back to it.
+	/// @param messages Complete MIDI messages are appended here.
+	void collectFeedback(std::vector<std::vector<unsigned char>> & messages);
+
+	/// @brief Retrieve the number of MIDI control messages received per second.
+	float eventsPerSecond() const;
+	/// @brief Retrieve the ratio of received MIDI control messages to values actually applied to parameters.
+	/// A ratio of 4 means that on average 4 messages were coalesced into one parameter change.
+	float coalesceRatio() const;
+
 	/// @brief The name of the MIDI device this mapping is for. This used for serializing to/from XML.
 	ParameterQString deviceName;
 	/// @brief If set to true the mapping will monitor registered parameters and the MIDI controller
@@ -43,17 +66,18 @@ public slots:
 	/// @param parameter The parameter the signal is coming from.
 	void parameterChanged(NodeBase * parameter);
 
-	/// @brief Notify the class that a new MIDI message was received.
+	/// @brief Notify the class that a new MIDI control event was received.
 	/// @param deltaTime Delta time to last event.
-	/// @param controller MIDI controller identifier.
-	/// @param data Message data.
-	void midiControlMessage(double deltaTime, unsigned char controller, const QByteArray & data);
+	/// @param event Decoded MIDI event.
+	void midiControlMessage(double deltaTime, const MIDIControlEvent & event);
 
 	/// @brief Add a manual connection from a MIDI control message to a parameter.
-	/// @param controller MIDI controller identifier.
+	/// @param controller MIDI controller, note or NRPN number, depending on type.
 	/// @param parameter Parameter the midi control should change.
 	/// @param parameterParentName Name of parent of parameter. Use if you have parameters of the same name with different parents.
-	void addConnection(unsigned char controller, NodeRanged::SPtr parameter, const QString & parameterParentName = "");
+	/// @param channel MIDI channel [0,15] or MIDIParameterConnection::AnyChannel.
+	/// @param type Type of MIDI message that should change the parameter.
+	void addConnection(unsigned short controller, NodeRanged::SPtr parameter, const QString & parameterParentName = "", int channel = MIDIParameterConnection::AnyChannel, MIDIControlEvent::Type type = MIDIControlEvent::ControlChange);
 
 	/// @brief Remove all current connections.
 	void clearConnections();
@@ -70,6 +94,23 @@ private slots:
 	void setLearnMode(bool learn);
 
 private:
+	/// @brief Rebuild the dispatch table from the list of connections.
+	void updateDispatchTable();
+	/// @brief Get index into the dispatch table for an event or -1 for NRPN events, which are stored in a hash.
+	static int dispatchIndex(MIDIControlEvent::Type type, int channel, int number);
+	/// @brief Get key for NRPN events in the NRPN hashes.
+	static int nrpnKey(int channel, int number);
+	/// @brief Get key for the last value sent to a controller.
+	static int feedbackKey(MIDIControlEvent::Type type, int channel, int number);
+	/// @brief Quantize a normalized value to the resolution of a MIDI message type.
+	static int feedbackValue(MIDIControlEvent::Type type, float value);
+	/// @brief Remember a value and the channel received from a controller, so it is not sent back and feedback goes to that channel.
+	void recordReceivedValue(MIDIControlEvent::Type type, int channel, int number, int value);
+
+	static const int NrOfChannels = 16;
+	//every channel has 128 controllers, 128 notes and pitch bend
+	static const int SlotsPerChannel = 128 + 128 + 1;
+
 	mutable QMutex m_mutex;
 
 	struct ControlEntry
@@ -80,6 +121,31 @@ private:
 	QVector<ControlEntry> m_controls;
 
 	QVector<MIDIParameterConnection> m_connections;
+	/// @brief Parameters connected to a channel and controller, note or pitch bend. Indexed by dispatchIndex().
+	QVector<NodeRanged::SPtr> m_dispatchTable[NrOfChannels * SlotsPerChannel];
+	/// @brief Latest value received for a dispatch table entry or -1 if no value is pending.
+	float m_pendingValues[NrOfChannels * SlotsPerChannel];
+	/// @brief Indices of all entries in m_pendingValues that have a value pending.
+	QVector<int> m_pendingIndices;
+	/// @brief Parameters connected to NRPNs and their pending values. Indexed by nrpnKey().
+	QHash<int, QVector<NodeRanged::SPtr>> m_nrpnDispatchTable;
+	QHash<int, float> m_pendingNRPNValues;
+
+	/// @brief Indices into m_connections for every connected parameter.
+	QHash<NodeBase *, QVector<int>> m_feedbackConnections;
+	/// @brief Parameters whose value needs to be sent back to the controller.
+	QVector<NodeBase *> m_feedbackPending;
+	/// @brief Last value sent to or received from a controller. Indexed by feedbackKey().
+	QHash<int, int> m_lastFeedbackValues;
+	/// @brief Channel a control was last received on. Indexed by feedbackKey() with channel 0.
+	QHash<int, int> m_lastReceivedChannels;
+	QElapsedTimer m_feedbackTimer;
+
+	QElapsedTimer m_statisticsTimer;
+	int m_eventCount;
+	int m_appliedCount;
+	float m_eventsPerSecond;
+	float m_coalesceRatio;
 	MIDIParameterConnection m_learnConnection;
 	bool m_learnedGuiSide;
 	bool m_learnedMidiSide;
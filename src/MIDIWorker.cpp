@@ -1,6 +1,7 @@
 #include "MIDIWorker.h"
 
 #include "rtmidi/RtMidi.h"
+#include <chrono>
 
 
 MIDIWorker::MIDIWorker(RtMidiIn * midiIn, QObject * parent)
@@ -8,6 +9,7 @@ MIDIWorker::MIDIWorker(RtMidiIn * midiIn, QObject * parent)
 	, m_midiIn(midiIn)
 	, m_portNumber(0)
 	, m_capturing(false)
+	, m_droppedEvents(0)
 {
 }
 
@@ -26,8 +28,32 @@ void MIDIWorker::midiCallback(double deltatime, std::vector<unsigned char> * mes
 
 void MIDIWorker::midiCallback(double deltatime, std::vector<unsigned char> * message)
 {
-	QByteArray array = QByteArray::fromRawData(reinterpret_cast<const char *>(message->data()), static_cast<int>(message->size()));
-	emit midiMessage(deltatime, array);
+	//system exclusive messages are not used, so only short messages are stored
+	if (message && !message->empty() && message->size() <= 3)
+	{
+		MIDIRawEvent event;
+		event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		event.deltaTime = deltatime;
+		event.size = static_cast<uint8_t>(message->size());
+		for (size_t i = 0; i < message->size(); ++i)
+		{
+			event.data[i] = (*message)[i];
+		}
+		if (!m_events.push(event))
+		{
+			m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool MIDIWorker::popEvent(MIDIRawEvent & event)
+{
+	return m_events.pop(event);
+}
+
+int MIDIWorker::droppedEvents() const
+{
+	return m_droppedEvents.load(std::memory_order_relaxed);
 }
 
 void MIDIWorker::setCaptureDevice(const QString & deviceName)
@@ -76,6 +102,8 @@ void MIDIWorker::setCaptureState(bool capture)
 					m_midiIn->openPort(m_portNumber);
 					if (m_midiIn->isPortOpen())
 					{
+						//receive MIDI clock and time code, but still ignore SysEx and active sensing
+						m_midiIn->ignoreTypes(true, false, true);
 						m_midiIn->setCallback(&MIDIWorker::midiCallback, this);
 						emit captureStateChanged(true);
 					}
@@ -3,10 +3,23 @@
 #include <QObject>
 #include <QMutex>
 #include <QStringList>
+#include <atomic>
+#include <cstdint>
+#include "SPSCRing.h"
 
 class RtMidiIn;
 
 
+/// @brief Raw MIDI message as received from the device.
+struct MIDIRawEvent
+{
+	int64_t timestamp; //steady_clock time in nanoseconds when the message was received
+	double deltaTime; //time since the last message as reported by RtMidi
+	uint8_t size;
+	uint8_t data[3];
+};
+
+
 class MIDIWorker : public QObject
 {
 	Q_OBJECT
@@ -23,12 +36,17 @@ public:
 	QStringList inputDeviceNames() const;
 	QString defaultInputDeviceName() const;
 
+	/// @brief Retrieve the oldest received MIDI message. Call from one consumer thread only.
+	/// @return False if no message is available.
+	bool popEvent(MIDIRawEvent & event);
+	/// @brief Retrieve the number of messages dropped because the event ring was full.
+	int droppedEvents() const;
+
 public slots:
 	void setCaptureDevice(const QString & deviceName);
 	void setCaptureState(bool capture);
 
 signals:
-	void midiMessage(double deltaTime, const QByteArray & message);
 	void captureDeviceChanged(const QString & deviceName);
 	void captureStateChanged(bool capturing);
 
@@ -38,4 +56,8 @@ private:
 	QString m_deviceName;
 	unsigned int m_portNumber;
 	bool m_capturing;
+
+	/// @brief Messages are written here directly in the RtMidi callback. No locking, no allocation, no Qt.
+	SPSCRing<MIDIRawEvent, 1024> m_events;
+	std::atomic<int> m_droppedEvents;
 };
\ No newline at end of file
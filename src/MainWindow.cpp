@@ -4,39 +4,56 @@
 #include "QAspectRatioLabel.h"
 #include "QtSpinBoxAction.h"
 #include "ParameterQtConnect.h"
+#include "ParameterGraph.h"
+#include "ParameterSmoother.h"
+#include "ParameterStore.h"
+#include "EffectStatistics.h"
+#include "AudioFeatures.h"
+#include "ShowFile.h"
 
 #include <QPainter>
 #include <QDir>
 #include <QFileInfo>
+#include <QFileDialog>
 #include <QMessageBox>
 #include <QGuiApplication>
 #include <QScreen>
+#include <QActionGroup>
+#include <QElapsedTimer>
 
 
 MainWindow::MainWindow(QWidget *parent)
 	: QMainWindow(parent)
 	, ui(new Ui::MainWindow)
-	, m_settingsFileName("settings.xml")
+	, m_audioStatistics(nullptr)
+	, m_settingsFileName("settings.show")
+	, m_applyStep(0)
+	, m_showReadTime(0.0)
+	, m_showApplyTime(0.0)
+	, m_longestApplyStep(0.0)
 	, m_midiInterface(MIDIInterface::getInstance())
 	, previewInterval("previewInterval", 33, 20, 100)
 	, frameBufferWidth("frameBufferWidth", 128, 32, 1024)
 	, frameBufferHeight("frameBufferHeight", 72, 32, 1024)
+	, renderAtDisplaySize("renderAtDisplaySize", false)
+	, superSampling("superSampling", 4, 1, 8)
 	, displayInterval("displayInterval", 50, 20, 100)
-	, displayWidth("displayWidth", 32, 16, 64)
-	, displayHeight("displayHeight", 16, 8, 32)
+	, displayWidth("displayWidth", 32, DisplayImageConverter::MinimumWidth, DisplayImageConverter::MaximumWidth)
+	, displayHeight("displayHeight", 16, DisplayImageConverter::MinimumHeight, DisplayImageConverter::MaximumHeight)
 	, displayBrightness("displayBrightness", 0, -50, 50)
 	, displayContrast("displayContrast", 0, -50, 50)
 	, displayGamma("displayGamma", 220, 100, 400)
 	, crossFadeValue("crossFadeValue", 0, 0, 100)
 {
-	//make all QOpenGLWidgets in the application share resources
-	QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
 	//create GUI
 	ui->setupUi(this);
 	ui->widgetDeckA->setDeckName("DeckA");
 	ui->widgetDeckB->setDeckName("DeckB");
 	ui->widgetDeckA->setScriptPath("effects");
 	ui->widgetDeckB->setScriptPath("effects");
+	//add decks to mixer from bottom to top
+	m_mixer.addLayer(ui->widgetDeckA);
+	m_mixer.addLayer(ui->widgetDeckB);
 	//connect preview gamma/brightness/contrast/crossfade slider to parameter and register for MIDI interaction
 	connectParameter(crossFadeValue, ui->horizontalSliderCrossfade);
 	m_midiInterface->getParameterMapping()->registerMIDIParameter(crossFadeValue.GetSharedParameter());
@@ -50,9 +67,15 @@ MainWindow::MainWindow(QWidget *parent)
 	connect(m_audioInterface.captureDevice.GetSharedParameter().get(), SIGNAL(valueChanged(const QString &)), this, SLOT(audioInputDeviceChanged(const QString &)));
 	connect(ui->actionAudioRecord, SIGNAL(triggered(bool)), this, SLOT(audioRecordTriggered(bool)));
 	connect(ui->actionAudioStop, SIGNAL(triggered()), this, SLOT(audioStopTriggered()));
+	connect(ui->actionAudioFile, SIGNAL(triggered()), this, SLOT(audioOpenFile()));
+	connectParameter(m_audioInterface.captureRealTime, ui->actionAudioRealTime);
 	connect(m_audioInterface.capturing.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(audioCaptureStateChanged(bool)));
 	connect(&m_audioInterface, SIGNAL(levelData(const QVector<float>&, float)), this, SLOT(audioUpdateLevels(const QVector<float>&, float)));
-	connect(&m_audioInterface, SIGNAL(fftData(const QVector<float> &, int, float)), this, SLOT(audioUpdateFFT(const QVector<float> &, int, float)));
+	connect(&m_audioInterface, SIGNAL(fftData(const QVector<float> &, int, float, qint64)), this, SLOT(audioUpdateFFT(const QVector<float> &, int, float, qint64)));
+	//the capture statistics stay visible next to the other status messages
+	m_audioStatistics = new QLabel(this);
+	ui->statusbar->addPermanentWidget(m_audioStatistics);
+	connect(&m_audioInterface, SIGNAL(statistics(const QString &)), m_audioStatistics, SLOT(setText(const QString &)));
 	updateAudioDevices();
 	//update midi devices
 	connect(m_midiInterface->getDeviceInterface()->captureDevice.GetSharedParameter().get(), SIGNAL(valueChanged(const QString &)), this, SLOT(midiInputDeviceChanged(const QString &)));
@@ -60,15 +83,40 @@ MainWindow::MainWindow(QWidget *parent)
 	connect(ui->actionMidiStop, SIGNAL(triggered()), this, SLOT(midiStopTriggered()));
 	connect(m_midiInterface->getDeviceInterface()->capturing.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(midiCaptureStateChanged(bool)));
 	updateMidiDevices();
+	connect(m_midiInterface->getDeviceInterface()->feedbackDevice.GetSharedParameter().get(), SIGNAL(valueChanged(const QString &)), this, SLOT(midiFeedbackDeviceChanged(const QString &)));
+	updateMidiFeedbackDevices();
 	//connect slot to start the midi mapping process
 	connect(ui->actionMidiLearnMapping, SIGNAL(triggered()), this, SLOT(midiLearnMappingToggled()));
 	connect(ui->actionStoreLearnedConnection, SIGNAL(triggered()), this, SLOT(midiStoreLearnedConnection()));
 	connect(m_midiInterface->getParameterMapping(), SIGNAL(learnedConnectionStateChanged(bool)), this, SLOT(midiLearnedConnectionStateChanged(bool)));
+	//connect automation actions
+	connect(ui->actionAutomationRecord, SIGNAL(triggered(bool)), this, SLOT(automationRecordTriggered(bool)));
+	connect(ui->actionAutomationPlay, SIGNAL(triggered(bool)), this, SLOT(automationPlayTriggered(bool)));
+	connect(ui->actionAutomationStop, SIGNAL(triggered()), this, SLOT(automationStopTriggered()));
+	connect(ui->actionAutomationClear, SIGNAL(triggered()), &m_automation, SLOT(clear()));
+	connect(&m_automation, SIGNAL(stateChanged(int)), this, SLOT(automationStateChanged(int)));
+	connectParameter(m_automation.loop, ui->actionAutomationLoop);
+	//connect presets and register their triggers for MIDI notes
+	connectParameter(m_presets.store, ui->actionPresetStore);
+	connect(&m_presets, SIGNAL(presetStored(int)), this, SLOT(presetStored(int)));
+	connect(&m_presets, SIGNAL(presetRecalled(int)), this, SLOT(presetRecalled(int)));
+	for (int i = 0; i < m_presets.triggers.size(); ++i)
+	{
+		m_midiInterface->getParameterMapping()->registerMIDIParameter(m_presets.triggers[i].GetSharedParameter(), "Presets");
+	}
+	m_midiInterface->getParameterMapping()->registerMIDIParameter(m_presets.store.GetSharedParameter(), "Presets");
+	m_midiInterface->getParameterMapping()->registerMIDIParameter(m_presets.morphTime.GetSharedParameter(), "Presets");
+	updatePresetMenu();
 	//connect menu actions
 	connect(ui->actionSaveDeckA, SIGNAL(triggered()), this, SLOT(saveDeckA()));
 	connect(ui->actionSaveAsDeckA, SIGNAL(triggered()), this, SLOT(saveAsDeckA()));
 	connect(ui->actionSaveDeckB, SIGNAL(triggered()), this, SLOT(saveDeckB()));
 	connect(ui->actionSaveAsDeckB, SIGNAL(triggered()), this, SLOT(saveAsDeckB()));
+	connect(ui->actionOpenShow, SIGNAL(triggered()), this, SLOT(openShow()));
+	connect(ui->actionSaveShowAs, SIGNAL(triggered()), this, SLOT(saveShowAs()));
+	connect(&m_showLoader, SIGNAL(loaded(const QString &, const QDomDocument &, const QString &, double)), this, SLOT(showLoaded(const QString &, const QDomDocument &, const QString &, double)));
+	m_applyTimer.setInterval(0);
+	connect(&m_applyTimer, SIGNAL(timeout()), this, SLOT(applyNextShowStep()));
 	connect(ui->actionExit, SIGNAL(triggered()), this, SLOT(exitApplication()));
 	//update the menu showing the effect files
 	updateEffectMenu();
@@ -76,23 +124,31 @@ MainWindow::MainWindow(QWidget *parent)
 	ui->widgetDeckA->updateInterval.connect(previewInterval);
 	ui->widgetDeckA->frameBufferWidth.connect(frameBufferWidth);
 	ui->widgetDeckA->frameBufferHeight.connect(frameBufferHeight);
-	ui->widgetDeckA->updateInterval.connect(previewInterval);
+	ui->widgetDeckB->updateInterval.connect(previewInterval);
 	ui->widgetDeckB->frameBufferWidth.connect(frameBufferWidth);
 	ui->widgetDeckB->frameBufferHeight.connect(frameBufferHeight);
+	ui->widgetDeckA->renderAtDisplaySize.connect(renderAtDisplaySize);
+	ui->widgetDeckA->superSampling.connect(superSampling);
+	ui->widgetDeckA->displayWidth.connect(displayWidth);
+	ui->widgetDeckA->displayHeight.connect(displayHeight);
+	ui->widgetDeckB->renderAtDisplaySize.connect(renderAtDisplaySize);
+	ui->widgetDeckB->superSampling.connect(superSampling);
+	ui->widgetDeckB->displayWidth.connect(displayWidth);
+	ui->widgetDeckB->displayHeight.connect(displayHeight);
 	updateDeckMenu();
 	//connect parameters for preview resolution here
 	connect(displayWidth.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(setDisplayWidth(int)));
 	connect(displayHeight.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(setDisplayHeight(int)));
 	resizeDisplayLabels();
 	//connect parameters in the image converter to parameters here
-	m_displayImageConverter.crossFadeValue.connect(crossFadeValue);
+	connect(crossFadeValue.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(setCrossFade(int)));
 	m_displayImageConverter.displayBrightness.connect(displayBrightness);
 	m_displayImageConverter.displayContrast.connect(displayContrast);
 	m_displayImageConverter.displayGamma.connect(displayGamma);
 	m_displayImageConverter.displayWidth.connect(displayWidth);
 	m_displayImageConverter.displayHeight.connect(displayHeight);
 	connect(&m_displayImageConverter, SIGNAL(previewImageChanged(const QImage &)), this, SLOT(updatePreview(const QImage &)));
-	connect(&m_displayImageConverter, SIGNAL(displayImageChanged(const QImage &)), this, SLOT(updateDisplay(const QImage &)));
+	connect(&m_displayImageConverter, SIGNAL(displayImageChanged(const Image16 &)), this, SLOT(updateDisplay(const Image16 &)));
 	//set up serial display sending thread
 	updateDisplaySerialPortMenu();
 	updateDisplaySettingsMenu();
@@ -101,10 +157,16 @@ MainWindow::MainWindow(QWidget *parent)
 	m_displayThread.displayInterval.connect(displayInterval);
 	connectParameter(m_displayThread.flipHorizontal, ui->actionDisplayFlipHorizontal);
 	connectParameter(m_displayThread.flipVertical, ui->actionDisplayFlipVertical);
+	connectParameter(m_displayThread.extendedProtocol, ui->actionDisplayExtendedProtocol);
+	connectParameter(m_displayThread.reducedColor, ui->actionDisplayReducedColor);
+	connectParameter(m_displayThread.dithering, ui->actionDisplayDithering);
 	connectParameter(m_displayThread.sending, ui->actionDisplayStart);
 	connect(ui->actionDisplayStart, SIGNAL(triggered(bool)), this, SLOT(displayStartSending(bool)));
 	connect(ui->actionDisplayStop, SIGNAL(triggered()), this, SLOT(displayStopSending()));
 	connect(&m_displayThread, SIGNAL(portOpened(bool)), this, SLOT(displayPortStatusChanged(bool)));
+	connect(&m_displayThread, SIGNAL(response(const QString &)), this, SLOT(showResponse(const QString &)));
+	connect(&m_displayThread, SIGNAL(error(const QString &)), this, SLOT(processError(const QString &)));
+	connect(&m_displayThread, SIGNAL(timeout(const QString &)), this, SLOT(processTimeout(const QString &)));
 	connect(m_displayThread.sending.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(displaySendStatusChanged(bool)));
 	connect(m_displayThread.portName.GetSharedParameter().get(), SIGNAL(valueChanged(const QString &)), this, SLOT(displaySerialPortChanged(const QString &)));
 	connect(m_displayThread.baudrate.GetSharedParameter().get(), SIGNAL(valueChanged(int)), this, SLOT(displayBaudrateChanged(int)));
@@ -112,8 +174,33 @@ MainWindow::MainWindow(QWidget *parent)
 	m_displayThread.start();
 	//set up output screens
 	//updateScreenMenu();
-	//retrieve settings from XML for all components
-	loadSettings(m_settingsFileName);
+	//all parameters are registered now. they can be automated
+	m_automation.setParameters(m_midiInterface->getParameterMapping()->registeredParameters());
+	//the deck triggers are momentary. recalling a preset must not fire them or leave them on
+	const QVector<NodeRanged::SPtr> triggers = {ui->widgetDeckA->triggerA.GetSharedParameter(), ui->widgetDeckA->triggerB.GetSharedParameter(),
+		ui->widgetDeckB->triggerA.GetSharedParameter(), ui->widgetDeckB->triggerB.GetSharedParameter()};
+	QVector<QPair<NodeRanged::SPtr, QString>> presetParameters;
+	for (auto parameter : m_midiInterface->getParameterMapping()->registeredParameters())
+	{
+		if (!triggers.contains(parameter.first))
+		{
+			presetParameters.append(parameter);
+		}
+	}
+	m_presets.setParameters(presetParameters);
+	//set the layer opacities from the crossfade. shows with mixer settings override them
+	setCrossFade(crossFadeValue);
+	//retrieve settings for all components. settings used to be stored as XML. import them if there is no show yet
+	if (!QFile::exists(m_settingsFileName) && QFile::exists("settings.xml"))
+	{
+		loadSettings("settings.xml");
+	}
+	else
+	{
+		loadSettings(m_settingsFileName);
+	}
+	ParameterGraph::getInstance()->propagate();
+	updateMixerMenu();
 	//set up signal joiner that waits for both render windows being finished with rendering to grab their framebuffers
 	m_signalJoiner.addObjectToJoin(ui->widgetDeckA);
 	m_signalJoiner.addObjectToJoin(ui->widgetDeckB);
@@ -127,10 +214,11 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
-	//stop display refresh and audio capturing
+	//stop display refresh, applying a show and audio capturing
 	m_displayTimer.stop();
+	m_applyTimer.stop();
 	m_audioInterface.capturing = false;
-	//save settings to XML
+	//save settings to the show file
 	saveSettings(m_settingsFileName);
 	delete ui;
 }
@@ -147,6 +235,8 @@ void MainWindow::toXML(QDomElement & parent) const
 	}
 	frameBufferWidth.toXML(element);
 	frameBufferHeight.toXML(element);
+	renderAtDisplaySize.toXML(element);
+	superSampling.toXML(element);
 	displayInterval.toXML(element);
 	displayWidth.toXML(element);
 	displayHeight.toXML(element);
@@ -167,6 +257,8 @@ MainWindow & MainWindow::fromXML(const QDomElement & parent)
 	//read settings from element
 	frameBufferWidth.fromXML(element);
 	frameBufferHeight.fromXML(element);
+	renderAtDisplaySize.fromXML(element);
+	superSampling.fromXML(element);
 	displayInterval.fromXML(element);
 	displayWidth.fromXML(element);
 	displayHeight.fromXML(element);
@@ -179,133 +271,192 @@ MainWindow & MainWindow::fromXML(const QDomElement & parent)
 
 void MainWindow::loadSettings(const QString & fileName)
 {
-	QDomDocument doc("NerDisco");
-	QFile file(fileName);
-	if (file.open(QIODevice::ReadOnly))
+	try
 	{
-		QString errorMessage;
-		if (doc.setContent(&file, &errorMessage))
+		applySettings(ShowFile::load(fileName).documentElement(), fileName);
+	}
+	catch (std::runtime_error & e)
+	{
+		QMessageBox::information(this, tr("Failed to read settings"), tr("%1. Using default settings.").arg(e.what()));
+	}
+}
+
+void MainWindow::applySettings(const QDomElement & root, const QString & fileName)
+{
+	for (int step = 0; applySettingsStep(root, fileName, step); ++step)
+	{
+	}
+}
+
+bool MainWindow::applySettingsStep(const QDomElement & root, const QString & fileName, int step)
+{
+	try
+	{
+		switch (step)
 		{
-			QDomElement root = doc.documentElement();
-			try
-			{
+			case 0:
 				m_displayImageConverter.fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
-			try
-			{
+				break;
+			case 1:
 				m_displayThread.fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
-			try
-			{
+				break;
+			case 2:
 				m_audioInterface.fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
-			try
-			{
+				break;
+			case 3:
 				m_midiInterface->getDeviceInterface()->fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
-			try
-			{
+				break;
+			case 4:
+				//the mappings are stored per device, so pass the device name to the mapping before reading them
+				ParameterGraph::getInstance()->propagate();
 				m_midiInterface->getParameterMapping()->fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
-			try
-			{
+				break;
+			case 5:
 				ui->widgetDeckA->fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
-			try
-			{
+				break;
+			case 6:
 				ui->widgetDeckB->fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
-			try
-			{
+				break;
+			case 7:
+				m_automation.fromXML(root);
+				break;
+			case 8:
+				try
+				{
+					m_presets.fromXML(root);
+				}
+				catch (std::runtime_error e)
+				{
+					//no presets stored yet
+				}
+				updatePresetActions();
+				break;
+			case 9:
 				fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
-			}
+				break;
+			case 10:
+				//read the mixer last. reading the crossfade sets the layer opacities, which the stored opacities override
+				m_mixer.fromXML(root);
+				break;
+			default:
+				return false;
 		}
-		else
-		{
-			QMessageBox::information(this, tr("Failed to read settings"), tr("Error reading \"%1\": %2. Using default settings.").arg(fileName).arg(errorMessage));
-		}
-		file.close();
 	}
-	else
+	catch (std::runtime_error e)
 	{
-		QMessageBox::information(this, tr("Failed to read settings"), tr("Failed to open \"%1\". Using default settings.").arg(fileName));
+		QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(fileName).arg(e.what()));
 	}
+	return true;
 }
 
 void MainWindow::saveSettings(const QString & fileName)
 {
+	//read the old settings first, so elements of components that are not present now are kept
 	QDomDocument doc("NerDisco");
-	QFile file(fileName);
-	if (file.open(QIODevice::ReadWrite))
+	try
 	{
-		//try reading the file. if this fails, we don't care, we'll fill it now...
-		QDomElement root;
-		if (doc.setContent(&file))
-		{
-			root = doc.documentElement();
-		}
-		if (root.isNull())
-		{
-			//failed reading the file. create and add root node.
-			root = doc.createElement("NerDisco");
-			doc.appendChild(root);
-		}
-		//now store everything in root element
-		try
-		{
-			m_displayImageConverter.toXML(root);
-			m_displayThread.toXML(root);
-			m_audioInterface.toXML(root);
-			m_midiInterface->getDeviceInterface()->toXML(root);
-			m_midiInterface->getParameterMapping()->toXML(root);
-			ui->widgetDeckA->toXML(root);
-			ui->widgetDeckB->toXML(root);
-			toXML(root);
-			file.resize(0);
-			file.reset();
-			file.write(doc.toByteArray());
-		}
-		catch (std::runtime_error e)
-		{
-			QMessageBox::information(this, tr("Failed to save settings"), tr("Error while saving settings to \"%1\". %2").arg(fileName).arg(e.what()));
-		}
-		file.close();
+		doc = ShowFile::load(fileName);
 	}
-	else
+	catch (std::runtime_error &)
+	{
+		//if this fails, we don't care, we'll fill it now...
+	}
+	QDomElement root = doc.documentElement();
+	if (root.isNull())
+	{
+		//failed reading the file. create and add root node.
+		root = doc.createElement("NerDisco");
+		doc.appendChild(root);
+	}
+	//now store everything in root element
+	try
+	{
+		m_displayImageConverter.toXML(root);
+		m_mixer.toXML(root);
+		m_displayThread.toXML(root);
+		m_audioInterface.toXML(root);
+		m_midiInterface->getDeviceInterface()->toXML(root);
+		m_midiInterface->getParameterMapping()->toXML(root);
+		ui->widgetDeckA->toXML(root);
+		ui->widgetDeckB->toXML(root);
+		m_automation.toXML(root);
+		m_presets.toXML(root);
+		toXML(root);
+		ShowFile::save(doc, fileName);
+	}
+	catch (std::runtime_error e)
+	{
+		QMessageBox::information(this, tr("Failed to save settings"), tr("Error while saving settings to \"%1\". %2").arg(fileName).arg(e.what()));
+	}
+}
+
+void MainWindow::openShow()
+{
+	QString fileName = QFileDialog::getOpenFileName(this, tr("Open show"), m_settingsFileName, tr("Shows (*.show *.xml)"));
+	if (!fileName.isEmpty())
+	{
+		//read in the background. output continues until the settings are applied
+		ui->statusbar->showMessage(tr("Loading \"%1\"...").arg(fileName));
+		m_showLoader.load(fileName);
+	}
+}
+
+void MainWindow::showLoaded(const QString & fileName, const QDomDocument & document, const QString & errors, double readTime)
+{
+	if (document.isNull())
 	{
-		QMessageBox::information(this, tr("Failed to save settings"), tr("Failed to open \"%1\". Using default settings.").arg(fileName));
+		QMessageBox::information(this, tr("Failed to open show"), errors);
+		return;
+	}
+	//apply one component per event loop turn, so output frames are rendered in between. a show loaded meanwhile replaces this one
+	m_pendingShow = document;
+	m_pendingShowFileName = fileName;
+	m_applyStep = 0;
+	m_showReadTime = readTime;
+	m_showApplyTime = 0.0;
+	m_longestApplyStep = 0.0;
+	m_applyTimer.start();
+}
+
+void MainWindow::applyNextShowStep()
+{
+	//error messages run an event loop, so stop the timer until the step is done
+	m_applyTimer.stop();
+	const QDomDocument document = m_pendingShow;
+	QElapsedTimer timer;
+	timer.start();
+	const bool applied = applySettingsStep(document.documentElement(), m_pendingShowFileName, m_applyStep);
+	const double stepTime = timer.nsecsElapsed() / 1000000.0;
+	if (document != m_pendingShow)
+	{
+		//another show was loaded meanwhile and is applied from its start
+		return;
+	}
+	m_showApplyTime += stepTime;
+	m_longestApplyStep = qMax(m_longestApplyStep, stepTime);
+	if (applied)
+	{
+		++m_applyStep;
+		m_applyTimer.start();
+		return;
+	}
+	ParameterGraph::getInstance()->propagate();
+	updateMixerMenu();
+	//the show is saved to the file it was loaded from
+	m_settingsFileName = m_pendingShowFileName;
+	m_pendingShow = QDomDocument();
+	const QString message = tr("Loaded \"%1\". Read in %2ms in the background, applied in %3 steps taking %4ms, longest step %5ms")
+		.arg(m_settingsFileName).arg(m_showReadTime, 0, 'f', 1).arg(m_applyStep).arg(m_showApplyTime, 0, 'f', 1).arg(m_longestApplyStep, 0, 'f', 1);
+	ui->statusbar->showMessage(message);
+}
+
+void MainWindow::saveShowAs()
+{
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Save show as"), m_settingsFileName, tr("Shows (*.show);;XML settings (*.xml)"));
+	if (!fileName.isEmpty())
+	{
+		saveSettings(fileName);
+		m_settingsFileName = fileName;
 	}
 }
 
@@ -381,6 +532,14 @@ void MainWindow::updateAudioDevices()
 		//if this is the active audio device, select it
 		action->setChecked(inputDevices.at(i) == m_audioInterface.captureDevice);
 	}
+	//add the file source if one is selected
+	if (AudioInterface::isFileSource(m_audioInterface.captureDevice))
+	{
+		action = deviceMenu->addAction(m_audioInterface.captureDevice);
+		action->setCheckable(true);
+		action->setChecked(true);
+		connect(action, SIGNAL(triggered()), this, SLOT(audioInputDeviceSelected()));
+	}
 	//add refresh action
 	QAction * refresh = deviceMenu->addAction(QIcon(":/view-refresh.png"), tr("Refresh"));
 	connect(refresh, SIGNAL(triggered()), this, SLOT(updateAudioDevices()));
@@ -405,11 +564,26 @@ void MainWindow::audioInputDeviceSelected()
 	}
 }
 
+void MainWindow::audioOpenFile()
+{
+	QString fileName = QFileDialog::getOpenFileName(this, tr("Open audio file or pipe"), QString(), tr("WAVE files (*.wav);;Raw PCM files and pipes (*)"));
+	if (!fileName.isEmpty())
+	{
+		m_audioInterface.capturing = false;
+		m_audioInterface.captureDevice = AudioInterface::fileSourceName(fileName);
+	}
+}
+
 void MainWindow::audioInputDeviceChanged(const QString & name)
 {
 	//disable buttons if not audio device selected
 	ui->actionAudioRecord->setEnabled(name != "");
 	ui->actionAudioStop->setEnabled(name != "");
+	//list a newly selected file source
+	if (AudioInterface::isFileSource(name))
+	{
+		updateAudioDevices();
+	}
 	//check which action to select
 	QMenu * menu = ui->actionAudioDevices->menu();
 	if (menu && menu->actions().size() > 0)
@@ -463,8 +637,10 @@ void MainWindow::audioUpdateLevels(const QVector<float> & data, float /*timeus*/
 	ui->labelSpectrumImage->update();
 }
 
-void MainWindow::audioUpdateFFT(const QVector<float> & spectrum, int channels, float timeus)
+void MainWindow::audioUpdateFFT(const QVector<float> & spectrum, int channels, float timeus, qint64 streamTime)
 {
+	//pass the spectrum on to the effects. beats are detected in audio time, so they don't depend on when the block arrived
+	AudioFeatures::getInstance()->addSpectrum(spectrum, streamTime);
 	//qDebug() << "Audio data arrived" << timeus / 1000;
 	QImage image(ui->labelSpectrumImage->size(), QImage::Format_ARGB32);
 	QPainter painter(&image);
@@ -537,6 +713,71 @@ void MainWindow::midiInputDeviceSelected()
 	}
 }
 
+void MainWindow::updateMidiFeedbackDevices()
+{
+	//clear old menu
+	QMenu * deviceMenu = ui->actionMidiFeedbackDevices->menu();
+	if (deviceMenu)
+	{
+		//remove all actions
+		deviceMenu->clear();
+	}
+	else
+	{
+		//menu does not exist create it
+		deviceMenu = new QMenu(this);
+	}
+	const QString currentDevice = m_midiInterface->getDeviceInterface()->feedbackDevice;
+	//add default device and virtual port
+	QAction * action = deviceMenu->addAction(tr("None"));
+	action->setCheckable(true);
+	action->setChecked(currentDevice.isEmpty());
+	connect(action, SIGNAL(triggered()), this, SLOT(midiFeedbackDeviceSelected()));
+	action = deviceMenu->addAction(MIDIDeviceInterface::VirtualFeedbackPortName);
+	action->setCheckable(true);
+	action->setChecked(currentDevice == MIDIDeviceInterface::VirtualFeedbackPortName);
+	connect(action, SIGNAL(triggered()), this, SLOT(midiFeedbackDeviceSelected()));
+	deviceMenu->addSeparator();
+	//add actual devices
+	QStringList midiDevices = m_midiInterface->getDeviceInterface()->outputDeviceNames();
+	for (int i = 0; i < midiDevices.size(); ++i)
+	{
+		action = deviceMenu->addAction(midiDevices.at(i));
+		action->setCheckable(true);
+		action->setChecked(midiDevices.at(i) == currentDevice);
+		connect(action, SIGNAL(triggered()), this, SLOT(midiFeedbackDeviceSelected()));
+	}
+	//add refresh action
+	QAction * refresh = deviceMenu->addAction(QIcon(":/view-refresh.png"), tr("Refresh"));
+	connect(refresh, SIGNAL(triggered()), this, SLOT(updateMidiFeedbackDevices()));
+	//add menu to UI
+	ui->actionMidiFeedbackDevices->setMenu(deviceMenu);
+}
+
+void MainWindow::midiFeedbackDeviceSelected()
+{
+	QAction * action = qobject_cast<QAction*>(sender());
+	if (action)
+	{
+		m_midiInterface->getDeviceInterface()->feedbackDevice = action->text() == tr("None") ? "" : action->text();
+	}
+}
+
+void MainWindow::midiFeedbackDeviceChanged(const QString & name)
+{
+	QMenu * menu = ui->actionMidiFeedbackDevices->menu();
+	if (menu)
+	{
+		for (auto action : menu->actions())
+		{
+			if (action->isCheckable())
+			{
+				action->setChecked(action->text() == name || (action->text() == tr("None") && name == ""));
+			}
+		}
+	}
+}
+
 void MainWindow::midiInputDeviceChanged(const QString & name)
 {
 	//disable buttons if not audio device selected
@@ -552,28 +793,13 @@ void MainWindow::midiInputDeviceChanged(const QString & name)
 		}
 	}
 	//try to load MIDI mappings for device
-	QDomDocument doc("NerDisco");
-	QFile file(m_settingsFileName);
-	if (file.open(QIODevice::ReadOnly))
+	try
 	{
-		QString errorMessage;
-		if (doc.setContent(&file, &errorMessage))
-		{
-			QDomElement root = doc.documentElement();
-			try
-			{
-				m_midiInterface->getParameterMapping()->fromXML(root);
-			}
-			catch (std::runtime_error e)
-			{
-				QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(m_settingsFileName).arg(e.what()));
-			}
-		}
-		else
-		{
-			QMessageBox::information(this, tr("Failed to read settings"), tr("Error reading \"%1\": %2. Using default settings.").arg(m_settingsFileName).arg(errorMessage));
-		}
-		file.close();
+		m_midiInterface->getParameterMapping()->fromXML(ShowFile::load(m_settingsFileName).documentElement());
+	}
+	catch (std::runtime_error e)
+	{
+		QMessageBox::information(this, tr("Failed to read settings"), tr("Error while reading settings from \"%1\". %2").arg(m_settingsFileName).arg(e.what()));
 	}
 }
 
@@ -627,6 +853,98 @@ void MainWindow::midiStoreLearnedConnection()
 
 //-------------------------------------------------------------------------------------------------
 
+void MainWindow::automationRecordTriggered(bool checked)
+{
+	if (checked)
+	{
+		m_automation.record(MIDIClock::now());
+	}
+	else
+	{
+		m_automation.stop(MIDIClock::now());
+	}
+}
+
+void MainWindow::automationPlayTriggered(bool checked)
+{
+	if (checked)
+	{
+		m_automation.play(MIDIClock::now());
+	}
+	else
+	{
+		m_automation.stop(MIDIClock::now());
+	}
+}
+
+void MainWindow::automationStopTriggered()
+{
+	m_automation.stop(MIDIClock::now());
+}
+
+void MainWindow::automationStateChanged(int state)
+{
+	ui->actionAutomationRecord->setChecked(state == AutomationRecorder::Recording);
+	ui->actionAutomationPlay->setChecked(state == AutomationRecorder::Playing);
+	ui->actionAutomationPlay->setEnabled(m_automation.laneCount() > 0);
+	ui->actionAutomationClear->setEnabled(m_automation.laneCount() > 0);
+	ui->statusbar->showMessage(tr("Automation: %1 parameters, %2 s, %3 bytes").arg(m_automation.laneCount()).arg(m_automation.length(), 0, 'f', 1).arg(m_automation.dataSize()));
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void MainWindow::updatePresetMenu()
+{
+	//one action per preset. with "Store" checked it stores the current state, else it recalls the preset
+	for (int i = 0; i < PresetBank::PresetCount; ++i)
+	{
+		QAction * action = ui->menuPresets->addAction(tr("Preset %1").arg(i + 1));
+		action->setData(i);
+		connect(action, SIGNAL(triggered()), this, SLOT(presetSelected()));
+	}
+	connect(m_presets.store.GetSharedParameter().get(), SIGNAL(valueChanged(bool)), this, SLOT(updatePresetActions()));
+	updatePresetActions();
+	ui->menuPresets->addSeparator();
+	QtSpinBoxAction * morphTimeAction = new QtSpinBoxAction("Morph time", "ms");
+	morphTimeAction->setObjectName("morphTime");
+	ui->menuPresets->addAction(morphTimeAction);
+	connectParameter(m_presets.morphTime, morphTimeAction->control());
+}
+
+void MainWindow::presetSelected()
+{
+	QAction * action = qobject_cast<QAction*>(sender());
+	if (action)
+	{
+		m_presets.select(action->data().toInt());
+	}
+}
+
+void MainWindow::updatePresetActions()
+{
+	//presets can only be recalled once they have been stored
+	foreach(QAction * action, ui->menuPresets->actions())
+	{
+		if (action->data().type() == QVariant::Int)
+		{
+			action->setEnabled(m_presets.hasPreset(action->data().toInt()) || m_presets.store);
+		}
+	}
+}
+
+void MainWindow::presetStored(int index)
+{
+	updatePresetActions();
+	ui->statusbar->showMessage(tr("Stored preset %1").arg(index + 1));
+}
+
+void MainWindow::presetRecalled(int index)
+{
+	ui->statusbar->showMessage(tr("Recalled preset %1").arg(index + 1));
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void MainWindow::updateDisplaySerialPortMenu()
 {
 	//clear old menu
@@ -710,6 +1028,24 @@ void MainWindow::updateDisplaySettingsMenu()
 	heightAction->setObjectName("displayHeight");
 	ui->menuDisplaySettings->insertAction(ui->actionDisplayStart, heightAction);
 	connectParameter(displayHeight, heightAction->control());
+	//current model and budgets to keep the LED supply from being overloaded
+	ui->menuDisplaySettings->addSeparator();
+	QtSpinBoxAction * ledCurrentAction = new QtSpinBoxAction("LED channel current", "mA");
+	ledCurrentAction->setObjectName("ledCurrent");
+	ui->menuDisplaySettings->addAction(ledCurrentAction);
+	connectParameter(m_displayThread.ledCurrent, ledCurrentAction->control());
+	QtSpinBoxAction * powerLimitAction = new QtSpinBoxAction("Power limit", "mA");
+	powerLimitAction->setObjectName("powerLimit");
+	ui->menuDisplaySettings->addAction(powerLimitAction);
+	connectParameter(m_displayThread.powerLimit, powerLimitAction->control());
+	QtSpinBoxAction * powerSegmentsAction = new QtSpinBoxAction("Power segments");
+	powerSegmentsAction->setObjectName("powerSegments");
+	ui->menuDisplaySettings->addAction(powerSegmentsAction);
+	connectParameter(m_displayThread.powerSegments, powerSegmentsAction->control());
+	QtSpinBoxAction * segmentPowerLimitAction = new QtSpinBoxAction("Segment power limit", "mA");
+	segmentPowerLimitAction->setObjectName("segmentPowerLimit");
+	ui->menuDisplaySettings->addAction(segmentPowerLimitAction);
+	connectParameter(m_displayThread.segmentPowerLimit, segmentPowerLimitAction->control());
 }
 
 void MainWindow::displaySerialPortChanged(const QString & name)
@@ -835,33 +1171,91 @@ void MainWindow::updateScreenMenu()
 
 void MainWindow::updateDeckImages()
 {
-	//check if we're still waiting for one or both views to finish rendering
+	//apply MIDI controller changes and propagate parameter changes since the last frame to all linked parameters
+	m_midiInterface->getDeviceInterface()->processEvents();
+	m_midiInterface->getParameterMapping()->applyPendingValues();
+	m_automation.update(MIDIClock::now());
+	m_presets.update(MIDIClock::now());
+	ParameterGraph::getInstance()->propagate();
+	//hand all values changed in this frame to the worker threads as one snapshot
+	ParameterStore::getInstance()->commit();
+	m_midiInterface->sendFeedback();
+	//check if we're still waiting for one or more views to finish rendering
 	if (!m_signalJoiner.isJoining())
 	{
-		ui->widgetDeckA->grabFramebufferAfterSwap();
-		ui->widgetDeckB->grabFramebufferAfterSwap();
-		m_signalJoiner.start();
-		ui->widgetDeckA->render();
-		ui->widgetDeckB->render();
+		//pass the tempo from MIDI clock to all decks, sampled once, so they're in phase
+		const int64_t frameTime = MIDIClock::now();
+		const MIDIClock::Position position = m_midiInterface->getDeviceInterface()->clockPosition(frameTime);
+		for (int i = 0; i < m_mixer.layerCount(); ++i)
+		{
+			m_mixer.layer(i).deck->setTempo(position.beatPhase, position.bar, position.bpm);
+		}
+		//advance smoothed parameter values and audio features once per rendered frame
+		ParameterSmoother::getInstance()->update(frameTime);
+		AudioFeatures::getInstance()->update(frameTime);
+		//only decks contributing to the mix are rendered. the others cost neither rendering nor readback
+		m_mixer.updateLayerStates();
+		QVector<QObject*> renderedDecks;
+		for (int i = 0; i < m_mixer.layerCount(); ++i)
+		{
+			if (m_mixer.isLayerRendered(i))
+			{
+				renderedDecks.append(m_mixer.layer(i).deck);
+			}
+		}
+		if (renderedDecks.isEmpty())
+		{
+			//nothing to render. mix directly
+			grabDeckImages();
+			return;
+		}
+		m_signalJoiner.start(renderedDecks);
+		for (int i = 0; i < m_mixer.layerCount(); ++i)
+		{
+			if (m_mixer.isLayerRendered(i))
+			{
+				m_mixer.layer(i).deck->render();
+			}
+		}
 	}
 }
 
 void MainWindow::grabDeckImages()
 {
 	m_signalJoiner.stop();
-	//grab images from the decks and convert for display
-	m_displayImageConverter.convertImages(ui->widgetDeckA->getGrabbedFramebuffer(), ui->widgetDeckB->getGrabbedFramebuffer());
+	//mix deck images on the GPU and convert for display
+	const Image16 mixedImage = m_mixer.mix();
+	if (!mixedImage.isNull())
+	{
+		m_displayImageConverter.convertImage(mixedImage);
+	}
+}
+
+void MainWindow::setCrossFade(int /*value*/)
+{
+	//deck A is the opaque bottom layer and deck B fades in on top of it. this results in a linear crossfade
+	//deck A is suspended by the mixer when deck B covers it completely
+	m_mixer.layer(0).opacity = 100;
+	m_mixer.layer(1).opacity = (int)(100 * crossFadeValue.normalizedValue());
 }
 
 void MainWindow::updatePreview(const QImage & image)
 {
-	ui->labelFinalImage->setPixmap(QPixmap::fromImage(image));
+	//when rendering at display size the preview is tiny. scale it up to the label size
+	if (image.width() < ui->labelFinalImage->width())
+	{
+		ui->labelFinalImage->setPixmap(QPixmap::fromImage(image.scaled(ui->labelFinalImage->size())));
+	}
+	else
+	{
+		ui->labelFinalImage->setPixmap(QPixmap::fromImage(image));
+	}
 }
 
-void MainWindow::updateDisplay(const QImage & image)
+void MainWindow::updateDisplay(const Image16 & image)
 {
 	m_displayThread.sendImage(image);
-	ui->labelRealImage->setPixmap(QPixmap::fromImage(image.scaled(ui->labelFinalImage->size())));
+	ui->labelRealImage->setPixmap(QPixmap::fromImage(image.toImage().scaled(ui->labelFinalImage->size())));
 }
 
 void MainWindow::updateEffectMenu()
@@ -908,6 +1302,11 @@ void MainWindow::updateEffectMenu()
 		connect(refreshA, SIGNAL(triggered()), this, SLOT(updateEffectMenu()));
 		QAction * refreshB = menuB->addAction(QIcon(":/view-refresh.png"), tr("Refresh"));
 		connect(refreshB, SIGNAL(triggered()), this, SLOT(updateEffectMenu()));
+		//add statistics export actions
+		QAction * exportA = menuA->addAction(tr("Export render times..."));
+		connect(exportA, SIGNAL(triggered()), this, SLOT(exportEffectStatistics()));
+		QAction * exportB = menuB->addAction(tr("Export render times..."));
+		connect(exportB, SIGNAL(triggered()), this, SLOT(exportEffectStatistics()));
 		//add script cycling actions to menu
 		menuA->addSeparator();
 		QAction * cycleActionA = menuA->addAction(QIcon(":/autocycle_effects.png"), tr("Auto-cycle scripts"));
@@ -917,6 +1316,10 @@ void MainWindow::updateEffectMenu()
 		intervalActionA->setObjectName("autoCycleIntervalA");
 		menuA->addAction(intervalActionA);
 		connectParameter(ui->widgetDeckA->autoCycleInterval, intervalActionA->control());
+		QtSpinBoxAction * budgetActionA = new QtSpinBoxAction("Frame budget", "ms");
+		budgetActionA->setObjectName("frameBudgetA");
+		menuA->addAction(budgetActionA);
+		connectParameter(ui->widgetDeckA->frameBudget, budgetActionA->control());
 		menuB->addSeparator();
 		QAction * cycleActionB = menuB->addAction(QIcon(":/autocycle_effects.png"), tr("Auto-cycle scripts"));
 		cycleActionB->setCheckable(true);
@@ -925,12 +1328,60 @@ void MainWindow::updateEffectMenu()
 		intervalActionB->setObjectName("autoCycleIntervalB");
 		menuB->addAction(intervalActionB);
 		connectParameter(ui->widgetDeckB->autoCycleInterval, intervalActionB->control());
+		QtSpinBoxAction * budgetActionB = new QtSpinBoxAction("Frame budget", "ms");
+		budgetActionB->setObjectName("frameBudgetB");
+		menuB->addAction(budgetActionB);
+		connectParameter(ui->widgetDeckB->frameBudget, budgetActionB->control());
+		//show the current render times when the menus open
+		connect(menuA, SIGNAL(aboutToShow()), this, SLOT(updateEffectCosts()));
+		connect(menuB, SIGNAL(aboutToShow()), this, SLOT(updateEffectCosts()));
 		//add new menus
 		ui->actionLoadDeckA->setMenu(menuA);
 		ui->actionLoadDeckB->setMenu(menuB);
 	}
 }
 
+void MainWindow::updateEffectCosts()
+{
+	//append the average render time to the name of all measured effects
+	EffectStatistics::SPtr statistics = EffectStatistics::getInstance();
+	QList<QMenu *> menus;
+	menus << ui->actionLoadDeckA->menu() << ui->actionLoadDeckB->menu();
+	foreach (QMenu * menu, menus)
+	{
+		if (menu)
+		{
+			foreach (QAction * action, menu->actions())
+			{
+				const QString path = action->data().toString();
+				if (!path.isEmpty())
+				{
+					QString text = QFileInfo(path).baseName();
+					if (statistics->isValid(path))
+					{
+						text += QString(" (%1 ms)").arg(statistics->averageTime(path), 0, 'f', 2);
+					}
+					action->setText(text);
+				}
+			}
+		}
+	}
+}
+
+void MainWindow::exportEffectStatistics()
+{
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Export render times"), "effects.csv", tr("CSV files (*.csv)"));
+	if (!fileName.isEmpty())
+	{
+		QStringList effects = Deck::buildScriptList("./effects");
+		effects.sort();
+		if (!EffectStatistics::getInstance()->exportCSV(fileName, effects))
+		{
+			QMessageBox::warning(this, tr("Failed to export render times"), tr("Failed to write \"") + fileName + "\".");
+		}
+	}
+}
+
 void MainWindow::updateDeckMenu()
 {
 	//add spinbox actions to menu
@@ -946,6 +1397,13 @@ void MainWindow::updateDeckMenu()
 	heightActionA->setObjectName("frameBufferHeight");
 	ui->menuSettingsDeckA->addAction(heightActionA);
 	connectParameter(frameBufferHeight, heightActionA->control());
+	QAction * displaySizeActionA = ui->menuSettingsDeckA->addAction(tr("Render at display size"));
+	displaySizeActionA->setCheckable(true);
+	connectParameter(renderAtDisplaySize, displaySizeActionA);
+	QtSpinBoxAction * superSamplingActionA = new QtSpinBoxAction("Supersampling", "x");
+	superSamplingActionA->setObjectName("superSampling");
+	ui->menuSettingsDeckA->addAction(superSamplingActionA);
+	connectParameter(superSampling, superSamplingActionA->control());
 	//deck B
 	QtSpinBoxAction * intervalActionB = new QtSpinBoxAction("Update interval", "ms");
 	intervalActionB->setObjectName("updateInterval");
@@ -959,6 +1417,55 @@ void MainWindow::updateDeckMenu()
 	heightActionB->setObjectName("frameBufferHeight");
 	ui->menuSettingsDeckB->addAction(heightActionB);
 	connectParameter(frameBufferHeight, heightActionB->control());
+	QAction * displaySizeActionB = ui->menuSettingsDeckB->addAction(tr("Render at display size"));
+	displaySizeActionB->setCheckable(true);
+	connectParameter(renderAtDisplaySize, displaySizeActionB);
+	QtSpinBoxAction * superSamplingActionB = new QtSpinBoxAction("Supersampling", "x");
+	superSamplingActionB->setObjectName("superSampling");
+	ui->menuSettingsDeckB->addAction(superSamplingActionB);
+	connectParameter(superSampling, superSamplingActionB->control());
+}
+
+void MainWindow::updateMixerMenu()
+{
+	//add blend mode selection for every layer to the deck settings menus
+	QMenu * deckMenus[2] = { ui->menuSettingsDeckA, ui->menuSettingsDeckB };
+	for (int i = 0; i < m_mixer.layerCount() && i < 2; ++i)
+	{
+		//this is called again for every show loaded. clear the old menu instead of adding another one
+		QMenu * blendMenu = deckMenus[i]->findChild<QMenu *>("menuBlendMode", Qt::FindDirectChildrenOnly);
+		if (blendMenu)
+		{
+			//remove all actions and the old action group with them
+			blendMenu->clear();
+			qDeleteAll(blendMenu->findChildren<QActionGroup *>(QString(), Qt::FindDirectChildrenOnly));
+		}
+		else
+		{
+			blendMenu = deckMenus[i]->addMenu(tr("Blend mode"));
+			blendMenu->setObjectName("menuBlendMode");
+		}
+		QActionGroup * blendGroup = new QActionGroup(blendMenu);
+		for (int mode = BlendNormal; mode <= BlendDifference; ++mode)
+		{
+			QAction * action = blendMenu->addAction(m_mixer.layer(i).blendMode.GetSharedParameter()->valueName(mode));
+			action->setCheckable(true);
+			action->setData(QPoint(i, mode));
+			action->setChecked(m_mixer.layer(i).blendMode == (BlendMode)mode);
+			blendGroup->addAction(action);
+			connect(action, SIGNAL(triggered()), this, SLOT(mixerBlendModeSelected()));
+		}
+	}
+}
+
+void MainWindow::mixerBlendModeSelected()
+{
+	QAction * action = qobject_cast<QAction*>(sender());
+	if (action)
+	{
+		const QPoint layerAndMode = action->data().toPoint();
+		m_mixer.layer(layerAndMode.x()).blendMode = (BlendMode)layerAndMode.y();
+	}
 }
 
 void MainWindow::loadDeckA(bool /*checked*/)
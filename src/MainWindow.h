@@ -7,10 +7,15 @@
 #include "MIDIInterface.h"
 #include "MIDIParameterMapping.h"
 #include "DisplayImageConverter.h"
+#include "Mixer.h"
+#include "AutomationRecorder.h"
+#include "PresetBank.h"
+#include "ShowLoadThread.h"
 #include "Parameters.h"
 
 #include <QMainWindow>
 #include <QTimer>
+#include <QLabel>
 
 
 namespace Ui { class MainWindow; }
@@ -30,12 +35,16 @@ public:
 	/// @param parent The parent element to load the settings from.
 	MainWindow & fromXML(const QDomElement & parent);
 
+	/// @brief Load settings of all components from a show or XML file.
 	void loadSettings(const QString & fileName);
+	/// @brief Save settings of all components to a file. Saves XML if the file name ends in ".xml", else a binary show file.
 	void saveSettings(const QString & fileName);
 
 	ParameterInt previewInterval;
 	ParameterInt frameBufferWidth;
 	ParameterInt frameBufferHeight;
+	ParameterBool renderAtDisplaySize;
+	ParameterInt superSampling;
 	ParameterInt displayInterval;
 	ParameterInt displayWidth;
 	ParameterInt displayHeight;
@@ -48,7 +57,8 @@ protected slots:
     void updateDeckImages();
 	void grabDeckImages();
 	void updatePreview(const QImage & image);
-	void updateDisplay(const QImage & image);
+	void setCrossFade(int value);
+	void updateDisplay(const Image16 & image);
 
 	void setDisplayWidth(int width);
 	void setDisplayHeight(int height);
@@ -57,15 +67,19 @@ protected slots:
 	void updateAudioDevices();
     void audioInputDeviceSelected();
     void audioInputDeviceChanged(const QString & name);
+    void audioOpenFile();
     void audioRecordTriggered(bool checked);
     void audioStopTriggered();
     void audioCaptureStateChanged(bool capturing);
     void audioUpdateLevels(const QVector<float> & data, float timeus);
-	void audioUpdateFFT(const QVector<float> & spectrum, int channels, float timeus);
+	void audioUpdateFFT(const QVector<float> & spectrum, int channels, float timeus, qint64 streamTime);
 
 	void updateMidiDevices();
 	void midiInputDeviceSelected();
 	void midiInputDeviceChanged(const QString & name);
+	void updateMidiFeedbackDevices();
+	void midiFeedbackDeviceSelected();
+	void midiFeedbackDeviceChanged(const QString & name);
 	void midiStartTriggered(bool checked);
 	void midiStopTriggered();
 	void midiCaptureStateChanged(bool capturing);
@@ -73,6 +87,17 @@ protected slots:
 	void midiStoreLearnedConnection();
 	void midiLearnedConnectionStateChanged(bool valid);
 
+	void automationRecordTriggered(bool checked);
+	void automationPlayTriggered(bool checked);
+	void automationStopTriggered();
+	void automationStateChanged(int state);
+
+	void updatePresetMenu();
+	void updatePresetActions();
+	void presetSelected();
+	void presetStored(int index);
+	void presetRecalled(int index);
+
 	void updateDisplaySerialPortMenu();
 	void updateDisplaySettingsMenu();
 	void displaySerialPortSelected();
@@ -90,7 +115,11 @@ protected slots:
 	void updateScreenMenu();
 
 	void updateEffectMenu();
+	void updateEffectCosts();
+	void exportEffectStatistics();
 	void updateDeckMenu();
+	void updateMixerMenu();
+	void mixerBlendModeSelected();
     void loadDeckA(bool checked = false);
     void saveDeckA(bool checked = false);
     void saveAsDeckA(bool checked = false);
@@ -102,15 +131,39 @@ protected slots:
     void processError(const QString &s);
     void processTimeout(const QString &s);
 
+	void openShow();
+	void saveShowAs();
+	void showLoaded(const QString & fileName, const QDomDocument & document, const QString & errors, double readTime);
+	void applyNextShowStep();
+
 public slots:
 	void exitApplication();
 
 private:
     Ui::MainWindow *ui;
+	QLabel * m_audioStatistics;
 
     QTimer m_displayTimer;
 	QString m_settingsFileName;
-
+	ShowLoadThread m_showLoader;
+	QTimer m_applyTimer;
+	QDomDocument m_pendingShow;
+	QString m_pendingShowFileName;
+	int m_applyStep;
+	double m_showReadTime;
+	double m_showApplyTime;
+	double m_longestApplyStep;
+
+	/// @brief Apply all settings in root at once.
+	void applySettings(const QDomElement & root, const QString & fileName);
+	/// @brief Apply the settings of one component in root.
+	/// @param step Index of the component, starting at 0.
+	/// @return false if there is no component with that index.
+	bool applySettingsStep(const QDomElement & root, const QString & fileName, int step);
+
+	Mixer m_mixer;
+	AutomationRecorder m_automation;
+	PresetBank m_presets;
 	DisplayImageConverter m_displayImageConverter;
     DisplayThread m_displayThread;
     AudioInterface m_audioInterface;
@@ -0,0 +1,370 @@
+#include "Mixer.h"
+
+#include "MIDIInterface.h"
+#include "ParameterSmoother.h"
+#include <QDebug>
+#include <stdexcept>
+
+
+const float Mixer::m_quadData[20] = {
+	-0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
+	-0.5f,  0.5f, 0.0f, 0.0f, 1.0f,
+	 0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+	 0.5f,  0.5f, 0.0f, 1.0f, 1.0f
+};
+
+const char * Mixer::m_prefixGLES2 = "\
+#version 100\n\
+precision highp float;\n\
+\n";
+
+const char * Mixer::m_prefixGL2 = "\
+#version 120\n\
+\n";
+
+const char * Mixer::m_vertexCode = "\
+attribute vec3 position;\n\
+attribute vec2 texcoord0;\n\
+\n\
+varying vec2 texcoordVar;\n\
+\n\
+void main() {\n\
+    gl_Position = vec4(position.xy * 2.0, 0.0, 1.0);\n\
+    texcoordVar = texcoord0;\n\
+}";
+
+
+Mixer::Layer::Layer(Deck * deck)
+	: deck(deck)
+	, opacity("opacity", 100, 0, 100)
+	, blendMode("blendMode", BlendNormal)
+	, state(Suspended)
+{
+	//the opacity is also set by the crossfader, so smooth it like the deck dials
+	smoothingHandle = ParameterSmoother::getInstance()->add(opacity.GetSharedParameter(), ParameterSmoother::OnePole, 0.05f);
+}
+
+Mixer::Layer::~Layer()
+{
+	ParameterSmoother::getInstance()->remove(smoothingHandle);
+}
+
+float Mixer::Layer::smoothedOpacity() const
+{
+	return ParameterSmoother::getInstance()->value(smoothingHandle);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+Mixer::Mixer(QObject * parent)
+	: QObject(parent)
+	, m_context(nullptr)
+	, m_surface(nullptr)
+	, m_frameBufferObject(nullptr)
+	, m_shaderProgram(nullptr)
+	, m_shaderLayerCount(0)
+{
+}
+
+Mixer::~Mixer()
+{
+	//make context current so resources can be released
+	if (m_context)
+	{
+		m_context->makeCurrent(m_surface);
+		delete m_shaderProgram;
+		delete m_frameBufferObject;
+		m_context->doneCurrent();
+	}
+	delete m_context;
+	delete m_surface;
+	for (auto layer : m_layers)
+	{
+		delete layer;
+	}
+	m_layers.clear();
+}
+
+void Mixer::toXML(QDomElement & parent) const
+{
+	//try to find element in parent
+	QDomElement element = parent.firstChildElement("Mixer");
+	if (element.isNull())
+	{
+		//add the new element
+		element = parent.ownerDocument().createElement("Mixer");
+		parent.appendChild(element);
+	}
+	for (auto layer : m_layers)
+	{
+		//find element for layer or create it
+		QDomElement layerElement;
+		QDomNodeList children = element.elementsByTagName("MixerLayer");
+		for (int i = 0; i < children.size(); ++i)
+		{
+			QDomElement child = children.at(i).toElement();
+			if (!child.isNull() && child.attribute("name") == layer->deck->objectName())
+			{
+				layerElement = child;
+				break;
+			}
+		}
+		if (layerElement.isNull())
+		{
+			layerElement = parent.ownerDocument().createElement("MixerLayer");
+			layerElement.setAttribute("name", layer->deck->objectName());
+			element.appendChild(layerElement);
+		}
+		layer->opacity.toXML(layerElement);
+		layer->blendMode.toXML(layerElement);
+	}
+}
+
+Mixer & Mixer::fromXML(const QDomElement & parent)
+{
+	//try to find element in document
+	QDomElement element = parent.firstChildElement("Mixer");
+	if (element.isNull())
+	{
+		//older settings have no mixer. keep the current layer settings
+		return *this;
+	}
+	QDomNodeList children = element.elementsByTagName("MixerLayer");
+	for (int i = 0; i < children.size(); ++i)
+	{
+		QDomElement child = children.at(i).toElement();
+		for (auto layer : m_layers)
+		{
+			if (!child.isNull() && child.attribute("name") == layer->deck->objectName())
+			{
+				layer->opacity.fromXML(child);
+				layer->blendMode.fromXML(child);
+				break;
+			}
+		}
+	}
+	return *this;
+}
+
+int Mixer::addLayer(Deck * deck)
+{
+	if (deck == nullptr)
+	{
+		throw std::runtime_error("Mixer::addLayer() - NULL deck passed!");
+	}
+	if (m_layers.size() >= MaxLayers)
+	{
+		throw std::runtime_error("Mixer::addLayer() - Maximum number of layers reached!");
+	}
+	Layer * layer = new Layer(deck);
+	m_layers.append(layer);
+	//register layer opacity in MIDI interface
+	MIDIInterface::getInstance()->getParameterMapping()->registerMIDIParameter(layer->opacity.GetSharedParameter(), deck->objectName());
+	return m_layers.size() - 1;
+}
+
+int Mixer::layerCount() const
+{
+	return m_layers.size();
+}
+
+Mixer::Layer & Mixer::layer(int index)
+{
+	return *m_layers.at(index);
+}
+
+const Mixer::Layer & Mixer::layer(int index) const
+{
+	return *m_layers.at(index);
+}
+
+float Mixer::effectiveOpacity(int index) const
+{
+	float opacity = m_layers.at(index)->smoothedOpacity();
+	//"Normal" layers above cover the layer by their opacity. other blend modes let it shine through.
+	//layers that are not composited yet don't cover anything, e.g. while pre-rolling after a hard cut
+	for (int i = index + 1; i < m_layers.size() && opacity > 0.0f; ++i)
+	{
+		const Layer * above = m_layers.at(i);
+		if (above->state == Active && above->blendMode == BlendNormal)
+		{
+			opacity *= 1.0f - above->smoothedOpacity();
+		}
+	}
+	return opacity;
+}
+
+void Mixer::updateLayerStates()
+{
+	//go from top to bottom, so the layers above already have their state for this frame when checking coverage
+	for (int i = m_layers.size() - 1; i >= 0; --i)
+	{
+		Layer * layer = m_layers[i];
+		if (effectiveOpacity(i) > 0.0f)
+		{
+			//a suspended deck has a stale image, so render it once before compositing it
+			layer->state = layer->state == Suspended ? PreRoll : Active;
+		}
+		else
+		{
+			layer->state = Suspended;
+		}
+	}
+}
+
+bool Mixer::isLayerRendered(int index) const
+{
+	return m_layers.at(index)->state != Suspended;
+}
+
+bool Mixer::initialize()
+{
+	if (!m_context)
+	{
+		//share resources with the decks so we can sample their output textures
+		QOpenGLContext * shareContext = QOpenGLContext::globalShareContext();
+		if (!shareContext)
+		{
+			qDebug() << "No global OpenGL share context. Can not mix decks!";
+			return false;
+		}
+		m_context = new QOpenGLContext();
+		m_context->setFormat(shareContext->format());
+		m_context->setShareContext(shareContext);
+		if (!m_context->create())
+		{
+			qDebug() << "Failed to create OpenGL context for mixing decks!";
+			delete m_context;
+			m_context = nullptr;
+			return false;
+		}
+		//create invisible surface to make context current
+		m_surface = new QOffscreenSurface();
+		m_surface->setFormat(m_context->format());
+		m_surface->create();
+		m_context->makeCurrent(m_surface);
+		initializeOpenGLFunctions();
+		m_context->doneCurrent();
+	}
+	return true;
+}
+
+void Mixer::createShader()
+{
+	//the shader is generated for the current number of layers, so layers are sampled without dynamic indexing
+	if (m_shaderProgram && m_shaderLayerCount == m_layers.size())
+	{
+		return;
+	}
+	delete m_shaderProgram;
+	m_shaderProgram = nullptr;
+	QString fragmentCode;
+	for (int i = 0; i < m_layers.size(); ++i)
+	{
+		fragmentCode += QString("uniform sampler2D layerTexture%1;\nuniform float layerOpacity%1;\nuniform int layerBlendMode%1;\n").arg(i);
+	}
+	fragmentCode += "\n\
+varying vec2 texcoordVar;\n\
+\n\
+vec3 blendLayer(vec3 dst, vec3 src, int mode) {\n\
+	if (mode == 1) return dst + src;\n\
+	if (mode == 2) return dst * src;\n\
+	if (mode == 3) return vec3(1.0) - (vec3(1.0) - dst) * (vec3(1.0) - src);\n\
+	if (mode == 4) return abs(dst - src);\n\
+	return src;\n\
+}\n\
+\n\
+void main() {\n\
+	vec3 color = vec3(0.0);\n";
+	for (int i = 0; i < m_layers.size(); ++i)
+	{
+		fragmentCode += QString("\tif (layerOpacity%1 > 0.0) {\n\t\tcolor = mix(color, blendLayer(color, texture2D(layerTexture%1, texcoordVar).rgb, layerBlendMode%1), layerOpacity%1);\n\t}\n").arg(i);
+	}
+	fragmentCode += "\
+	gl_FragColor = vec4(clamp(color, 0.0, 1.0), 1.0);\n\
+}";
+	//compile and link
+	const QString prefix = m_context->isOpenGLES() ? m_prefixGLES2 : m_prefixGL2;
+	m_shaderProgram = new QOpenGLShaderProgram();
+	if (!m_shaderProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, prefix + m_vertexCode)
+		|| !m_shaderProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, prefix + fragmentCode)
+		|| !m_shaderProgram->link())
+	{
+		qDebug() << "Failed to create shader for mixing decks:" << m_shaderProgram->log();
+		delete m_shaderProgram;
+		m_shaderProgram = nullptr;
+	}
+	m_shaderLayerCount = m_layers.size();
+}
+
+void Mixer::createFrameBuffer(const QSize & size)
+{
+	if (!m_frameBufferObject || m_frameBufferObject->size() != size)
+	{
+		delete m_frameBufferObject;
+		QOpenGLFramebufferObjectFormat format;
+		format.setInternalTextureFormat(Image16::frameBufferFormat());
+		m_frameBufferObject = new QOpenGLFramebufferObject(size, format);
+	}
+}
+
+Image16 Mixer::mix()
+{
+	if (m_layers.isEmpty())
+	{
+		return Image16();
+	}
+	//all decks render in the same size, so use the output of the bottom layer
+	const QSize size = m_layers.first()->deck->outputSize();
+	if (!size.isValid() || size.isEmpty() || !initialize())
+	{
+		return Image16();
+	}
+	m_context->makeCurrent(m_surface);
+	createShader();
+	createFrameBuffer(size);
+	Image16 result;
+	if (m_shaderProgram)
+	{
+		m_frameBufferObject->bind();
+		glViewport(0, 0, size.width(), size.height());
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		m_shaderProgram->bind();
+		//bind layer textures and set layer parameters. inactive layers are skipped in the shader
+		for (int i = 0; i < m_layers.size(); ++i)
+		{
+			const Layer * layer = m_layers.at(i);
+			const bool visible = layer->state == Active;
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, visible ? layer->deck->outputTexture() : 0);
+			m_shaderProgram->setUniformValue(QString("layerTexture%1").arg(i).toLatin1().constData(), i);
+			m_shaderProgram->setUniformValue(QString("layerOpacity%1").arg(i).toLatin1().constData(), visible ? layer->smoothedOpacity() : 0.0f);
+			m_shaderProgram->setUniformValue(QString("layerBlendMode%1").arg(i).toLatin1().constData(), (int)((BlendMode)layer->blendMode));
+		}
+		//enable attributes in shader
+		int position = m_shaderProgram->attributeLocation("position");
+		int texcoord0 = m_shaderProgram->attributeLocation("texcoord0");
+		glEnableVertexAttribArray(position); //position
+		glEnableVertexAttribArray(texcoord0); //texture coordinates
+		//setup vertex buffers
+		glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), &m_quadData[0]);
+		glVertexAttribPointer(texcoord0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), &m_quadData[3]);
+		//render screen-sized quad
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		//de-init everything again
+		glDisableVertexAttribArray(position);
+		glDisableVertexAttribArray(texcoord0);
+		for (int i = m_layers.size() - 1; i >= 0; --i)
+		{
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		m_shaderProgram->release();
+		//read back the final image. this is the only readback per frame
+		result = Image16::fromFrameBuffer(m_frameBufferObject);
+		m_frameBufferObject->release();
+	}
+	m_context->doneCurrent();
+	return result;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Deck.h"
+#include "Parameters.h"
+#include "ParameterBlendMode.h"
+#include "Image16.h"
+
+#include <QObject>
+#include <QImage>
+#include <QVector>
+#include <QDomDocument>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QOffscreenSurface>
+
+
+/// @brief Composites the output of an arbitrary number of decks on the GPU in one pass.
+/// Every deck is a layer with an opacity and a blend mode. Layers are blended from bottom (index 0) to top.
+/// Layers that do not contribute to the mix are suspended and their decks do not need to be rendered.
+class Mixer : public QObject, protected QOpenGLFunctions
+{
+	Q_OBJECT
+
+public:
+	/// @brief Maximum number of layers the mixer can composite in one pass.
+	static const int MaxLayers = 8;
+
+	/// @brief Render state of a layer.
+	enum LayerState {
+		Suspended, ///< Layer does not contribute to the mix. Its deck is neither rendered nor composited.
+		PreRoll, ///< Layer is about to become visible. Its deck is rendered, but not composited yet.
+		Active ///< Layer contributes to the mix. Its deck is rendered and composited.
+	};
+
+	class Layer
+	{
+	public:
+		Layer(Deck * deck);
+		~Layer();
+
+		/// @brief Retrieve the opacity smoothed by the ParameterSmoother in [0,1], so crossfader steps don't show.
+		float smoothedOpacity() const;
+
+		Deck * deck;
+		ParameterInt opacity; //[0,100]
+		ParameterBlendMode blendMode;
+		LayerState state;
+		int smoothingHandle; //handle of the opacity in the ParameterSmoother
+	};
+
+	Mixer(QObject * parent = NULL);
+	~Mixer();
+
+	/// @brief Save the current settings to an XML document.
+	/// @param parent The paren element to write the settings to.
+	void toXML(QDomElement & parent) const;
+	/// @brief Read current settings from XML document.
+	/// @param parent The parent element to load the settings from.
+	Mixer & fromXML(const QDomElement & parent);
+
+	/// @brief Add a deck as the new top layer.
+	/// @param deck Deck to add. The deck name is used to identify the layer in settings and MIDI mappings.
+	/// @return Index of the new layer.
+	int addLayer(Deck * deck);
+
+	int layerCount() const;
+	Layer & layer(int index);
+	const Layer & layer(int index) const;
+
+	/// @brief Calculate how much a layer contributes to the final mix.
+	/// This is the smoothed layer opacity attenuated by all active "Normal" layers above it. Pre-rolling layers don't cover it yet.
+	/// @param index Layer index.
+	/// @return Effective opacity of the layer in [0,1].
+	float effectiveOpacity(int index) const;
+
+	/// @brief Update the render states of all layers from their effective opacity. Call once per frame before rendering.
+	/// A layer that becomes visible is pre-rolled for one frame, so its deck has a fresh image when it is composited.
+	/// Layers below it stay composited until it is active, so a hard cut never shows an empty frame.
+	void updateLayerStates();
+
+	/// @brief Check if the deck of a layer needs to be rendered this frame.
+	/// @param index Layer index.
+	/// @return True if the layer is pre-rolling or active.
+	bool isLayerRendered(int index) const;
+
+	/// @brief Composite the output textures of all active layers and read back the result.
+	/// The mix is rendered and read back with 16 bits per channel where the OpenGL implementation supports it.
+	/// @return Mixed image in the output size of the bottom layer or a null image if nothing has been rendered yet.
+	Image16 mix();
+
+private:
+	bool initialize();
+	void createShader();
+	void createFrameBuffer(const QSize & size);
+
+	static const float m_quadData[20];
+	static const char * m_prefixGLES2;
+	static const char * m_prefixGL2;
+	static const char * m_vertexCode;
+
+	QVector<Layer *> m_layers;
+
+	QOpenGLContext * m_context;
+	QOffscreenSurface * m_surface;
+	QOpenGLFramebufferObject * m_frameBufferObject;
+	QOpenGLShaderProgram * m_shaderProgram;
+	int m_shaderLayerCount;
+};
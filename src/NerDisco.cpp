@@ -4,6 +4,8 @@
 
 int main(int argc, char *argv[])
 {
+    //make all OpenGL contexts in the application share resources. this must be set before creating the application
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
     QApplication app(argc, argv);
     app.setApplicationName("NerDisco");
     app.setOrganizationName("HorstBaerbel Inc.");
@@ -0,0 +1,174 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QFile>
+#include <QSize>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "OfflineRenderer.h"
+#include "ScriptList.h"
+
+//retrieve the mean of a list of times
+static double mean(const QVector<float> & times)
+{
+	return times.isEmpty() ? 0.0 : std::accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+}
+
+//retrieve the 99th percentile of a list of times, using the nearest-rank method
+static double percentile99(QVector<float> times)
+{
+	if (times.isEmpty())
+	{
+		return 0.0;
+	}
+	std::sort(times.begin(), times.end());
+	const int rank = (int)std::ceil(0.99 * times.size());
+	return times.at(std::max(rank, 1) - 1);
+}
+
+//renders every effect script at several resolutions and writes the timings to a JSON file.
+//run with "-platform offscreen" on machines without a display, e.g. with Mesa llvmpipe in CI
+int main(int argc, char *argv[])
+{
+	QGuiApplication app(argc, argv);
+	app.setApplicationName("NerDiscoBenchmark");
+	app.setOrganizationName("HorstBaerbel Inc.");
+	//parse command line
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Renders all NerDisco effect scripts at several resolutions and writes compile, frame and readback times to a JSON file.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("output", "JSON file to write the results to or \"-\" to write them to stdout.");
+	QCommandLineOption effectsOption(QStringList() << "e" << "effects", "Benchmark the scripts in <directory>. Default is \"./effects\".", "directory", "./effects");
+	QCommandLineOption framesOption(QStringList() << "n" << "frames", "Render <count> frames per effect and resolution. Default is 300.", "count", "300");
+	QCommandLineOption warmupOption("warmup", "Render <count> frames before measuring. Default is 10.", "count", "10");
+	QCommandLineOption sizesOption("sizes", "Comma-separated list of resolutions. Default is \"32x18,320x180,1280x720\".", "sizes", "32x18,320x180,1280x720");
+	QCommandLineOption superSamplingOption("supersampling", "Supersampling factor in [1,8]. Default is 1.", "factor", "1");
+	parser.addOption(effectsOption);
+	parser.addOption(framesOption);
+	parser.addOption(warmupOption);
+	parser.addOption(sizesOption);
+	parser.addOption(superSamplingOption);
+	parser.process(app);
+	const QStringList arguments = parser.positionalArguments();
+	if (arguments.size() != 1)
+	{
+		parser.showHelp(1);
+	}
+	const int frameCount = std::max(parser.value(framesOption).toInt(), 1);
+	const int warmupCount = std::max(parser.value(warmupOption).toInt(), 0);
+	//parse resolutions
+	QVector<QSize> sizes;
+	foreach (const QString & entry, parser.value(sizesOption).split(',', QString::SkipEmptyParts))
+	{
+		const QStringList size = entry.split('x');
+		if (size.size() != 2 || size.at(0).toInt() <= 0 || size.at(1).toInt() <= 0)
+		{
+			fprintf(stderr, "Error: Invalid resolution \"%s\"!\n", entry.toLocal8Bit().constData());
+			return 1;
+		}
+		sizes.append(QSize(size.at(0).toInt(), size.at(1).toInt()));
+	}
+	QStringList scripts = buildScriptList(parser.value(effectsOption));
+	scripts.sort();
+	if (scripts.isEmpty())
+	{
+		fprintf(stderr, "Error: No scripts found in \"%s\"!\n", parser.value(effectsOption).toLocal8Bit().constData());
+		return 1;
+	}
+	QJsonObject result;
+	QJsonArray effects;
+	try
+	{
+		OfflineRenderer renderer;
+		renderer.superSampling = parser.value(superSamplingOption).toInt();
+		//reject sizes the renderer can not produce up front, so no effect is measured at a different size
+		const int maximumSize = renderer.maximumRenderSize();
+		foreach (const QSize & size, sizes)
+		{
+			if (size.width() > maximumSize || size.height() > maximumSize)
+			{
+				fprintf(stderr, "Error: Resolution %dx%d exceeds the maximum of %d pixels per side with %dx supersampling!\n",
+					size.width(), size.height(), maximumSize, (int)renderer.superSampling);
+				return 1;
+			}
+		}
+		result["renderer"] = renderer.rendererName();
+		result["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+		result["frames"] = frameCount;
+		result["superSampling"] = (int)renderer.superSampling;
+		foreach (const QString & script, scripts)
+		{
+			QJsonObject effect;
+			effect["name"] = script;
+			fprintf(stderr, "%s\n", script.toLocal8Bit().constData());
+			try
+			{
+				//compile once and render at all resolutions
+				renderer.loadScript(script);
+				effect["compileMs"] = renderer.compileTime();
+				QJsonArray resolutions;
+				foreach (const QSize & size, sizes)
+				{
+					renderer.setRenderSize(size.width(), size.height());
+					if (warmupCount > 0)
+					{
+						renderer.render(warmupCount, "");
+					}
+					renderer.render(frameCount, "");
+					//record the size that was actually rendered, not the one asked for
+					const QSize renderSize = renderer.renderSize();
+					QJsonObject resolution;
+					resolution["width"] = renderSize.width();
+					resolution["height"] = renderSize.height();
+					resolution["meanFrameMs"] = mean(renderer.renderTimes());
+					resolution["p99FrameMs"] = percentile99(renderer.renderTimes());
+					resolution["meanReadbackMs"] = mean(renderer.readbackTimes());
+					resolution["p99ReadbackMs"] = percentile99(renderer.readbackTimes());
+					resolutions.append(resolution);
+					fprintf(stderr, "  %dx%d: frame %.3fms (p99 %.3fms), readback %.3fms\n", renderSize.width(), renderSize.height(),
+						resolution["meanFrameMs"].toDouble(), resolution["p99FrameMs"].toDouble(), resolution["meanReadbackMs"].toDouble());
+				}
+				effect["resolutions"] = resolutions;
+			}
+			catch (std::runtime_error & e)
+			{
+				//a broken script is reported, but does not stop the benchmark
+				effect["error"] = QString(e.what());
+				fprintf(stderr, "  Error: %s\n", e.what());
+			}
+			effects.append(effect);
+		}
+	}
+	catch (std::runtime_error & e)
+	{
+		fprintf(stderr, "Error: %s\n", e.what());
+		return 1;
+	}
+	result["effects"] = effects;
+	//write results
+	QFile output;
+	bool opened = false;
+	if (arguments.at(0) == "-")
+	{
+		opened = output.open(stdout, QIODevice::WriteOnly);
+	}
+	else
+	{
+		output.setFileName(arguments.at(0));
+		opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+	}
+	const QByteArray json = QJsonDocument(result).toJson();
+	if (!opened || output.write(json) != json.size())
+	{
+		fprintf(stderr, "Error: Failed to write \"%s\"!\n", arguments.at(0).toLocal8Bit().constData());
+		return 1;
+	}
+	return 0;
+}
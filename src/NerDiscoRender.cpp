@@ -0,0 +1,99 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <cstdio>
+#include <cmath>
+#include <stdexcept>
+
+#include "OfflineRenderer.h"
+
+//renders an effect to LED frames without a window. run with "-platform offscreen" on machines without a display
+int main(int argc, char *argv[])
+{
+	QGuiApplication app(argc, argv);
+	app.setApplicationName("NerDiscoRender");
+	app.setOrganizationName("HorstBaerbel Inc.");
+	//parse command line
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Renders a NerDisco effect script to LED frames with a fixed time step, faster than real-time.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("effect", "Effect script (.fs) to render.");
+	parser.addPositionalArgument("output", "\"-\" to write raw RGB frames to stdout, a pattern like \"frame%05d.png\" to write images or a file name to write raw RGB frames to.");
+	QCommandLineOption settingsOption(QStringList() << "s" << "settings", "Read display settings and automation from <file>.", "file");
+	QCommandLineOption deckOption(QStringList() << "d" << "deck", "Play back the automation of deck <name>. Default is DeckA.", "name", "DeckA");
+	QCommandLineOption audioOption(QStringList() << "a" << "audio", "Analyze the WAVE <file> for audio-reactive effects and render for its length.", "file");
+	QCommandLineOption fpsOption(QStringList() << "f" << "fps", "Render <fps> frames per second. Default is 50.", "fps", "50");
+	QCommandLineOption framesOption(QStringList() << "n" << "frames", "Render <count> frames.", "count");
+	QCommandLineOption durationOption(QStringList() << "t" << "duration", "Render <seconds> seconds.", "seconds");
+	QCommandLineOption sizeOption("size", "Render frames of <width>x<height> pixels, overriding the display size of the settings. Not limited to the size of an LED display.", "size");
+	QCommandLineOption superSamplingOption("supersampling", "Supersampling factor in [1,8]. Default is 4.", "factor", "4");
+	QCommandLineOption bpmOption("bpm", "Tempo for the beatPhase, bar and bpm uniforms. Default is 120.", "bpm", "120");
+	parser.addOption(settingsOption);
+	parser.addOption(deckOption);
+	parser.addOption(audioOption);
+	parser.addOption(fpsOption);
+	parser.addOption(framesOption);
+	parser.addOption(durationOption);
+	parser.addOption(sizeOption);
+	parser.addOption(superSamplingOption);
+	parser.addOption(bpmOption);
+	parser.process(app);
+	const QStringList arguments = parser.positionalArguments();
+	if (arguments.size() != 2)
+	{
+		parser.showHelp(1);
+	}
+	try
+	{
+		OfflineRenderer renderer;
+		renderer.frameRate = parser.value(fpsOption).toInt();
+		renderer.superSampling = parser.value(superSamplingOption).toInt();
+		renderer.bpm = parser.value(bpmOption).toFloat();
+		if (parser.isSet(settingsOption))
+		{
+			renderer.loadSettings(parser.value(settingsOption), parser.value(deckOption));
+		}
+		if (parser.isSet(sizeOption))
+		{
+			const QStringList size = parser.value(sizeOption).split('x');
+			if (size.size() != 2)
+			{
+				throw std::runtime_error("Invalid size!");
+			}
+			renderer.setRenderSize(size.at(0).toInt(), size.at(1).toInt());
+		}
+		if (parser.isSet(audioOption))
+		{
+			renderer.loadAudio(parser.value(audioOption));
+		}
+		renderer.loadScript(arguments.at(0));
+		//use the first length given: number of frames, duration, audio, automation. default to 10s
+		double duration = 10.0;
+		if (parser.isSet(durationOption))
+		{
+			duration = parser.value(durationOption).toDouble();
+		}
+		else if (renderer.audioLength() > 0.0)
+		{
+			duration = renderer.audioLength();
+		}
+		else if (renderer.automationLength() > 0.0)
+		{
+			duration = renderer.automationLength();
+		}
+		const int frameCount = parser.isSet(framesOption) ? parser.value(framesOption).toInt() : (int)std::ceil(duration * renderer.frameRate);
+		//render and report how long it took
+		QElapsedTimer timer;
+		timer.start();
+		renderer.render(frameCount, arguments.at(1));
+		const double seconds = timer.nsecsElapsed() / 1.0e9;
+		fprintf(stderr, "Rendered %d frames in %.2fs (%.1f fps, %.1fx real-time). Render %.3fms, readback %.3fms per frame.\n",
+			frameCount, seconds, frameCount / seconds, (frameCount / (double)renderer.frameRate) / seconds, renderer.averageRenderTime(), renderer.averageReadbackTime());
+	}
+	catch (std::runtime_error & e)
+	{
+		fprintf(stderr, "Error: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
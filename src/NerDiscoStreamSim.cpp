@@ -0,0 +1,245 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+	#include <QElapsedTimer>
+	#include <QThread>
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <termios.h>
+	#include <unistd.h>
+#endif
+
+#include "LEDStream.h"
+
+//result of streaming all frames with one protocol
+struct StreamResult
+{
+	qint64 bytes = 0;
+	int maximumBytes = 0;
+	int frames = 0;
+	int decodeErrors = 0; //frames the device rejected or decoded differently than the host expected
+	int maximumError = 0; //largest difference between a sent and a displayed color channel
+	double errorSum = 0.0;
+};
+
+//encode every frame, decode it like the firmware does and compare the result
+static StreamResult simulate(const QByteArray & frames, int frameSize, int mode, int keyFrameInterval)
+{
+	StreamResult result;
+	LEDStreamEncoder encoder;
+	encoder.setKeyFrameInterval(keyFrameInterval);
+	LEDStreamDecoder decoder(frameSize / 3);
+	for (int offset = 0; offset + frameSize <= frames.size(); offset += frameSize)
+	{
+		const QByteArray colors = frames.mid(offset, frameSize);
+		const QByteArray data = mode == 0 ? LEDStreamEncoder::encodeAdalight(colors) : encoder.encode(colors, mode == 2);
+		result.bytes += data.size();
+		result.maximumBytes = std::max(result.maximumBytes, data.size());
+		result.frames++;
+		//the device must show exactly what the host expects. with full color that's the frame itself
+		const QByteArray & expected = mode == 0 ? colors : encoder.deviceColors();
+		if (!decoder.decode(data) || decoder.colors() != expected)
+		{
+			result.decodeErrors++;
+		}
+		for (int i = 0; i < frameSize; ++i)
+		{
+			const int error = std::abs((int)(uint8_t)colors.at(i) - (int)(uint8_t)decoder.colors().at(i));
+			result.maximumError = std::max(result.maximumError, error);
+			result.errorSum += error;
+		}
+	}
+	return result;
+}
+
+#ifdef Q_OS_UNIX
+//act like an LEDStream device on a pseudo-terminal, so NerDisco can be tested without hardware.
+//the device receives at the baud rate, takes showTime ms to show a frame and acknowledges it
+static int emulateDevice(int ledCount, int baudrate, int showTime)
+{
+	const int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		fprintf(stderr, "Error: Failed to create pseudo-terminal!\n");
+		return 1;
+	}
+	//pass data through unchanged
+	struct termios settings;
+	tcgetattr(master, &settings);
+	cfmakeraw(&settings);
+	tcsetattr(master, TCSANOW, &settings);
+	printf("Emulating a device with %d LEDs at %d baud on %s\n", ledCount, baudrate, ptsname(master));
+	fflush(stdout);
+	LEDStreamDecoder decoder(ledCount);
+	QByteArray input;
+	bool connected = false;
+	int frames = 0;
+	qint64 bytes = 0;
+	int errors = 0;
+	QElapsedTimer reportTimer;
+	reportTimer.start();
+	while (true)
+	{
+		struct pollfd descriptor = {master, POLLIN, 0};
+		poll(&descriptor, 1, 100);
+		//the master hangs up while no program has the terminal open
+		if (descriptor.revents & POLLHUP)
+		{
+			if (connected)
+			{
+				printf("Disconnected\n");
+				fflush(stdout);
+			}
+			connected = false;
+			input.clear();
+			QThread::msleep(100);
+			continue;
+		}
+		if (!connected)
+		{
+			//announce the device like the firmware does after a reset
+			connected = true;
+			decoder = LEDStreamDecoder(ledCount);
+			const char announcement[] = "Ada\nAdx7\n";
+			write(master, announcement, sizeof(announcement) - 1);
+			printf("Connected\n");
+			fflush(stdout);
+		}
+		if (descriptor.revents & POLLIN)
+		{
+			char buffer[4096];
+			const ssize_t received = read(master, buffer, sizeof(buffer));
+			if (received > 0)
+			{
+				input.append(buffer, (int)received);
+			}
+		}
+		//decode all complete frames
+		while (true)
+		{
+			//skip to the next frame header
+			const int start = input.indexOf("Ad");
+			input.remove(0, start < 0 ? std::max(input.size() - 1, 0) : start);
+			const int length = LEDStreamDecoder::frameLength(input);
+			if (length == 0)
+			{
+				break;
+			}
+			if (length < 0)
+			{
+				input.remove(0, 1);
+				errors++;
+				continue;
+			}
+			const QByteArray frame = input.left(length);
+			input.remove(0, length);
+			//receiving the frame takes 10 bits per byte with 8N1, then the LEDs are updated
+			QThread::usleep((unsigned long)((qint64)length * 10 * 1000000 / baudrate) + showTime * 1000);
+			if (!decoder.decode(frame))
+			{
+				errors++;
+				if (frame.startsWith("Adx"))
+				{
+					write(master, "Adk\n", 4);
+				}
+			}
+			write(master, "Adr\n", 4);
+			frames++;
+			bytes += length;
+		}
+		if (reportTimer.elapsed() >= 1000)
+		{
+			if (connected && frames > 0)
+			{
+				printf("%d frames/s, %lld bytes/s, %d errors\n", frames, (long long)(bytes * 1000 / reportTimer.elapsed()), errors);
+				fflush(stdout);
+			}
+			frames = 0;
+			bytes = 0;
+			errors = 0;
+			reportTimer.restart();
+		}
+	}
+	return 0;
+}
+#endif
+
+//simulates sending LED frames to the LEDStream firmware with all protocols, verifies they decode correctly and reports the frame rate possible
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	app.setApplicationName("NerDiscoStreamSim");
+	app.setOrganizationName("HorstBaerbel Inc.");
+	//parse command line
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Streams raw RGB LED frames, e.g. written by NerDiscoRender, through the LEDStream protocols and the simulated firmware decoder. Verifies the frames decode correctly and reports the frame rate achievable at a baud rate.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("frames", "File with raw RGB frames. Not needed with --pty.");
+	QCommandLineOption ledsOption(QStringList() << "l" << "leds", "Number of LEDs per frame. Default is 576 (32x18).", "count", "576");
+	QCommandLineOption baudOption(QStringList() << "b" << "baud", "Serial port baud rate. Default is 500000.", "rate", "500000");
+	QCommandLineOption keyFrameOption("keyframe-interval", "Send a key frame every <frames> frames. Default is 50.", "frames", "50");
+	parser.addOption(ledsOption);
+	parser.addOption(baudOption);
+	parser.addOption(keyFrameOption);
+#ifdef Q_OS_UNIX
+	QCommandLineOption ptyOption("pty", "Emulate an LEDStream device on a pseudo-terminal instead of simulating a file. Open the device printed in NerDisco.");
+	QCommandLineOption showTimeOption("show-time", "Time in ms the emulated device takes to show a frame. Default is 30us per LED.", "ms");
+	parser.addOption(ptyOption);
+	parser.addOption(showTimeOption);
+#endif
+	parser.process(app);
+	const QStringList arguments = parser.positionalArguments();
+	const int ledCount = parser.value(ledsOption).toInt();
+	const int baudrate = parser.value(baudOption).toInt();
+	if (ledCount <= 0 || ledCount > 65535 || baudrate <= 0)
+	{
+		fprintf(stderr, "Error: Invalid LED count or baud rate!\n");
+		return 1;
+	}
+#ifdef Q_OS_UNIX
+	if (parser.isSet(ptyOption))
+	{
+		//WS2812B LEDs take 30us each to update
+		const int showTime = parser.isSet(showTimeOption) ? parser.value(showTimeOption).toInt() : (ledCount * 30 + 999) / 1000;
+		return emulateDevice(ledCount, baudrate, std::max(showTime, 0));
+	}
+#endif
+	if (arguments.size() != 1)
+	{
+		parser.showHelp(1);
+	}
+	QFile file(arguments.at(0));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		fprintf(stderr, "Error: Failed to open \"%s\"!\n", arguments.at(0).toLocal8Bit().constData());
+		return 1;
+	}
+	//the RGB order of the file is used as stream order. reduced color expects G, R, B, so its error is slightly off
+	const QByteArray frames = file.readAll();
+	const int frameSize = ledCount * 3;
+	if (frames.size() < frameSize)
+	{
+		fprintf(stderr, "Error: File contains no complete frame!\n");
+		return 1;
+	}
+	//a byte takes 10 bits on the wire with 8N1
+	const double bytesPerSecond = baudrate / 10.0;
+	const char * names[3] = {"Adalight", "Changes", "Changes, reduced color"};
+	int errors = 0;
+	printf("%d frames, %d LEDs, %d baud\n", frames.size() / frameSize, ledCount, baudrate);
+	for (int mode = 0; mode < 3; ++mode)
+	{
+		const StreamResult result = simulate(frames, frameSize, mode, parser.value(keyFrameOption).toInt());
+		const double averageBytes = (double)result.bytes / result.frames;
+		printf("%-24s %8.1f bytes/frame (max %d), %6.1f fps (worst %6.1f), error avg %.2f max %d, %d decode errors\n",
+			names[mode], averageBytes, result.maximumBytes, bytesPerSecond / averageBytes, bytesPerSecond / result.maximumBytes,
+			result.errorSum / ((double)result.frames * frameSize), result.maximumError, result.decodeErrors);
+		errors += result.decodeErrors;
+	}
+	return errors > 0 ? 2 : 0;
+}
@@ -1,5 +1,8 @@
 #include "NodeBase.h"
 
+#include "ParameterStore.h"
+#include "ParameterGraph.h"
+
 
 NodeBase::NodeBase(const QString & name, QObject * parent)
 	: QObject(parent)
@@ -7,6 +10,12 @@ NodeBase::NodeBase(const QString & name, QObject * parent)
 {
 }
 
+NodeBase::~NodeBase()
+{
+	ParameterGraph::getInstance()->remove(this);
+	ParameterStore::getInstance()->remove(this);
+}
+
 QString NodeBase::name() const
 {
 	return m_name;
@@ -17,6 +26,16 @@ void NodeBase::setName(const QString & name)
 	m_name = name;
 }
 
+void NodeBase::publishValue(const QVariant & value)
+{
+	ParameterStore::getInstance()->publish(this, value);
+}
+
+void NodeBase::propagateValue()
+{
+	ParameterGraph::getInstance()->markDirty(this);
+}
+
 QDomElement NodeBase::findChildElement(QDomElement & parent) const
 {
 	if (parent.isNull())
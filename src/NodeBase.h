@@ -5,6 +5,7 @@
 #include <QObject>
 #include <QString>
 #include <QDomElement>
+#include <QVariant>
 
 
 class NodeBase : public QObject
@@ -15,6 +16,7 @@ public:
 	typedef std::shared_ptr<NodeBase> SPtr;
 
 	NodeBase(const QString & name, QObject * parent = NULL);
+	virtual ~NodeBase();
 
 	virtual void toXML(QDomElement & element) const = 0;
 	virtual void fromXML(QDomElement & element) = 0;
@@ -29,7 +31,15 @@ signals:
 	void changed(NodeBase * node);
 
 protected:
+	friend class ParameterGraph;
+
 	QDomElement findChildElement(QDomElement & parent) const;
+	/// @brief Publish the current value to the parameter store, so other threads can read it without locking.
+	void publishValue(const QVariant & value);
+	/// @brief Mark the value as changed in the parameter graph, so it is propagated to linked nodes on the next frame.
+	void propagateValue();
+	/// @brief Copy the value of a linked node of the same type. Called by the parameter graph when propagating changes.
+	virtual void assignFrom(const NodeBase & other) = 0;
 
 	QString m_name;
 };
@@ -1,10 +1,13 @@
 #include "NodeEnum.h"
 
+#include "ParameterGraph.h"
+
 
 NodeEnum::NodeEnum(const QString & name, int64_t value, QObject * parent)
 	: NodeBase(name, parent)
 	, m_value(value)
 {
+	publishValue((qlonglong)m_value);
 }
 
 void NodeEnum::toXML(QDomElement & parent) const
@@ -45,8 +48,12 @@ void NodeEnum::connect(NodeBase::SPtr other)
 	{
 		throw std::runtime_error("NodeEnum::connect() - Only nodes of type NodeEnum can be connected!");
 	}
-	QObject::connect(this, SIGNAL(valueChanged(int64_t)), other.get(), SLOT(setValue(int64_t)));
-	QObject::connect(other.get(), SIGNAL(valueChanged(int64_t)), this, SLOT(setValue(int64_t)));
+	ParameterGraph::getInstance()->link(this, other.get());
+}
+
+void NodeEnum::assignFrom(const NodeBase & other)
+{
+	setValue(static_cast<const NodeEnum &>(other).m_value);
 }
 
 void NodeEnum::addValue(int64_t value, const QString & name)
@@ -102,6 +109,8 @@ void NodeEnum::setValue(int64_t value)
 		emitValueChanged();
 		emit valueChanged(m_value);
 		emit valueChanged(m_entries[m_value]);
+		publishValue((qlonglong)m_value);
+		propagateValue();
 		emit changed(this);
 	}
 }
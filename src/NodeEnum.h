@@ -39,6 +39,7 @@ signals:
 protected:
 	NodeEnum(const QString & name, int64_t value, QObject * parent = NULL);
 	virtual void emitValueChanged() = 0;
+	virtual void assignFrom(const NodeBase & other);
 
 	int64_t m_value;
 	QMap<int64_t, QString> m_entries;
@@ -1,10 +1,13 @@
 #include "NodeQString.h"
 
+#include "ParameterGraph.h"
+
 
 NodeQString::NodeQString(const QString & name, QString value, QObject * parent)
 	: NodeBase(name, parent)
 	, m_value(value)
 {
+	publishValue(m_value);
 }
 
 QString NodeQString::staticTypeName()
@@ -55,8 +58,12 @@ void NodeQString::connect(NodeBase::SPtr other)
 	{
 		throw std::runtime_error("NodeQString::connect() - Only nodes of type NodeQString can be connected!");
 	}
-	QObject::connect(this, SIGNAL(valueChanged(QString)), other.get(), SLOT(setValue(QString)));
-	QObject::connect(other.get(), SIGNAL(valueChanged(QString)), this, SLOT(setValue(QString)));
+	ParameterGraph::getInstance()->link(this, other.get());
+}
+
+void NodeQString::assignFrom(const NodeBase & other)
+{
+	setValue(static_cast<const NodeQString &>(other).m_value);
 }
 
 NodeQString & NodeQString::operator=(const QString & value)
@@ -81,6 +88,8 @@ void NodeQString::setValue(const QString & value)
 	{
 		m_value = value;
 		emit valueChanged(m_value);
+		publishValue(m_value);
+		propagateValue();
 		emit changed(this);
 	}
 }
@@ -35,5 +35,7 @@ signals:
 	void valueChanged(const QString & value);
 
 protected:
+	virtual void assignFrom(const NodeBase & other);
+
 	QString m_value;
 };
@@ -1,6 +1,15 @@
 #include "NodeRanged.h"
 
+#include "ParameterGraph.h"
+#include "ParameterStore.h"
+
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+
+
+//serial number of the latest range change of any node
+static std::atomic<quint64> s_rangeSerial(0);
 
 
 NodeRanged::NodeRanged(const QString & name, bool value, QObject * parent)
@@ -8,7 +17,10 @@ NodeRanged::NodeRanged(const QString & name, bool value, QObject * parent)
 	, m_value(value)
 	, m_minRange(0.0)
 	, m_maxRange(1.0)
+	, m_valueType(Bool)
+	, m_rangeSerial(0)
 {
+	publishValue(m_value);
 }
 
 NodeRanged::NodeRanged(const QString & name, int value, int minRange, int maxRange, QObject * parent)
@@ -16,7 +28,10 @@ NodeRanged::NodeRanged(const QString & name, int value, int minRange, int maxRan
 	, m_value(value)
 	, m_minRange(minRange)
 	, m_maxRange(maxRange)
+	, m_valueType(Int)
+	, m_rangeSerial(0)
 {
+	publishValue(m_value);
 }
 
 NodeRanged::NodeRanged(const QString & name, float value, float minRange, float maxRange, QObject * parent)
@@ -24,7 +39,10 @@ NodeRanged::NodeRanged(const QString & name, float value, float minRange, float
 	, m_value(value)
 	, m_minRange(minRange)
 	, m_maxRange(maxRange)
+	, m_valueType(Real)
+	, m_rangeSerial(0)
 {
+	publishValue(m_value);
 }
 
 NodeRanged::NodeRanged(const QString & name, double value, double minRange, double maxRange, QObject * parent)
@@ -32,7 +50,10 @@ NodeRanged::NodeRanged(const QString & name, double value, double minRange, doub
 	, m_value(value)
 	, m_minRange(minRange)
 	, m_maxRange(maxRange)
+	, m_valueType(Real)
+	, m_rangeSerial(0)
 {
+	publishValue(m_value);
 }
 
 QString NodeRanged::staticTypeName()
@@ -87,10 +108,19 @@ void NodeRanged::connect(NodeBase::SPtr other)
 	{
 		throw std::runtime_error("NodeRanged::connect() - Only nodes of type NodeRanged can be connected!");
 	}
-	QObject::connect(this, SIGNAL(valueChanged(double)), other.get(), SLOT(setValue(double)));
-	QObject::connect(other.get(), SIGNAL(valueChanged(double)), this, SLOT(setValue(double)));
-	QObject::connect(this, SIGNAL(rangeChanged(double, double)), other.get(), SLOT(setRange(double, double)));
-	QObject::connect(other.get(), SIGNAL(rangeChanged(double, double)), this, SLOT(setRange(double, double)));
+	ParameterGraph::getInstance()->link(this, other.get());
+}
+
+void NodeRanged::assignFrom(const NodeBase & other)
+{
+	const NodeRanged & otherNode = static_cast<const NodeRanged &>(other);
+	//only take over the range if it was changed after ours, so linked nodes keep their own ranges until one changes
+	if (otherNode.m_rangeSerial > m_rangeSerial)
+	{
+		setRange(otherNode.m_minRange, otherNode.m_maxRange);
+		m_rangeSerial = otherNode.m_rangeSerial;
+	}
+	setValue(otherNode.m_value);
 }
 
 void NodeRanged::connectNormalized(NodeRanged::SPtr other)
@@ -158,6 +188,11 @@ double NodeRanged::normalizedValue() const
 	return (m_value - m_minRange) / (m_maxRange - m_minRange);
 }
 
+NodeRanged::ValueType NodeRanged::valueType() const
+{
+	return m_valueType;
+}
+
 double NodeRanged::minRange() const
 {
 	return m_minRange;
@@ -199,12 +234,55 @@ void NodeRanged::setValue(double value)
 	if (m_value != value)
 	{
 		m_value = value;
-		emit valueChanged((bool)m_value);
-		emit valueChanged((int)m_value);
-		emit valueChanged((float)m_value);
-		emit valueChanged(m_value);
-		emit normalizedValueChanged(normalizedValue());
-		emit changed(this);
+		publishValue(m_value);
+		notifyValueChanged();
+	}
+}
+
+void NodeRanged::notifyValueChanged()
+{
+	emit valueChanged((bool)m_value);
+	emit valueChanged((int)m_value);
+	emit valueChanged((float)m_value);
+	emit valueChanged(m_value);
+	emit normalizedValueChanged(normalizedValue());
+	propagateValue();
+	emit changed(this);
+}
+
+void NodeRanged::setNormalizedValues(const QVector<NodeRanged::SPtr> & nodes, const QVector<float> & values)
+{
+	//assign all values, then publish them in one go
+	QVector<NodeRanged *> changedNodes;
+	QVector<QPair<const NodeBase *, QVariant>> published;
+	const int count = std::min(nodes.size(), values.size());
+	for (int i = 0; i < count; ++i)
+	{
+		NodeRanged * node = nodes.at(i).get();
+		if (std::isnan(values.at(i)))
+		{
+			continue;
+		}
+		double value = std::max(node->m_minRange, std::min(node->m_maxRange, values.at(i) * (node->m_maxRange - node->m_minRange) + node->m_minRange));
+		//integer and bool nodes only take whole values
+		if (node->m_valueType != Real)
+		{
+			value = std::round(value);
+		}
+		if (node->m_value != value)
+		{
+			node->m_value = value;
+			changedNodes.append(node);
+			published.append(qMakePair((const NodeBase *)node, QVariant(value)));
+		}
+	}
+	if (!published.isEmpty())
+	{
+		ParameterStore::getInstance()->publish(published);
+	}
+	for (auto node : changedNodes)
+	{
+		node->notifyValueChanged();
 	}
 }
 
@@ -234,10 +312,12 @@ void NodeRanged::setRange(double minRange, double maxRange)
 	{
 		m_minRange = minRange;
 		m_maxRange = maxRange;
+		m_rangeSerial = ++s_rangeSerial;
 		emit rangeChanged((int)m_minRange, (int)m_maxRange);
 		emit rangeChanged((float)m_minRange, (float)m_maxRange);
 		emit rangeChanged(m_minRange, m_maxRange);
 		emit normalizedValueChanged(normalizedValue());
+		propagateValue();
 		emit changed(this);
 	}
 }
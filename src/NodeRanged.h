@@ -2,6 +2,8 @@
 
 #include "NodeBase.h"
 
+#include <QVector>
+
 
 class NodeRanged : public NodeBase
 {
@@ -10,6 +12,9 @@ class NodeRanged : public NodeBase
 public:
 	typedef std::shared_ptr<NodeRanged> SPtr;
 
+	/// @brief Type of the value the node was created with.
+	enum ValueType {Bool, Int, Real};
+
 	NodeRanged(const QString & name, bool value, QObject * parent = NULL);
 	NodeRanged(const QString & name, int value, int minRange, int maxRange, QObject * parent = NULL);
 	NodeRanged(const QString & name, float value, float minRange, float maxRange, QObject * parent = NULL);
@@ -37,8 +42,17 @@ public:
 	friend bool operator==(const NodeRanged & a, const NodeRanged & b);
 	friend bool operator!=(const NodeRanged & a, const NodeRanged & b);
 
+	/// @brief Set the normalized values of many nodes at once, e.g. to recall a preset.
+	/// All values are assigned first and published to the parameter store as a single snapshot,
+	/// then the change signals are emitted, so no receiver sees a half-applied set of values.
+	/// @param nodes Nodes to change.
+	/// @param values Normalized values for the nodes. NaN leaves a node unchanged. Integer and bool nodes are rounded to whole values.
+	static void setNormalizedValues(const QVector<NodeRanged::SPtr> & nodes, const QVector<float> & values);
+
 	double value() const;
 	double normalizedValue() const;
+	/// @brief Retrieve the type of the value the node was created with, e.g. to tell switches from continuous values.
+	ValueType valueType() const;
 	double minRange() const;
 	double maxRange() const;
 
@@ -66,7 +80,13 @@ signals:
 	void rangeChanged(double minRange, double maxRange);
 
 protected:
+	virtual void assignFrom(const NodeBase & other);
+	/// @brief Emit the value change signals and mark the value as changed in the parameter graph.
+	void notifyValueChanged();
+
 	double m_value;
 	double m_minRange;
 	double m_maxRange;
+	ValueType m_valueType;
+	quint64 m_rangeSerial; //serial number of the last range change. linked nodes only take over newer ranges
 };
@@ -0,0 +1,513 @@
+#include "OfflineRenderer.h"
+
+#include "LiveView.h"
+#include "Image16.h"
+#include "ShowFile.h"
+#include "ParameterSmoother.h"
+#include "AudioFeatures.h"
+#include "WavReader.h"
+
+#include <QDomDocument>
+#include <QMatrix4x4>
+#include <QVector2D>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <cstdio>
+#include <stdexcept>
+
+
+const float OfflineRenderer::m_quadData[20] = {
+	-0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
+	-0.5f,  0.5f, 0.0f, 0.0f, 1.0f,
+	 0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+	 0.5f,  0.5f, 0.0f, 1.0f, 1.0f
+};
+
+OfflineRenderer::OfflineRenderer(QObject * parent)
+	: QObject(parent)
+	, frameRate("frameRate", 50, 1, 1000)
+	, superSampling("superSampling", 4, 1, 8)
+	, bpm("bpm", 120.0f, 20.0f, 400.0f)
+	, valueA("valueA", 0, 0, 100)
+	, valueB("valueB", 0, 0, 100)
+	, valueC("valueC", 0, 0, 100)
+	, valueD("valueD", 0, 0, 100)
+	, triggerA("triggerA", false)
+	, triggerB("triggerB", false)
+	, m_commentExp("^//(\\w+)\\s*=\\s*(\\S+)$")
+	, m_context(nullptr)
+	, m_surface(nullptr)
+	, m_openGLES(false)
+	, m_shaderProgram(nullptr)
+	, m_resolveShaderProgram(nullptr)
+	, m_frameBufferObject(nullptr)
+	, m_resolveFrameBufferObject(nullptr)
+	, m_audioFeatures(AudioFeatures::None)
+	, m_audioProcessing(nullptr)
+	, m_audioChannels(0)
+	, m_audioSampleRate(0)
+	, m_audioPosition(0)
+	, m_frameIndex(0)
+	, m_writeFailed(false)
+	, m_compileTime(0.0)
+{
+	m_commentExp.setMinimal(true);
+	//create an OpenGL context rendering to an offscreen surface
+	m_context = new QOpenGLContext(this);
+	m_context->setFormat(LiveView::getDefaultFormat());
+	if (!m_context->create())
+	{
+		delete m_context;
+		throw std::runtime_error("Failed to create OpenGL context!");
+	}
+	m_surface = new QOffscreenSurface();
+	m_surface->setFormat(m_context->format());
+	m_surface->create();
+	if (!m_context->makeCurrent(m_surface))
+	{
+		delete m_surface;
+		delete m_context;
+		throw std::runtime_error("Failed to make OpenGL context current!");
+	}
+	initializeOpenGLFunctions();
+	m_openGLES = m_context->isOpenGLES();
+	glDisable(GL_CULL_FACE);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	//create shader for resolving supersampled frames
+	m_resolveShaderProgram = new QOpenGLShaderProgram();
+	if (!m_resolveShaderProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, LiveView::vertexShaderCode(m_openGLES))
+		|| !m_resolveShaderProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, LiveView::resolveFragmentCode(m_openGLES))
+		|| !m_resolveShaderProgram->link())
+	{
+		//the destructor does not run if the constructor throws, so release everything here
+		const QString errors = m_resolveShaderProgram->log();
+		delete m_resolveShaderProgram;
+		m_context->doneCurrent();
+		delete m_surface;
+		delete m_context;
+		throw std::runtime_error(("Failed to create shader for resolving the framebuffer: " + errors).toStdString());
+	}
+	//smooth script values like the decks do
+	ParameterSmoother::SPtr smoother = ParameterSmoother::getInstance();
+	m_smoothingHandles[valueA.name()] = smoother->add(valueA.GetSharedParameter(), ParameterSmoother::OnePole, 0.05f);
+	m_smoothingHandles[valueB.name()] = smoother->add(valueB.GetSharedParameter(), ParameterSmoother::OnePole, 0.05f);
+	m_smoothingHandles[valueC.name()] = smoother->add(valueC.GetSharedParameter(), ParameterSmoother::OnePole, 0.05f);
+	m_smoothingHandles[valueD.name()] = smoother->add(valueD.GetSharedParameter(), ParameterSmoother::OnePole, 0.05f);
+	m_smoothingHandles[triggerA.name()] = smoother->add(triggerA.GetSharedParameter());
+	m_smoothingHandles[triggerB.name()] = smoother->add(triggerB.GetSharedParameter());
+	//write every converted frame to the output
+	connect(&m_displayImageConverter, SIGNAL(displayImageChanged(const Image16 &)), this, SLOT(writeFrame(const Image16 &)));
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+	for (auto handle : m_smoothingHandles)
+	{
+		ParameterSmoother::getInstance()->remove(handle);
+	}
+	//make context current so resources can be released
+	if (m_context && m_surface && m_context->makeCurrent(m_surface))
+	{
+		delete m_shaderProgram;
+		delete m_resolveShaderProgram;
+		delete m_frameBufferObject;
+		delete m_resolveFrameBufferObject;
+		m_context->doneCurrent();
+	}
+	delete m_surface;
+}
+
+void OfflineRenderer::loadSettings(const QString & fileName, const QString & deckName)
+{
+	//show file or XML settings
+	QDomElement root = ShowFile::load(fileName).documentElement();
+	try
+	{
+		m_displayImageConverter.fromXML(root);
+	}
+	catch (std::runtime_error e)
+	{
+		//keep default display settings
+	}
+	//play back the automation recorded for the deck
+	QVector<QPair<NodeRanged::SPtr, QString>> parameters;
+	parameters.append(qMakePair(NodeRanged::SPtr(valueA.GetSharedParameter()), deckName));
+	parameters.append(qMakePair(NodeRanged::SPtr(valueB.GetSharedParameter()), deckName));
+	parameters.append(qMakePair(NodeRanged::SPtr(valueC.GetSharedParameter()), deckName));
+	parameters.append(qMakePair(NodeRanged::SPtr(valueD.GetSharedParameter()), deckName));
+	parameters.append(qMakePair(NodeRanged::SPtr(triggerA.GetSharedParameter()), deckName));
+	parameters.append(qMakePair(NodeRanged::SPtr(triggerB.GetSharedParameter()), deckName));
+	m_automation.setParameters(parameters);
+	try
+	{
+		m_automation.fromXML(root);
+		//a rendering has a fixed length, so the automation is played once
+		m_automation.loop = false;
+	}
+	catch (std::runtime_error e)
+	{
+		//no automation. values stay constant
+	}
+}
+
+void OfflineRenderer::loadAudio(const QString & fileName)
+{
+	WavReader audio(fileName);
+	m_audioSamples = audio.samples();
+	m_audioChannels = audio.channelCount();
+	m_audioSampleRate = audio.sampleRate();
+	//analyze the samples like AudioInterface does for WAVE files, but in this thread
+	if (!m_audioProcessing)
+	{
+		m_audioProcessing = new ProcessingWorker(m_audioSampleRate, 24, this);
+		m_audioProcessing->enableLevelsData(false);
+		connect(m_audioProcessing, SIGNAL(fftData(const QVector<float> &, int, float, qint64)), this, SLOT(audioSpectrum(const QVector<float> &, int, float, qint64)));
+	}
+	m_audioProcessing->setSampleRate(m_audioSampleRate);
+}
+
+void OfflineRenderer::loadScript(const QString & fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QFile::ReadOnly))
+	{
+		throw std::runtime_error(("Failed to open \"" + fileName + "\"!").toStdString());
+	}
+	const QByteArray data = file.readAll();
+	//compile script with the same prefix and vertex shader the live view uses
+	m_context->makeCurrent(m_surface);
+	QElapsedTimer timer;
+	timer.start();
+	QOpenGLShaderProgram * program = new QOpenGLShaderProgram();
+	if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, LiveView::vertexShaderCode(m_openGLES))
+		|| !program->addShaderFromSourceCode(QOpenGLShader::Fragment, LiveView::fragmentScriptPrefix(m_openGLES) + QString(data))
+		|| !program->link())
+	{
+		const QString errors = program->log();
+		delete program;
+		throw std::runtime_error(("Failed to compile \"" + fileName + "\": " + errors).toStdString());
+	}
+	m_compileTime = timer.nsecsElapsed() / 1.0e6;
+	delete m_shaderProgram;
+	m_shaderProgram = program;
+	m_audioFeatures = AudioFeatures::parseFeatures(QString(data));
+	//find any variables in comments
+	QList<QByteArray> lines = data.split(QChar::LineFeed);
+	for (auto line : lines)
+	{
+		if (m_commentExp.indexIn(line) >= 0)
+		{
+			setScriptParameter(m_commentExp.cap(1), m_commentExp.cap(2));
+		}
+	}
+}
+
+void OfflineRenderer::setScriptParameter(const QString & name, const QString & value)
+{
+	//same conventions as in Deck::setScriptParameter()
+	bool ok = false;
+	if (name.endsWith("_smoothing"))
+	{
+		ParameterSmoother::Mode mode;
+		float time;
+		const QString valueName = name.left(name.size() - 10);
+		if (m_smoothingHandles.contains(valueName) && ParameterSmoother::parseMode(value, mode, time))
+		{
+			ParameterSmoother::getInstance()->setMode(m_smoothingHandles.value(valueName), mode, time);
+		}
+	}
+	else if (name == triggerA.name() || name == triggerB.name())
+	{
+		const bool bValue = value.toUInt(&ok);
+		if (ok)
+		{
+			(name == triggerA.name() ? triggerA : triggerB) = bValue;
+		}
+	}
+	else
+	{
+		const float fValue = value.toFloat(&ok);
+		if (ok)
+		{
+			ParameterInt * parameters[4] = {&valueA, &valueB, &valueC, &valueD};
+			for (auto parameter : parameters)
+			{
+				if (name == parameter->name())
+				{
+					*parameter = (int)(fValue * 100);
+				}
+			}
+		}
+	}
+}
+
+void OfflineRenderer::setRenderSize(int width, int height)
+{
+	const int maximumSize = maximumRenderSize();
+	if (width <= 0 || height <= 0 || width > maximumSize || height > maximumSize)
+	{
+		throw std::runtime_error(QString("Can not render frames of %1x%2 pixels. The size must be in [1,%3]!").arg(width).arg(height).arg(maximumSize).toStdString());
+	}
+	m_renderSize = QSize(width, height);
+}
+
+QSize OfflineRenderer::renderSize() const
+{
+	return m_renderSize.isValid() ? m_renderSize : QSize(m_displayImageConverter.displayWidth, m_displayImageConverter.displayHeight);
+}
+
+int OfflineRenderer::maximumRenderSize()
+{
+	//the supersampled framebuffer is the largest texture we need
+	m_context->makeCurrent(m_surface);
+	GLint maximumTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maximumTextureSize);
+	return maximumTextureSize / std::max((int)superSampling, 1);
+}
+
+double OfflineRenderer::automationLength() const
+{
+	return m_automation.length();
+}
+
+double OfflineRenderer::audioLength() const
+{
+	return m_audioChannels > 0 && m_audioSampleRate > 0 ? (double)(m_audioSamples.size() / m_audioChannels) / m_audioSampleRate : 0.0;
+}
+
+double OfflineRenderer::compileTime() const
+{
+	return m_compileTime;
+}
+
+double OfflineRenderer::averageRenderTime() const
+{
+	return m_renderTimes.isEmpty() ? 0.0 : std::accumulate(m_renderTimes.cbegin(), m_renderTimes.cend(), 0.0) / m_renderTimes.size();
+}
+
+double OfflineRenderer::averageReadbackTime() const
+{
+	return m_readbackTimes.isEmpty() ? 0.0 : std::accumulate(m_readbackTimes.cbegin(), m_readbackTimes.cend(), 0.0) / m_readbackTimes.size();
+}
+
+const QVector<float> & OfflineRenderer::renderTimes() const
+{
+	return m_renderTimes;
+}
+
+const QVector<float> & OfflineRenderer::readbackTimes() const
+{
+	return m_readbackTimes;
+}
+
+QString OfflineRenderer::rendererName()
+{
+	m_context->makeCurrent(m_surface);
+	return QString((const char *)glGetString(GL_RENDERER)) + ", " + QString((const char *)glGetString(GL_VERSION));
+}
+
+void OfflineRenderer::createFrameBuffers()
+{
+	//render at the output size times the supersampling factor, like the decks do
+	const int width = renderSize().width();
+	const int height = renderSize().height();
+	//the supersampling factor may have changed since the size was set
+	const int maximumSize = maximumRenderSize();
+	if (width > maximumSize || height > maximumSize)
+	{
+		throw std::runtime_error(QString("Can not render frames of %1x%2 pixels with %3x supersampling. The size must be in [1,%4]!").arg(width).arg(height).arg((int)superSampling).arg(maximumSize).toStdString());
+	}
+	delete m_frameBufferObject;
+	delete m_resolveFrameBufferObject;
+	m_resolveFrameBufferObject = nullptr;
+	QOpenGLFramebufferObjectFormat format;
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	format.setInternalTextureFormat(Image16::frameBufferFormat());
+	m_frameBufferObject = new QOpenGLFramebufferObject(width * superSampling, height * superSampling, format);
+	if (superSampling > 1)
+	{
+		QOpenGLFramebufferObjectFormat resolveFormat;
+		resolveFormat.setInternalTextureFormat(Image16::frameBufferFormat());
+		m_resolveFrameBufferObject = new QOpenGLFramebufferObject(width, height, resolveFormat);
+	}
+}
+
+void OfflineRenderer::render(int frameCount, const QString & output)
+{
+	if (!m_shaderProgram)
+	{
+		throw std::runtime_error("No script loaded!");
+	}
+	//open output
+	m_imagePattern.clear();
+	m_frameIndex = 0;
+	m_writeFailed = false;
+	if (output == "-")
+	{
+		if (!m_output.open(stdout, QIODevice::WriteOnly))
+		{
+			throw std::runtime_error("Failed to open stdout for writing!");
+		}
+	}
+	else if (output.contains('%'))
+	{
+		//the pattern is used as a format string, so it must contain exactly one integer conversion and nothing else
+		if (!QRegExp("([^%]|%%)*%[0-9]*d([^%]|%%)*").exactMatch(output))
+		{
+			throw std::runtime_error(("Invalid image file name pattern \"" + output + "\". Use one number format like %05d and %% for a percent sign!").toStdString());
+		}
+		m_imagePattern = output;
+	}
+	else if (!output.isEmpty())
+	{
+		m_output.setFileName(output);
+		if (!m_output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			throw std::runtime_error(("Failed to open \"" + output + "\" for writing!").toStdString());
+		}
+	}
+	m_context->makeCurrent(m_surface);
+	createFrameBuffers();
+	m_renderTimes.clear();
+	m_readbackTimes.clear();
+	m_renderTimes.reserve(frameCount);
+	m_readbackTimes.reserve(frameCount);
+	m_automation.play(0);
+	m_audioPosition = 0;
+	if (m_audioProcessing)
+	{
+		m_audioProcessing->reset();
+	}
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		//advance the clock by exactly one frame
+		const int64_t timestamp = (int64_t)frame * 1000000000 / frameRate;
+		m_automation.update(timestamp);
+		ParameterSmoother::getInstance()->update(timestamp);
+		feedAudio(timestamp);
+		AudioFeatures::getInstance()->update(timestamp);
+		renderFrame(timestamp);
+	}
+	m_automation.stop(0);
+	m_output.close();
+}
+
+void OfflineRenderer::feedAudio(int64_t timestamp)
+{
+	//analyze all audio up to the frame time. the spectra arrive in audioSpectrum() before this returns
+	if (!m_audioProcessing)
+	{
+		return;
+	}
+	const int frameCount = m_audioSamples.size() / m_audioChannels;
+	const int end = (int)std::min<int64_t>(timestamp * m_audioSampleRate / 1000000000, frameCount);
+	if (end > m_audioPosition)
+	{
+		const QVector<float> block = m_audioSamples.mid(m_audioPosition * m_audioChannels, (end - m_audioPosition) * m_audioChannels);
+		m_audioProcessing->input(block, m_audioChannels, (float)(end - m_audioPosition) * 1.0e6f / m_audioSampleRate);
+		m_audioPosition = end;
+	}
+}
+
+void OfflineRenderer::audioSpectrum(const QVector<float> & spectrum, int /*channels*/, float /*timeus*/, qint64 streamTime)
+{
+	AudioFeatures::getInstance()->addSpectrum(spectrum, streamTime);
+}
+
+void OfflineRenderer::drawQuad(QOpenGLShaderProgram * program)
+{
+	const int position = program->attributeLocation("position");
+	const int texcoord0 = program->attributeLocation("texcoord0");
+	glEnableVertexAttribArray(position);
+	glEnableVertexAttribArray(texcoord0);
+	glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), &m_quadData[0]);
+	glVertexAttribPointer(texcoord0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), &m_quadData[3]);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glDisableVertexAttribArray(position);
+	glDisableVertexAttribArray(texcoord0);
+}
+
+void OfflineRenderer::renderFrame(int64_t timestamp)
+{
+	QElapsedTimer timer;
+	timer.start();
+	//render script to the (supersampled) framebuffer
+	m_frameBufferObject->bind();
+	glViewport(0, 0, m_frameBufferObject->width(), m_frameBufferObject->height());
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	m_shaderProgram->bind();
+	QMatrix4x4 projectionMatrix;
+	projectionMatrix.ortho(-0.5f, 0.5f, -0.5f, 0.5f, 0.0f, 10.0f);
+	m_shaderProgram->setUniformValue("projectionMatrix", projectionMatrix);
+	m_shaderProgram->setUniformValue("renderSize", QVector2D(m_frameBufferObject->width(), m_frameBufferObject->height()));
+	const double seconds = timestamp / 1.0e9;
+	const double beats = seconds * bpm / 60.0;
+	m_shaderProgram->setUniformValue("time", (float)seconds);
+	m_shaderProgram->setUniformValue("beatPhase", (float)(beats - std::floor(beats)));
+	m_shaderProgram->setUniformValue("bar", (float)std::floor(beats / 4.0));
+	m_shaderProgram->setUniformValue("bpm", (float)bpm);
+	ParameterSmoother::SPtr smoother = ParameterSmoother::getInstance();
+	for (auto it = m_smoothingHandles.cbegin(); it != m_smoothingHandles.cend(); ++it)
+	{
+		m_shaderProgram->setUniformValue(it.key().toLocal8Bit().constData(), smoother->value(it.value()));
+	}
+	if (m_audioFeatures != AudioFeatures::None)
+	{
+		AudioFeatures::getInstance()->setUniforms(m_shaderProgram, m_audioFeatures);
+	}
+	drawQuad(m_shaderProgram);
+	m_shaderProgram->release();
+	m_frameBufferObject->release();
+	//resolve supersampled framebuffer to display size
+	QOpenGLFramebufferObject * outputFrameBuffer = m_frameBufferObject;
+	if (m_resolveFrameBufferObject)
+	{
+		m_resolveFrameBufferObject->bind();
+		glViewport(0, 0, m_resolveFrameBufferObject->width(), m_resolveFrameBufferObject->height());
+		m_resolveShaderProgram->bind();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_frameBufferObject->texture());
+		QMatrix4x4 blitMatrix;
+		blitMatrix.ortho(-0.5f, 0.5f, -0.5f, 0.5f, -1.0f, 1.0f);
+		m_resolveShaderProgram->setUniformValue("projectionMatrix", blitMatrix);
+		m_resolveShaderProgram->setUniformValue("frameBufferTexture", 0);
+		m_resolveShaderProgram->setUniformValue("sourceTexelSize", QVector2D(1.0f / m_frameBufferObject->width(), 1.0f / m_frameBufferObject->height()));
+		m_resolveShaderProgram->setUniformValue("superSampling", (int)superSampling);
+		drawQuad(m_resolveShaderProgram);
+		m_resolveShaderProgram->release();
+		m_resolveFrameBufferObject->release();
+		outputFrameBuffer = m_resolveFrameBufferObject;
+	}
+	//wait for the GPU, so the render time is the actual shader cost
+	glFinish();
+	m_renderTimes.append(timer.nsecsElapsed() / 1.0e6f);
+	timer.restart();
+	//read back and convert for the display. this calls writeFrame()
+	m_displayImageConverter.convertImage(Image16::fromFrameBuffer(outputFrameBuffer), outputFrameBuffer->width(), outputFrameBuffer->height());
+	m_readbackTimes.append(timer.nsecsElapsed() / 1.0e6f);
+	if (m_writeFailed)
+	{
+		throw std::runtime_error(("Failed to write frame " + QString::number(m_frameIndex - 1) + "!").toStdString());
+	}
+}
+
+void OfflineRenderer::writeFrame(const Image16 & image)
+{
+	const QImage rgbImage = image.toImage().convertToFormat(QImage::Format_RGB888);
+	if (!m_imagePattern.isEmpty())
+	{
+		const QString fileName = QString().sprintf(m_imagePattern.toLocal8Bit().constData(), m_frameIndex);
+		m_writeFailed = m_writeFailed || !rgbImage.save(fileName);
+	}
+	else if (m_output.isOpen())
+	{
+		//write scanlines without padding
+		for (int y = 0; y < rgbImage.height(); ++y)
+		{
+			const qint64 size = rgbImage.width() * 3;
+			m_writeFailed = m_writeFailed || m_output.write((const char *)rgbImage.constScanLine(y), size) != size;
+		}
+	}
+	++m_frameIndex;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Parameters.h"
+#include "DisplayImageConverter.h"
+#include "AutomationRecorder.h"
+#include "AudioProcessing.h"
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QSize>
+#include <QRegExp>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QOffscreenSurface>
+
+
+/// @brief Renders an effect script to LED frames without a window and without a live clock.
+/// Time advances in fixed steps of 1 / frameRate, so the output only depends on the script, the settings and the
+/// automation and is the same for every run. Frames are rendered as fast as the GPU allows.
+/// Scripts are rendered with the same shaders as in LiveView and converted for the display with DisplayImageConverter.
+class OfflineRenderer : public QObject, protected QOpenGLFunctions
+{
+	Q_OBJECT
+
+public:
+	/// @brief Constructor. Creates an offscreen OpenGL context.
+	/// @note Throws std::runtime_error if no OpenGL context can be created.
+	OfflineRenderer(QObject * parent = NULL);
+	~OfflineRenderer();
+
+	/// @brief Read display settings and automation from a settings file written by NerDisco.
+	/// Missing sections are ignored and the defaults are used.
+	/// @param fileName Settings XML file.
+	/// @param deckName Name of the deck whose automation is played back, e.g. "DeckA".
+	/// @note Throws std::runtime_error if the file can not be read.
+	void loadSettings(const QString & fileName, const QString & deckName);
+
+	/// @brief Load and compile an effect script. Values set in script comments are applied.
+	/// @note Throws std::runtime_error if the script can not be read or compiled.
+	void loadScript(const QString & fileName);
+
+	/// @brief Load a WAVE file that is analyzed along with the frames, so scripts get the same audio features as live.
+	/// The audio is fed to the analysis in fixed steps of one frame, so the features are the same for every run.
+	/// @note Throws std::runtime_error if the file can not be read.
+	void loadAudio(const QString & fileName);
+
+	/// @brief Set the size frames are rendered and written in, overriding the display size of the settings.
+	/// Unlike the display size this is not limited to the size of an LED display, so frames can be rendered for video.
+	/// @note Throws std::runtime_error if the size is empty or larger than maximumRenderSize().
+	void setRenderSize(int width, int height);
+	/// @brief Retrieve the size frames are rendered and written in.
+	/// This is the size set with setRenderSize() or the display size of the settings if none was set.
+	QSize renderSize() const;
+	/// @brief Retrieve the largest width and height OpenGL can render a frame in with the current supersampling factor.
+	int maximumRenderSize();
+
+	/// @brief Render frames, starting at time 0, and write them.
+	/// @param frameCount Number of frames to render.
+	/// @param output "-" to write raw RGB frames to stdout, a file name containing one printf-style integer format,
+	/// e.g. "frame%05d.png", to write an image per frame, or a file name to write raw RGB frames to.
+	/// Use "%%" for a percent sign in an image file name.
+	/// Pass an empty string to render and convert frames without writing them, e.g. for benchmarking.
+	/// @note Throws std::runtime_error if the output can not be written.
+	void render(int frameCount, const QString & output);
+
+	/// @brief Retrieve the length of the loaded automation in seconds or 0 if there is none.
+	double automationLength() const;
+	/// @brief Retrieve the length of the loaded audio in seconds or 0 if there is none.
+	double audioLength() const;
+
+	/// @brief Retrieve the time compiling and linking the last script loaded took in ms.
+	double compileTime() const;
+	/// @brief Retrieve the average GPU time for rendering and resolving a frame in ms.
+	double averageRenderTime() const;
+	/// @brief Retrieve the average time for reading back and converting a frame in ms.
+	double averageReadbackTime() const;
+	/// @brief Retrieve the render time of every frame of the last render() call in ms.
+	const QVector<float> & renderTimes() const;
+	/// @brief Retrieve the readback time of every frame of the last render() call in ms.
+	const QVector<float> & readbackTimes() const;
+
+	/// @brief Retrieve the OpenGL renderer and version, e.g. "llvmpipe (LLVM 3.8, 256 bits), 3.0 Mesa 12.0.6".
+	QString rendererName();
+
+	ParameterInt frameRate;
+	ParameterInt superSampling;
+	/// @brief Tempo passed to the script via the "beatPhase", "bar" and "bpm" uniforms.
+	ParameterFloat bpm;
+
+	ParameterInt valueA;
+	ParameterInt valueB;
+	ParameterInt valueC;
+	ParameterInt valueD;
+	ParameterBool triggerA;
+	ParameterBool triggerB;
+
+private slots:
+	void writeFrame(const Image16 & image);
+	void audioSpectrum(const QVector<float> & spectrum, int channels, float timeus, qint64 streamTime);
+
+private:
+	void setScriptParameter(const QString & name, const QString & value);
+	void createFrameBuffers();
+	void drawQuad(QOpenGLShaderProgram * program);
+	void renderFrame(int64_t timestamp);
+	void feedAudio(int64_t timestamp);
+
+	static const float m_quadData[20];
+
+	QRegExp m_commentExp;
+	QOpenGLContext * m_context;
+	QOffscreenSurface * m_surface;
+	bool m_openGLES;
+	QOpenGLShaderProgram * m_shaderProgram;
+	QOpenGLShaderProgram * m_resolveShaderProgram;
+	QOpenGLFramebufferObject * m_frameBufferObject;
+	QOpenGLFramebufferObject * m_resolveFrameBufferObject;
+
+	DisplayImageConverter m_displayImageConverter;
+	QSize m_renderSize; //size set with setRenderSize() or invalid to use the display size
+	AutomationRecorder m_automation;
+	/// @brief Handles of the script values in the parameter smoother by uniform name.
+	QHash<QString, int> m_smoothingHandles;
+	/// @brief Audio features used by the script.
+	int m_audioFeatures;
+
+	ProcessingWorker * m_audioProcessing;
+	QVector<float> m_audioSamples; //interleaved samples of the whole audio file
+	int m_audioChannels;
+	int m_audioSampleRate;
+	int m_audioPosition; //frames fed to the analysis so far
+
+	QFile m_output;
+	QString m_imagePattern;
+	int m_frameIndex;
+	bool m_writeFailed;
+
+	double m_compileTime;
+	QVector<float> m_renderTimes;
+	QVector<float> m_readbackTimes;
+};
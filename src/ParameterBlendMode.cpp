@@ -0,0 +1,37 @@
+#include "ParameterBlendMode.h"
+
+
+NodeBlendMode::NodeBlendMode(const QString & name, BlendMode value, QObject * parent)
+	: NodeEnum(name, value, parent)
+{
+	m_entries[BlendMode::BlendNormal] = "Normal";
+	m_entries[BlendMode::BlendAdd] = "Add";
+	m_entries[BlendMode::BlendMultiply] = "Multiply";
+	m_entries[BlendMode::BlendScreen] = "Screen";
+	m_entries[BlendMode::BlendDifference] = "Difference";
+}
+
+QString NodeBlendMode::staticTypeName()
+{
+	return "NodeBlendMode";
+}
+
+QString NodeBlendMode::typeName() const
+{
+	return staticTypeName();
+}
+
+BlendMode NodeBlendMode::value() const
+{
+	return (BlendMode)m_value;
+}
+
+void NodeBlendMode::setValue(BlendMode value)
+{
+	NodeEnum::setValue((int64_t)value);
+}
+
+void NodeBlendMode::emitValueChanged()
+{
+	emit valueChanged((BlendMode)m_value);
+}
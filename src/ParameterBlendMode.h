@@ -0,0 +1,33 @@
+#pragma once
+
+#include "NodeEnum.h"
+#include "ParameterT.h"
+
+
+enum BlendMode {
+	BlendNormal, BlendAdd, BlendMultiply,
+	BlendScreen, BlendDifference
+};
+
+class NodeBlendMode : public NodeEnum
+{
+	Q_OBJECT
+
+public:
+	NodeBlendMode(const QString & name, BlendMode value, QObject * parent = NULL);
+	static QString staticTypeName();
+	QString typeName() const;
+
+	BlendMode value() const;
+
+public slots:
+	void setValue(BlendMode value);
+
+signals:
+	void valueChanged(BlendMode value);
+
+protected:
+	virtual void emitValueChanged();
+};
+
+typedef ParameterT<BlendMode, NodeBlendMode, false> ParameterBlendMode;
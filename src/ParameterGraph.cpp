@@ -0,0 +1,190 @@
+#include "ParameterGraph.h"
+
+#include "NodeBase.h"
+#include <QSet>
+#include <QQueue>
+#include <QPair>
+#include <stdexcept>
+
+
+std::mutex ParameterGraph::s_mutex;
+
+ParameterGraph::SPtr & ParameterGraph::getInstance()
+{
+	static ParameterGraph::SPtr s_instance = nullptr;
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_instance)
+	{
+		s_instance.reset(new ParameterGraph());
+	}
+	return s_instance;
+}
+
+ParameterGraph::ParameterGraph()
+	: m_propagationCount(0)
+	, m_propagationsPerSecond(0.0f)
+{
+	m_rateTimer.start();
+}
+
+bool ParameterGraph::isReachable(NodeBase * from, NodeBase * to) const
+{
+	QSet<NodeBase *> visited;
+	QQueue<NodeBase *> queue;
+	queue.enqueue(from);
+	visited.insert(from);
+	while (!queue.isEmpty())
+	{
+		NodeBase * node = queue.dequeue();
+		if (node == to)
+		{
+			return true;
+		}
+		for (auto neighbour : m_edges.value(node))
+		{
+			if (!visited.contains(neighbour))
+			{
+				visited.insert(neighbour);
+				queue.enqueue(neighbour);
+			}
+		}
+	}
+	return false;
+}
+
+void ParameterGraph::link(NodeBase * a, NodeBase * b)
+{
+	if (a == nullptr || b == nullptr)
+	{
+		throw std::runtime_error("ParameterGraph::link() - NULL node passed!");
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	//if the nodes are connected already, another link would create a cycle
+	if (isReachable(a, b))
+	{
+		throw std::runtime_error(QString("ParameterGraph::link() - Linking \"%1\" and \"%2\" would create a cycle!").arg(a->name()).arg(b->name()).toStdString());
+	}
+	m_edges[a].append(b);
+	m_edges[b].append(a);
+}
+
+void ParameterGraph::unlink(NodeBase * a, NodeBase * b)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_edges.contains(a))
+	{
+		m_edges[a].removeAll(b);
+		if (m_edges[a].isEmpty())
+		{
+			m_edges.remove(a);
+		}
+	}
+	if (m_edges.contains(b))
+	{
+		m_edges[b].removeAll(a);
+		if (m_edges[b].isEmpty())
+		{
+			m_edges.remove(b);
+		}
+	}
+}
+
+void ParameterGraph::remove(NodeBase * node)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto neighbour : m_edges.value(node))
+	{
+		m_edges[neighbour].removeAll(node);
+		if (m_edges[neighbour].isEmpty())
+		{
+			m_edges.remove(neighbour);
+		}
+	}
+	m_edges.remove(node);
+	m_dirty.removeAll(node);
+}
+
+bool ParameterGraph::isLinked(NodeBase * node) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_edges.contains(node);
+}
+
+void ParameterGraph::markDirty(NodeBase * node)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_edges.contains(node))
+	{
+		//move node to the end, so the latest change wins
+		m_dirty.removeAll(node);
+		m_dirty.append(node);
+	}
+}
+
+int ParameterGraph::propagate()
+{
+	//collect all updates while holding the lock. they're applied afterwards, because applying them marks nodes dirty again
+	QVector<QPair<NodeBase *, NodeBase *>> updates;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		QSet<NodeBase *> visited;
+		//start with the latest change. earlier changes in the same group are overwritten anyway
+		for (int i = m_dirty.size() - 1; i >= 0; --i)
+		{
+			NodeBase * source = m_dirty.at(i);
+			if (visited.contains(source))
+			{
+				continue;
+			}
+			//walk the tree breadth-first and store (from, to) pairs, so every node is updated after its predecessor
+			QQueue<NodeBase *> queue;
+			queue.enqueue(source);
+			visited.insert(source);
+			while (!queue.isEmpty())
+			{
+				NodeBase * node = queue.dequeue();
+				for (auto neighbour : m_edges.value(node))
+				{
+					if (!visited.contains(neighbour))
+					{
+						visited.insert(neighbour);
+						queue.enqueue(neighbour);
+						updates.append(qMakePair(node, neighbour));
+					}
+				}
+			}
+		}
+		m_dirty.clear();
+	}
+	//apply updates
+	QSet<NodeBase *> updated;
+	for (const auto & update : updates)
+	{
+		update.second->assignFrom(*update.first);
+		updated.insert(update.second);
+	}
+	//remove the nodes we just updated from the dirty list again and update statistics
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = m_dirty.size() - 1; i >= 0; --i)
+	{
+		if (updated.contains(m_dirty.at(i)))
+		{
+			m_dirty.remove(i);
+		}
+	}
+	m_propagationCount += updates.size();
+	const qint64 elapsed = m_rateTimer.elapsed();
+	if (elapsed >= 1000)
+	{
+		m_propagationsPerSecond = (float)m_propagationCount * 1000.0f / (float)elapsed;
+		m_propagationCount = 0;
+		m_rateTimer.restart();
+	}
+	return updates.size();
+}
+
+float ParameterGraph::propagationsPerSecond() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_propagationsPerSecond;
+}
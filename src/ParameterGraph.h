@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+
+class NodeBase;
+
+
+/// @brief Keeps track of links between parameter nodes and propagates value changes along them.
+/// Links are undirected edges. Changes are not propagated immediately, but collected and propagated once per frame
+/// when calling propagate(). Every group of linked nodes is a tree, so a change reaches every node exactly once.
+class ParameterGraph
+{
+public:
+	/// brief Shared pointer of ParameterGraph object.
+	typedef std::shared_ptr<ParameterGraph> SPtr;
+
+	/// @brief Retrieve or create the instance of the parameter graph.
+	static SPtr & getInstance();
+
+	/// @brief Link two nodes so they share the same value.
+	/// @param a First node.
+	/// @param b Second node.
+	/// @note Throws a std::runtime_error if the nodes are already linked directly or indirectly, as that would create a cycle.
+	void link(NodeBase * a, NodeBase * b);
+
+	/// @brief Remove the link between two nodes.
+	void unlink(NodeBase * a, NodeBase * b);
+
+	/// @brief Remove a node and all its links from the graph. Called when a node is destroyed.
+	void remove(NodeBase * node);
+
+	/// @brief Check if a node has any links.
+	bool isLinked(NodeBase * node) const;
+
+	/// @brief Mark the value of a node as changed. It will be propagated to all linked nodes on the next call to propagate().
+	/// @note If multiple nodes of the same group changed since the last call to propagate(), the latest change wins.
+	void markDirty(NodeBase * node);
+
+	/// @brief Propagate all changed values to their linked nodes in breadth-first order. Call once per frame.
+	/// @return Number of nodes that were updated.
+	int propagate();
+
+	/// @brief Retrieve the number of node updates per second for profiling.
+	float propagationsPerSecond() const;
+
+private:
+	ParameterGraph();
+	ParameterGraph(ParameterGraph & pg);
+	ParameterGraph & operator=(const ParameterGraph & pg);
+
+	bool isReachable(NodeBase * from, NodeBase * to) const;
+
+	static std::mutex s_mutex;
+
+	mutable std::mutex m_mutex;
+	QHash<NodeBase *, QVector<NodeBase *>> m_edges;
+	QVector<NodeBase *> m_dirty;
+
+	QElapsedTimer m_rateTimer;
+	int m_propagationCount;
+	float m_propagationsPerSecond;
+};
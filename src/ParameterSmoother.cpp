@@ -0,0 +1,189 @@
+#include "ParameterSmoother.h"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <QStringList>
+
+
+//values closer than this to their target snap to it, so smoothing comes to rest
+static const float SnapDistance = 1.0e-5f;
+//time steps longer than this, e.g. after the application stalled, are clamped to avoid jumps
+static const float MaximumTimeStep = 0.1f;
+
+std::mutex ParameterSmoother::s_mutex;
+
+ParameterSmoother::SPtr & ParameterSmoother::getInstance()
+{
+	static ParameterSmoother::SPtr s_instance = nullptr;
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_instance)
+	{
+		s_instance.reset(new ParameterSmoother());
+	}
+	return s_instance;
+}
+
+ParameterSmoother::ParameterSmoother()
+	: m_lastTimestamp(-1)
+{
+}
+
+int ParameterSmoother::add(NodeRanged::SPtr parameter, Mode mode, float time)
+{
+	if (!parameter)
+	{
+		throw std::runtime_error("ParameterSmoother::add() - Invalid parameter passed!");
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	//reuse a free handle if possible
+	int handle = (int)(std::find(m_indices.begin(), m_indices.end(), -1) - m_indices.begin());
+	if (handle == (int)m_indices.size())
+	{
+		m_indices.push_back(-1);
+	}
+	m_indices[handle] = (int)m_parameters.size();
+	m_handles.push_back(handle);
+	m_parameters.push_back(parameter);
+	m_modes.push_back((uint8_t)mode);
+	m_times.push_back(time);
+	m_targets.push_back((float)parameter->normalizedValue());
+	m_values.push_back(m_targets.back());
+	m_velocities.push_back(0.0f);
+	return handle;
+}
+
+void ParameterSmoother::remove(int handle)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (handle < 0 || handle >= (int)m_indices.size() || m_indices[handle] < 0)
+	{
+		return;
+	}
+	//move the last entry into the gap, so the arrays stay dense
+	const int index = m_indices[handle];
+	const int last = (int)m_parameters.size() - 1;
+	m_parameters[index] = m_parameters[last];
+	m_modes[index] = m_modes[last];
+	m_times[index] = m_times[last];
+	m_targets[index] = m_targets[last];
+	m_values[index] = m_values[last];
+	m_velocities[index] = m_velocities[last];
+	m_handles[index] = m_handles[last];
+	m_indices[m_handles[index]] = index;
+	m_indices[handle] = -1;
+	m_parameters.pop_back();
+	m_modes.pop_back();
+	m_times.pop_back();
+	m_targets.pop_back();
+	m_values.pop_back();
+	m_velocities.pop_back();
+	m_handles.pop_back();
+}
+
+void ParameterSmoother::setMode(int handle, Mode mode, float time)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (handle >= 0 && handle < (int)m_indices.size() && m_indices[handle] >= 0)
+	{
+		const int index = m_indices[handle];
+		m_modes[index] = (uint8_t)mode;
+		m_times[index] = time;
+		m_velocities[index] = 0.0f;
+	}
+}
+
+void ParameterSmoother::update(int64_t timestamp)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const float dt = m_lastTimestamp < 0 ? 0.0f : std::max(0.0f, std::min(MaximumTimeStep, (float)(timestamp - m_lastTimestamp) / 1.0e9f));
+	m_lastTimestamp = timestamp;
+	const size_t count = m_parameters.size();
+	//gather the current parameter values first, then run the filters over the dense arrays
+	for (size_t i = 0; i < count; ++i)
+	{
+		m_targets[i] = (float)m_parameters[i]->normalizedValue();
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float target = m_targets[i];
+		const float time = m_times[i];
+		float value = m_values[i];
+		if (time <= 0.0f || m_modes[i] == None)
+		{
+			value = target;
+		}
+		else if (m_modes[i] == OnePole)
+		{
+			value += (1.0f - std::exp(-dt / time)) * (target - value);
+		}
+		else if (m_modes[i] == Spring)
+		{
+			//critically damped spring, integrated with an approximation of exp(-omega * dt) that is stable for any time step
+			const float omega = 2.0f / time;
+			const float x = omega * dt;
+			const float decay = 1.0f / (1.0f + x + 0.48f * x * x + 0.235f * x * x * x);
+			const float change = value - target;
+			const float temp = (m_velocities[i] + omega * change) * dt;
+			m_velocities[i] = (m_velocities[i] - omega * temp) * decay;
+			value = target + (change + temp) * decay;
+		}
+		else if (m_modes[i] == Slew)
+		{
+			const float step = dt / time;
+			value += std::max(-step, std::min(step, target - value));
+		}
+		if (std::abs(target - value) < SnapDistance)
+		{
+			value = target;
+			m_velocities[i] = 0.0f;
+		}
+		m_values[i] = value;
+	}
+}
+
+float ParameterSmoother::value(int handle) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (handle >= 0 && handle < (int)m_indices.size() && m_indices[handle] >= 0)
+	{
+		return m_values[m_indices[handle]];
+	}
+	return 0.0f;
+}
+
+bool ParameterSmoother::parseMode(const QString & description, Mode & mode, float & time)
+{
+	const QStringList parts = description.split(':');
+	const QString name = parts.at(0).toLower();
+	if (name == "none")
+	{
+		mode = None;
+		time = 0.0f;
+		return true;
+	}
+	bool ok = parts.size() == 2;
+	const float value = ok ? parts.at(1).toFloat(&ok) : 0.0f;
+	if (!ok || value < 0.0f)
+	{
+		return false;
+	}
+	if (name == "onepole")
+	{
+		mode = OnePole;
+	}
+	else if (name == "spring")
+	{
+		mode = Spring;
+	}
+	else if (name == "slew")
+	{
+		mode = Slew;
+	}
+	else
+	{
+		return false;
+	}
+	time = value;
+	return true;
+}
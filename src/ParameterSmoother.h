@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include "NodeRanged.h"
+
+
+/// @brief Smooths the normalized values of parameters, so coarse MIDI steps and jumps don't show up as stepping in effects.
+/// Parameters are not changed. Instead the smoothed values are kept in separate arrays (structure of arrays)
+/// and all of them are advanced in one pass once per rendered frame by calling update().
+class ParameterSmoother
+{
+public:
+	/// brief Shared pointer of ParameterSmoother object.
+	typedef std::shared_ptr<ParameterSmoother> SPtr;
+
+	enum Mode {
+		None, ///< Value follows the parameter immediately.
+		OnePole, ///< Exponential approach. time is the time constant in seconds.
+		Spring, ///< Critically damped spring. Starts and stops softly without overshooting. time is the smoothing time in seconds.
+		Slew ///< Linear movement with a maximum rate. time is the time to move across the full range in seconds.
+	};
+
+	/// @brief Retrieve or create the instance of the smoother.
+	static SPtr & getInstance();
+
+	/// @brief Add a parameter to smooth. The smoothed value starts at the current parameter value.
+	/// @return Handle to use in the other functions.
+	int add(NodeRanged::SPtr parameter, Mode mode = None, float time = 0.0f);
+
+	/// @brief Stop smoothing a parameter. The handle becomes invalid.
+	void remove(int handle);
+
+	/// @brief Change how a parameter is smoothed.
+	void setMode(int handle, Mode mode, float time);
+
+	/// @brief Advance all smoothed values towards their parameter values. Call once per rendered frame.
+	/// @param timestamp Frame time in nanoseconds.
+	void update(int64_t timestamp);
+
+	/// @brief Retrieve the smoothed normalized value of a parameter.
+	float value(int handle) const;
+
+	/// @brief Parse a smoothing description like "none", "onepole:0.05", "spring:0.1" or "slew:2".
+	/// @return False if the description is invalid.
+	static bool parseMode(const QString & description, Mode & mode, float & time);
+
+private:
+	ParameterSmoother();
+	ParameterSmoother(ParameterSmoother & ps);
+	ParameterSmoother & operator=(const ParameterSmoother & ps);
+
+	static std::mutex s_mutex;
+
+	mutable std::mutex m_mutex;
+	int64_t m_lastTimestamp; //time of the last update or -1 before the first one
+	//per-parameter state. all arrays have the same size
+	std::vector<NodeRanged::SPtr> m_parameters;
+	std::vector<uint8_t> m_modes;
+	std::vector<float> m_times;
+	std::vector<float> m_targets;
+	std::vector<float> m_values;
+	std::vector<float> m_velocities;
+	std::vector<int> m_handles; //handle of every entry
+	//index of the entry for a handle or -1 for unused handles
+	std::vector<int> m_indices;
+};
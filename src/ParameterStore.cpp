@@ -0,0 +1,128 @@
+#include "ParameterStore.h"
+
+#include <thread>
+
+
+ParameterSnapshot::ParameterSnapshot()
+	: m_version(0)
+{
+}
+
+uint64_t ParameterSnapshot::version() const
+{
+	return m_version;
+}
+
+bool ParameterSnapshot::contains(const NodeBase * node) const
+{
+	return m_values.contains(node);
+}
+
+QVariant ParameterSnapshot::value(const NodeBase * node) const
+{
+	return m_values.value(node);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+std::mutex ParameterStore::s_mutex;
+
+ParameterStore::SPtr & ParameterStore::getInstance()
+{
+	static ParameterStore::SPtr s_instance = nullptr;
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_instance)
+	{
+		s_instance.reset(new ParameterStore());
+	}
+	return s_instance;
+}
+
+ParameterStore::ParameterStore()
+	: m_current(0)
+{
+	m_readers[0] = 0;
+	m_readers[1] = 0;
+}
+
+ParameterSnapshot::SPtr ParameterStore::snapshot() const
+{
+	//register as reader of the current buffer, then make sure it is still current. commit() never writes a buffer
+	//with readers, so if it is still current after registering, it stays untouched until the reader is done
+	int index = m_current.load();
+	m_readers[index].fetch_add(1);
+	while (m_current.load() != index)
+	{
+		m_readers[index].fetch_sub(1);
+		index = m_current.load();
+		m_readers[index].fetch_add(1);
+	}
+	std::atomic<int> * readers = &m_readers[index];
+	return ParameterSnapshot::SPtr(&m_snapshots[index], [readers](const ParameterSnapshot *) { readers->fetch_sub(1); });
+}
+
+void ParameterStore::publish(const NodeBase * node, const QVariant & value)
+{
+	//writers are serialized so no change is lost. readers never take this lock
+	std::lock_guard<std::mutex> lock(m_writeMutex);
+	m_pending.insert(node, value);
+}
+
+void ParameterStore::publish(const QVector<QPair<const NodeBase *, QVariant>> & values)
+{
+	std::lock_guard<std::mutex> lock(m_writeMutex);
+	for (auto value : values)
+	{
+		m_pending.insert(value.first, value.second);
+	}
+}
+
+void ParameterStore::remove(const NodeBase * node)
+{
+	std::lock_guard<std::mutex> lock(m_writeMutex);
+	m_pending.insert(node, QVariant());
+}
+
+void ParameterStore::applyChanges(QHash<const NodeBase *, QVariant> & values, const QHash<const NodeBase *, QVariant> & changes)
+{
+	for (auto it = changes.cbegin(); it != changes.cend(); ++it)
+	{
+		if (it.value().isValid())
+		{
+			values.insert(it.key(), it.value());
+		}
+		else
+		{
+			values.remove(it.key());
+		}
+	}
+}
+
+void ParameterStore::commit()
+{
+	std::lock_guard<std::mutex> commitLock(m_commitMutex);
+	//take the changes, so nodes can publish again while waiting for readers. readers may publish while holding a snapshot
+	QHash<const NodeBase *, QVariant> changes;
+	{
+		std::lock_guard<std::mutex> lock(m_writeMutex);
+		changes.swap(m_pending);
+	}
+	if (changes.isEmpty())
+	{
+		return;
+	}
+	const int current = m_current.load();
+	const int next = 1 - current;
+	//readers release their snapshot right after using it, so this hardly ever waits
+	while (m_readers[next].load() != 0)
+	{
+		std::this_thread::yield();
+	}
+	//the other buffer is two commits old. bring it up to date with the changes of the last commit and this one
+	ParameterSnapshot & snapshot = m_snapshots[next];
+	applyChanges(snapshot.m_values, m_lastChanges);
+	applyChanges(snapshot.m_values, changes);
+	snapshot.m_version = m_snapshots[current].m_version + 1;
+	m_current.store(next);
+	m_lastChanges.swap(changes);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include <cstdint>
+
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QVariant>
+
+class NodeBase;
+
+
+/// @brief Immutable set of the values of all parameter nodes at one point in time.
+/// Snapshots are never modified while they are held by a reader, so they can be read from any thread without locking.
+class ParameterSnapshot
+{
+public:
+	/// brief Shared pointer of immutable ParameterSnapshot object.
+	typedef std::shared_ptr<const ParameterSnapshot> SPtr;
+
+	ParameterSnapshot();
+
+	/// @brief Version of the snapshot. Incremented with every commit that changed values.
+	uint64_t version() const;
+
+	/// @brief Check if the snapshot contains a value for a node.
+	bool contains(const NodeBase * node) const;
+
+	/// @brief Retrieve the raw value of a node.
+	/// @return Value of the node or an invalid QVariant if the node is not in the snapshot.
+	QVariant value(const NodeBase * node) const;
+
+	/// @brief Retrieve the value of a node converted to a parameter value type.
+	template<typename T>
+	T value(const NodeBase * node) const
+	{
+		return fromVariant<T>(value(node));
+	}
+
+private:
+	friend class ParameterStore;
+
+	//NodeRanged and NodeEnum values are stored as numbers, NodeQString values as strings. convert them like the nodes do
+	template<typename T>
+	static typename std::enable_if<std::is_same<T, bool>::value, T>::type fromVariant(const QVariant & v) { return v.toDouble() > 0.0; }
+	template<typename T>
+	static typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, T>::type fromVariant(const QVariant & v) { return (T)v.toDouble(); }
+	template<typename T>
+	static typename std::enable_if<std::is_enum<T>::value, T>::type fromVariant(const QVariant & v) { return (T)v.toLongLong(); }
+	template<typename T>
+	static typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_enum<T>::value, T>::type fromVariant(const QVariant & v) { return v.value<T>(); }
+
+	uint64_t m_version;
+	QHash<const NodeBase *, QVariant> m_values;
+};
+
+//-------------------------------------------------------------------------------------------------
+
+/// @brief Publishes the values of all parameter nodes as immutable snapshots.
+/// Nodes publish their value whenever it changes. Changes are collected and committed once per frame into the second of
+/// two snapshot buffers, which is then made current with an atomic index swap. The buffer being written is two commits
+/// old, so only the changes of the last two commits are applied and nothing is copied.
+/// Readers register on the current buffer with an atomic counter and never lock or wait. A commit waits for readers
+/// that still hold the buffer it is about to write, which only happens if a snapshot is held for longer than a frame.
+class ParameterStore
+{
+public:
+	/// brief Shared pointer of ParameterStore object.
+	typedef std::shared_ptr<ParameterStore> SPtr;
+
+	/// @brief Retrieve or create the instance of the parameter store.
+	static SPtr & getInstance();
+
+	/// @brief Retrieve the current snapshot. Lock-free and safe to call from any thread.
+	/// @note Release the snapshot when done with it. Holding it for longer than a frame delays the next commit.
+	ParameterSnapshot::SPtr snapshot() const;
+
+	/// @brief Publish a new value for a node. It is visible to readers after the next commit().
+	/// @param node Node that changed.
+	/// @param value New value of the node.
+	void publish(const NodeBase * node, const QVariant & value);
+	/// @brief Publish new values for many nodes, e.g. when recalling a preset.
+	/// @param values Nodes that changed and their new values.
+	void publish(const QVector<QPair<const NodeBase *, QVariant>> & values);
+
+	/// @brief Remove a node from the store. Called when a node is destroyed.
+	void remove(const NodeBase * node);
+
+	/// @brief Make all values published since the last commit visible to readers as one snapshot. Call once per frame
+	/// and before telling other threads to read changed values.
+	/// @note Don't call this while holding a snapshot, it might wait for that snapshot to be released.
+	void commit();
+
+private:
+	ParameterStore();
+	ParameterStore(ParameterStore & ps);
+	ParameterStore & operator=(const ParameterStore & ps);
+
+	static std::mutex s_mutex;
+
+	//apply changes to a set of values. invalid values remove the node
+	static void applyChanges(QHash<const NodeBase *, QVariant> & values, const QHash<const NodeBase *, QVariant> & changes);
+
+	std::mutex m_writeMutex; //protects m_pending
+	std::mutex m_commitMutex; //serializes commits
+	QHash<const NodeBase *, QVariant> m_pending; //changes published since the last commit
+	QHash<const NodeBase *, QVariant> m_lastChanges; //changes of the last commit, not applied to the other buffer yet
+	ParameterSnapshot m_snapshots[2];
+	std::atomic<int> m_current; //index of the snapshot readers get
+	mutable std::atomic<int> m_readers[2]; //number of readers holding each snapshot
+};
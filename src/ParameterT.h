@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ParameterStore.h"
+
 #include <memory>
 #include <QtCore/QObject>
 #include <QtXml/QDomElement>
@@ -72,6 +74,12 @@ public:
 		return m_parameter->value();
 	}
 
+	/// @brief Read the value from a parameter snapshot instead of the node. Safe to call from any thread.
+	VALUETYPE value(const ParameterSnapshot & snapshot) const
+	{
+		return snapshot.value<VALUETYPE>(m_parameter.get());
+	}
+
 	template <bool R = RANGED>
 	typename std::enable_if<R, VALUETYPE>::type minRange() const
 	{
@@ -0,0 +1,88 @@
+#include "PowerLimiter.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+const float PowerLimiter::ReleaseTime = 0.5f;
+
+//scaling down is immediate, scaling up follows the target exponentially
+static float smoothScale(float current, float target, float release)
+{
+	return target < current ? target : current + (target - current) * release;
+}
+
+PowerLimiter::PowerLimiter()
+	: m_channelCurrent(20)
+	, m_totalLimit(0)
+	, m_segmentLimit(0)
+	, m_globalScale(1.0f)
+	, m_estimatedCurrent(0.0f)
+	, m_limitedCurrent(0.0f)
+{
+}
+
+void PowerLimiter::setCurrents(int channelCurrent, int totalLimit, int segmentLimit)
+{
+	m_channelCurrent = channelCurrent;
+	m_totalLimit = totalLimit;
+	m_segmentLimit = segmentLimit;
+}
+
+void PowerLimiter::update(const QVector<quint64> & segmentSums, const QVector<int> & segmentLEDs, float deltaTime)
+{
+	const int count = segmentSums.size();
+	if (m_segmentScales.size() != count)
+	{
+		//layout changed. start unscaled
+		m_segmentScales.fill(1.0f, count);
+		m_scales.fill(1.0f, count);
+	}
+	const float release = 1.0f - std::exp(-std::max(deltaTime, 0.0f) / ReleaseTime);
+	//only the current of the color channels can be scaled. the idle current is drawn anyway
+	float estimated = 0.0f;
+	float idle = 0.0f;
+	float variable = 0.0f;
+	for (int i = 0; i < count; ++i)
+	{
+		const float segmentVariable = segmentSums.at(i) / 65535.0f * m_channelCurrent;
+		const float segmentIdle = (float)segmentLEDs.at(i) * IdleCurrent;
+		estimated += segmentVariable + segmentIdle;
+		float target = 1.0f;
+		if (m_segmentLimit > 0 && segmentVariable > 0.0f && segmentVariable + segmentIdle > m_segmentLimit)
+		{
+			target = std::max(m_segmentLimit - segmentIdle, 0.0f) / segmentVariable;
+		}
+		m_segmentScales[i] = smoothScale(m_segmentScales.at(i), target, release);
+		variable += segmentVariable * m_segmentScales.at(i);
+		idle += segmentIdle;
+	}
+	//then limit what all segments draw together
+	float target = 1.0f;
+	if (m_totalLimit > 0 && variable > 0.0f && variable + idle > m_totalLimit)
+	{
+		target = std::max(m_totalLimit - idle, 0.0f) / variable;
+	}
+	m_globalScale = smoothScale(m_globalScale, target, release);
+	for (int i = 0; i < count; ++i)
+	{
+		m_scales[i] = m_segmentScales.at(i) * m_globalScale;
+	}
+	m_estimatedCurrent = estimated;
+	m_limitedCurrent = idle + variable * m_globalScale;
+}
+
+quint16 PowerLimiter::segmentScale(int segment) const
+{
+	return (quint16)(m_scales.at(segment) * 65535.0f + 0.5f);
+}
+
+float PowerLimiter::estimatedCurrent() const
+{
+	return m_estimatedCurrent;
+}
+
+float PowerLimiter::limitedCurrent() const
+{
+	return m_limitedCurrent;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QVector>
+
+
+/// @brief Estimates the current a frame draws from the LED supply and scales frames down that exceed the budget.
+/// The LEDs are split into segments of consecutive LEDs in the order they're sent, e.g. strips with their own
+/// power injection. Every segment has a budget and all segments together have a global budget.
+/// Scaling down happens immediately, so the supply is never overloaded. Scaling back up is smoothed, so a short
+/// bright flash doesn't make the display pump.
+class PowerLimiter
+{
+public:
+	/// @brief Current an LED draws when it is dark in mA.
+	static const int IdleCurrent = 1;
+	/// @brief Time in s for the scale to recover most of the way after the frames got darker.
+	static const float ReleaseTime;
+
+	PowerLimiter();
+
+	/// @brief Set up the current model and the budgets.
+	/// @param channelCurrent Current a color channel of an LED draws at full brightness in mA.
+	/// @param totalLimit Budget for all LEDs in mA. Pass 0 for no limit.
+	/// @param segmentLimit Budget for every segment in mA. Pass 0 for no limit.
+	void setCurrents(int channelCurrent, int totalLimit, int segmentLimit);
+
+	/// @brief Estimate the current of a frame and update the scale factors.
+	/// @param segmentSums Sum of all 16-bit channel values per segment.
+	/// @param segmentLEDs Number of LEDs per segment.
+	/// @param deltaTime Time since the last frame in s.
+	void update(const QVector<quint64> & segmentSums, const QVector<int> & segmentLEDs, float deltaTime);
+
+	/// @brief Retrieve the factor to scale the 16-bit values of a segment with, where 65535 means unscaled.
+	quint16 segmentScale(int segment) const;
+
+	/// @brief Retrieve the current the last frame would have drawn without limiting in mA.
+	float estimatedCurrent() const;
+	/// @brief Retrieve the current the last frame draws after limiting in mA.
+	float limitedCurrent() const;
+
+private:
+	int m_channelCurrent;
+	int m_totalLimit;
+	int m_segmentLimit;
+	QVector<float> m_segmentScales;
+	float m_globalScale;
+	QVector<float> m_scales;
+	float m_estimatedCurrent;
+	float m_limitedCurrent;
+};
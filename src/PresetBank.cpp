@@ -0,0 +1,311 @@
+#include "PresetBank.h"
+
+#include "MIDIClock.h"
+
+#include <QStringList>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+
+PresetBank::PresetBank(QObject * parent)
+	: QObject(parent)
+	, store("store", false)
+	, morphTime("morphTime", 0, 0, 30000)
+	, m_presets(PresetCount)
+	, m_morphing(false)
+	, m_morphStart(0)
+	, m_morphDuration(0)
+{
+	for (int i = 0; i < PresetCount; ++i)
+	{
+		triggers.append(ParameterBool(QString("preset%1").arg(i + 1), false));
+		connect(triggers[i].GetSharedParameter().get(), SIGNAL(changed(NodeBase *)), this, SLOT(triggerChanged(NodeBase *)));
+	}
+}
+
+void PresetBank::toXML(QDomElement & parent) const
+{
+	//try to find element in parent
+	QDomElement element = parent.firstChildElement("Presets");
+	if (element.isNull())
+	{
+		//add the new element
+		element = parent.ownerDocument().createElement("Presets");
+		parent.appendChild(element);
+	}
+	//remove old parameters and presets
+	QDomElement child = element.firstChildElement();
+	while (!child.isNull())
+	{
+		QDomElement next = child.nextSiblingElement();
+		if (child.tagName() == "PresetParameter" || child.tagName() == "Preset")
+		{
+			element.removeChild(child);
+		}
+		child = next;
+	}
+	morphTime.toXML(element);
+	//the parameter order is stored once and every preset is a list of values in that order
+	for (auto parameter : m_parameters)
+	{
+		QDomElement parameterElement = parent.ownerDocument().createElement("PresetParameter");
+		parameterElement.setAttribute("name", parameter.first->name());
+		parameterElement.setAttribute("parent", parameter.second);
+		element.appendChild(parameterElement);
+	}
+	for (int i = 0; i < m_presets.size(); ++i)
+	{
+		if (m_presets.at(i).isEmpty())
+		{
+			continue;
+		}
+		QStringList values;
+		foreach(float value, m_presets.at(i))
+		{
+			values.append(std::isnan(value) ? QString("-") : QString::number(value));
+		}
+		QDomElement presetElement = parent.ownerDocument().createElement("Preset");
+		presetElement.setAttribute("index", i);
+		presetElement.appendChild(parent.ownerDocument().createTextNode(values.join(' ')));
+		element.appendChild(presetElement);
+	}
+}
+
+PresetBank & PresetBank::fromXML(const QDomElement & parent)
+{
+	//try to find element in document
+	QDomElement element = parent.firstChildElement("Presets");
+	if (element.isNull())
+	{
+		throw std::runtime_error("No presets found!");
+	}
+	m_morphing = false;
+	morphTime.fromXML(element);
+	//map the stored parameter order to the registered parameters. -1 for parameters that are not registered
+	QVector<int> indices;
+	for (QDomElement child = element.firstChildElement("PresetParameter"); !child.isNull(); child = child.nextSiblingElement("PresetParameter"))
+	{
+		int index = -1;
+		for (int i = 0; i < m_parameters.size(); ++i)
+		{
+			if (m_parameters.at(i).first->name() == child.attribute("name") && m_parameters.at(i).second == child.attribute("parent"))
+			{
+				index = i;
+				break;
+			}
+		}
+		indices.append(index);
+	}
+	m_presets.fill(QVector<float>(), PresetCount);
+	for (QDomElement child = element.firstChildElement("Preset"); !child.isNull(); child = child.nextSiblingElement("Preset"))
+	{
+		const int presetIndex = child.attribute("index", "-1").toInt();
+		if (presetIndex < 0 || presetIndex >= PresetCount)
+		{
+			continue;
+		}
+		//parameters missing from the stored preset are left unchanged when recalling it
+		QVector<float> & preset = m_presets[presetIndex];
+		preset.fill(std::numeric_limits<float>::quiet_NaN(), m_parameters.size());
+		const QStringList values = child.text().split(' ', QString::SkipEmptyParts);
+		for (int i = 0; i < values.size() && i < indices.size(); ++i)
+		{
+			bool ok = false;
+			const float value = values.at(i).toFloat(&ok);
+			if (ok && indices.at(i) >= 0)
+			{
+				preset[indices.at(i)] = std::max(0.0f, std::min(1.0f, value));
+			}
+		}
+	}
+	return *this;
+}
+
+void PresetBank::setParameters(const QVector<QPair<NodeRanged::SPtr, QString>> & parameters)
+{
+	m_morphing = false;
+	m_parameters.clear();
+	m_nodes.clear();
+	m_stepped.clear();
+	for (auto parameter : parameters)
+	{
+		//the bank's own controls would recall or store presets when recalling a preset
+		bool isControl = parameter.first == store.GetSharedParameter() || parameter.first == morphTime.GetSharedParameter();
+		for (int i = 0; i < triggers.size(); ++i)
+		{
+			isControl = isControl || parameter.first == triggers[i].GetSharedParameter();
+		}
+		if (!isControl)
+		{
+			m_parameters.append(parameter);
+			m_nodes.append(parameter.first);
+			m_stepped.append(parameter.first->valueType() == NodeRanged::Bool);
+		}
+	}
+	//stored presets don't match the parameters anymore
+	m_presets.fill(QVector<float>(), PresetCount);
+}
+
+bool PresetBank::hasPreset(int index) const
+{
+	return index >= 0 && index < m_presets.size() && !m_presets.at(index).isEmpty();
+}
+
+QVector<float> PresetBank::currentValues() const
+{
+	QVector<float> values(m_nodes.size());
+	for (int i = 0; i < m_nodes.size(); ++i)
+	{
+		values[i] = (float)m_nodes.at(i)->normalizedValue();
+	}
+	return values;
+}
+
+void PresetBank::capture(int index)
+{
+	if (index < 0 || index >= m_presets.size())
+	{
+		return;
+	}
+	m_presets[index] = currentValues();
+	emit presetStored(index);
+}
+
+void PresetBank::recall(int index, int64_t timestamp)
+{
+	if (!hasPreset(index))
+	{
+		return;
+	}
+	//morph from the current state, which is not a preset
+	m_morphing = false;
+	const int duration = morphTime;
+	if (duration > 0)
+	{
+		m_morphFrom = currentValues();
+		m_morphTo = m_presets.at(index);
+		m_morphStart = timestamp;
+		m_morphDuration = (int64_t)duration * 1000000;
+		m_morphing = true;
+	}
+	else
+	{
+		NodeRanged::setNormalizedValues(m_nodes, m_presets.at(index));
+	}
+	emit presetRecalled(index);
+}
+
+void PresetBank::morph(int from, int to, int duration, int64_t timestamp)
+{
+	if (!hasPreset(from) || !hasPreset(to))
+	{
+		return;
+	}
+	m_morphing = false;
+	if (duration > 0)
+	{
+		//parameters the start preset does not contain start where they are now
+		m_morphFrom = m_presets.at(from);
+		for (int i = 0; i < m_morphFrom.size(); ++i)
+		{
+			if (std::isnan(m_morphFrom.at(i)))
+			{
+				m_morphFrom[i] = (float)m_nodes.at(i)->normalizedValue();
+			}
+		}
+		m_morphTo = m_presets.at(to);
+		m_morphStart = timestamp;
+		m_morphDuration = (int64_t)duration * 1000000;
+		m_morphing = true;
+		//start at the first preset in this frame already
+		NodeRanged::setNormalizedValues(m_nodes, m_morphFrom);
+	}
+	else
+	{
+		NodeRanged::setNormalizedValues(m_nodes, m_presets.at(to));
+	}
+	emit presetRecalled(to);
+}
+
+void PresetBank::update(int64_t timestamp)
+{
+	if (!m_morphing)
+	{
+		return;
+	}
+	const double t = std::max(0.0, std::min(1.0, (double)(timestamp - m_morphStart) / (double)m_morphDuration));
+	//interpolate all values in one pass, then apply them as one snapshot
+	m_morphValues.resize(m_morphTo.size());
+	for (int i = 0; i < m_morphTo.size(); ++i)
+	{
+		const float from = m_morphFrom.at(i);
+		const float to = m_morphTo.at(i);
+		if (std::isnan(to))
+		{
+			m_morphValues[i] = to;
+		}
+		else if (m_stepped.at(i))
+		{
+			m_morphValues[i] = t < 0.5 ? from : to;
+		}
+		else
+		{
+			m_morphValues[i] = from + (float)t * (to - from);
+		}
+	}
+	NodeRanged::setNormalizedValues(m_nodes, m_morphValues);
+	if (t >= 1.0)
+	{
+		m_morphing = false;
+	}
+}
+
+bool PresetBank::isMorphing() const
+{
+	return m_morphing;
+}
+
+void PresetBank::select(int index)
+{
+	if (store)
+	{
+		capture(index);
+		store = false;
+	}
+	else
+	{
+		recall(index, MIDIClock::now());
+	}
+}
+
+void PresetBank::triggerChanged(NodeBase * trigger)
+{
+	for (int i = 0; i < triggers.size(); ++i)
+	{
+		//only the note on selects the preset, the note off is ignored
+		if (triggers[i].GetSharedParameter().get() == trigger && triggers[i])
+		{
+			//pressing a preset while another one is held morphs from the held preset to the pressed one
+			int held = -1;
+			for (int j = 0; j < triggers.size(); ++j)
+			{
+				if (j != i && triggers[j])
+				{
+					held = j;
+					break;
+				}
+			}
+			if (held >= 0 && !store && hasPreset(held))
+			{
+				morph(held, i, morphTime, MIDIClock::now());
+			}
+			else
+			{
+				select(i);
+			}
+			return;
+		}
+	}
+}
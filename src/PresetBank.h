@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <QDomElement>
+#include <cstdint>
+
+#include "Parameters.h"
+
+
+/// @brief Stores snapshots of a set of parameters as presets, recalls them and morphs between them.
+/// A preset is a flat array of normalized values, one per parameter in the order passed to setParameters().
+/// Recalling assigns all values in one pass and publishes them as a single parameter snapshot, so a preset is
+/// complete within the frame it is recalled in. Morphing interpolates between two presets once per frame.
+/// Boolean parameters are not interpolated, but switch halfway through the morph.
+/// Every preset has a trigger parameter, so presets can be recalled from MIDI notes. Pressing a trigger while another
+/// one is held morphs from the held preset to the pressed one. While store is on, a trigger stores the current state
+/// to its preset instead.
+class PresetBank : public QObject
+{
+	Q_OBJECT
+
+public:
+	static const int PresetCount = 8;
+
+	PresetBank(QObject * parent = NULL);
+
+	/// @brief Save the presets to an XML document.
+	/// @param parent The parent to append the presets to.
+	void toXML(QDomElement & parent) const;
+	/// @brief Read the presets from an XML document. Values of parameters that are not registered are ignored.
+	/// @param parent The parent element to load the presets from.
+	/// @note this will throw std::runtime_error if no presets are found in the document.
+	PresetBank & fromXML(const QDomElement & parent);
+
+	/// @brief Set the parameters stored in presets. Call before storing or loading presets.
+	/// The trigger, store and morph time parameters of the bank are never part of a preset.
+	/// @param parameters Parameters and the names of their parents, which identify the parameters in XML.
+	void setParameters(const QVector<QPair<NodeRanged::SPtr, QString>> & parameters);
+
+	/// @brief Check if a preset has been stored.
+	bool hasPreset(int index) const;
+
+	/// @brief Store the current parameter values to a preset.
+	void capture(int index);
+	/// @brief Recall a preset. Morphs from the current state over morphTime, or sets it immediately if morphTime is 0.
+	/// @param timestamp Current time in nanoseconds on the steady clock.
+	void recall(int index, int64_t timestamp);
+	/// @brief Morph from one preset to another.
+	/// @param from Preset to start at. Parameters it does not contain start at their current value.
+	/// @param to Preset to end at.
+	/// @param duration Duration of the morph in ms. 0 sets the target preset immediately.
+	/// @param timestamp Start time in nanoseconds on the steady clock.
+	void morph(int from, int to, int duration, int64_t timestamp);
+
+	/// @brief Apply the morphed parameter values for a point in time. Call once per frame before propagating parameters.
+	/// @param timestamp Frame time in nanoseconds on the same clock passed to recall() or morph().
+	void update(int64_t timestamp);
+
+	/// @brief Check if a morph is running.
+	bool isMorphing() const;
+
+	/// @brief Triggers to recall presets, e.g. from MIDI notes.
+	QVector<ParameterBool> triggers;
+	/// @brief If true the next trigger stores the current state to its preset and store turns off again.
+	ParameterBool store;
+	/// @brief Time to morph to a recalled preset in ms.
+	ParameterInt morphTime;
+
+public slots:
+	/// @brief Store the current state to a preset if store is on, else recall the preset.
+	void select(int index);
+
+signals:
+	/// @brief Emitted when a preset has been stored.
+	void presetStored(int index);
+	/// @brief Emitted when a preset is recalled or a morph to it starts.
+	void presetRecalled(int index);
+
+private slots:
+	void triggerChanged(NodeBase * trigger);
+
+private:
+	/// @brief Retrieve the current normalized values of all parameters.
+	QVector<float> currentValues() const;
+
+	QVector<QPair<NodeRanged::SPtr, QString>> m_parameters;
+	QVector<NodeRanged::SPtr> m_nodes;
+	QVector<bool> m_stepped;
+	//normalized values per preset. empty if the preset has not been stored. NaN for parameters the preset does not contain
+	QVector<QVector<float>> m_presets;
+	//morph state
+	bool m_morphing;
+	int64_t m_morphStart; //start of the morph in ns
+	int64_t m_morphDuration; //duration of the morph in ns
+	QVector<float> m_morphFrom;
+	QVector<float> m_morphTo;
+	QVector<float> m_morphValues;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <algorithm>
+
+
+/// @brief Fixed-size lock-free ring buffer for exactly one producer thread and one consumer thread.
+/// push() and pop() never allocate or block, so the producer can be a real-time callback.
+/// @tparam T Element type. Should be cheap to copy.
+/// @tparam CAPACITY Number of elements. Must be a power of two.
+template<typename T, size_t CAPACITY>
+class SPSCRing
+{
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SPSCRing capacity must be a power of two!");
+
+public:
+	SPSCRing()
+		: m_head(0)
+		, m_tail(0)
+	{
+	}
+
+	/// @brief Add an element. Call from the producer thread only.
+	/// @return False if the ring is full and the element was dropped.
+	bool push(const T & element)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) >= CAPACITY)
+		{
+			return false;
+		}
+		m_elements[head & (CAPACITY - 1)] = element;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// @brief Remove the oldest element. Call from the consumer thread only.
+	/// @return False if the ring is empty.
+	bool pop(T & element)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		element = m_elements[tail & (CAPACITY - 1)];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// @brief Add several elements at once. Call from the producer thread only.
+	/// @return Number of elements added. Less than count if the ring is full.
+	size_t push(const T * elements, size_t count)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		count = std::min(count, CAPACITY - (head - m_tail.load(std::memory_order_acquire)));
+		//copy up to the end of the storage, then wrap around to its start
+		const size_t start = head & (CAPACITY - 1);
+		const size_t first = std::min(count, CAPACITY - start);
+		std::copy(elements, elements + first, m_elements + start);
+		std::copy(elements + first, elements + count, m_elements);
+		m_head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+	/// @brief Remove several of the oldest elements at once. Call from the consumer thread only.
+	/// @return Number of elements removed. Less than count if the ring holds less.
+	size_t pop(T * elements, size_t count)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		count = std::min(count, m_head.load(std::memory_order_acquire) - tail);
+		const size_t start = tail & (CAPACITY - 1);
+		const size_t first = std::min(count, CAPACITY - start);
+		std::copy(m_elements + start, m_elements + start + first, elements);
+		std::copy(m_elements, m_elements + (count - first), elements + first);
+		m_tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+
+	/// @brief Retrieve the number of elements currently stored. Only a snapshot if the other thread is active.
+	size_t size() const
+	{
+		return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+	}
+
+	size_t capacity() const
+	{
+		return CAPACITY;
+	}
+
+private:
+	T m_elements[CAPACITY];
+	//keep producer and consumer indices on separate cache lines
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+};
@@ -0,0 +1,21 @@
+#include "ScriptList.h"
+
+#include <QDirIterator>
+
+
+QStringList buildScriptList(const QString & path)
+{
+	QStringList list;
+	QDirIterator it(path, QStringList() << "*.fs", QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext()) {
+		if (it.fileInfo().isDir())
+		{
+			list.append(buildScriptList(it.path()));
+		}
+		else
+		{
+			list << it.next();
+		}
+	}
+	return list;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+
+/// @brief Find all effect scripts, e.g. "*.fs" files, in a directory and its sub-directories.
+/// @param path Directory to search.
+/// @return Paths of the scripts found, relative to path if path is relative.
+QStringList buildScriptList(const QString & path);
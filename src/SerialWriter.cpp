@@ -0,0 +1,327 @@
+#include "SerialWriter.h"
+#include "DisplayThread.h"
+#include "ImageOperations.h"
+
+#include <QTime>
+#include <algorithm>
+
+
+SerialWriter::SerialWriter(DisplayThread & display, QObject * parent)
+	: QObject(parent)
+	, m_display(display)
+	, m_serial(new QSerialPort(this))
+	, m_currentBaudrate(0)
+	, m_capabilities(0)
+	, m_hasPending(false)
+	, m_waitTimeout(100)
+	, m_framesInFlight(0)
+	, m_framesProduced(0)
+	, m_framesSent(0)
+	, m_framesDropped(0)
+	, m_currentSum(0.0f)
+	, m_currentPeak(0.0f)
+	, m_limitedCurrentSum(0.0f)
+	, m_currentFrames(0)
+{
+	m_timeoutTimer.setSingleShot(true);
+	m_transmitTimer.setSingleShot(true);
+	connect(m_serial, SIGNAL(bytesWritten(qint64)), this, SLOT(dataWritten(qint64)));
+	connect(m_serial, SIGNAL(readyRead()), this, SLOT(dataReceived()));
+	connect(&m_timeoutTimer, SIGNAL(timeout()), this, SLOT(writeTimedOut()));
+	connect(&m_transmitTimer, SIGNAL(timeout()), this, SLOT(sendPending()));
+	connect(&m_statisticsTimer, SIGNAL(timeout()), this, SLOT(reportStatistics()));
+	m_statisticsTimer.start(1000);
+	//open the port from the settings
+	const ParameterSnapshot::SPtr parameters = ParameterStore::getInstance()->snapshot();
+	m_currentBaudrate = m_display.baudrate.value(*parameters);
+	openPort(m_display.portName.value(*parameters));
+}
+
+void SerialWriter::openPort(const QString & name)
+{
+	//close old port down
+	m_serial->close();
+	m_display.sending = false;
+	m_timeoutTimer.stop();
+	m_transmitTimer.stop();
+	//a new device has to announce its capabilities again
+	m_capabilities = 0;
+	m_received.clear();
+	m_encoder.reset();
+	m_framesInFlight = 0;
+	m_hasPending = false;
+	m_pendingImage = Image16();
+	m_currentPortName = name;
+	//check if a proper port name was passed
+	if (!name.isEmpty())
+	{
+		m_serial->setPortName(name);
+		//try opening
+		if (!m_serial->open(QIODevice::ReadWrite))
+		{
+			emit error(tr("Can't open %1, error code %2").arg(name).arg(m_serial->error()));
+			emit portOpened(false);
+		}
+		else
+		{
+			//set up serial port
+			m_serial->setBaudRate(m_currentBaudrate);
+			m_serial->setDataBits(QSerialPort::Data8);
+			m_serial->setParity(QSerialPort::NoParity);
+			m_serial->setStopBits(QSerialPort::OneStop);
+			m_serial->setFlowControl(QSerialPort::NoFlowControl);
+			m_serial->setBreakEnabled(false);
+			emit portOpened(true);
+		}
+	}
+}
+
+void SerialWriter::updateSettings()
+{
+	const ParameterSnapshot::SPtr parameters = ParameterStore::getInstance()->snapshot();
+	const int newBaudrate = m_display.baudrate.value(*parameters);
+	if (m_currentBaudrate != newBaudrate)
+	{
+		m_currentBaudrate = newBaudrate;
+		if (m_serial->isOpen())
+		{
+			m_serial->setBaudRate(m_currentBaudrate);
+		}
+	}
+	const QString newPortName = m_display.portName.value(*parameters);
+	if (m_currentPortName != newPortName)
+	{
+		openPort(newPortName);
+	}
+	//a frame queued before sending was stopped must not be sent when it is started again
+	if (!m_display.sending.value(*parameters))
+	{
+		m_hasPending = false;
+		m_pendingImage = Image16();
+	}
+}
+
+void SerialWriter::submitImage(const Image16 & image, int waitTimeout)
+{
+	const ParameterSnapshot::SPtr parameters = ParameterStore::getInstance()->snapshot();
+	if (!m_display.sending.value(*parameters) || !m_serial->isOpen() || !m_serial->isWritable())
+	{
+		return;
+	}
+	m_waitTimeout = waitTimeout;
+	m_framesProduced++;
+	//the device is still busy with an older frame. replace the frame that is waiting, as it is stale now
+	if (m_hasPending)
+	{
+		m_framesDropped++;
+	}
+	m_pendingImage = image;
+	m_hasPending = true;
+	sendPending();
+}
+
+void SerialWriter::sendPending()
+{
+	if (!m_hasPending || !m_serial->isOpen())
+	{
+		return;
+	}
+	//wait until the last frame has left the port and the device is ready to receive another one
+	if (m_serial->bytesToWrite() > 0 || m_transmitTimer.isActive())
+	{
+		return;
+	}
+	if ((m_capabilities & LEDStreamEncoder::Acknowledge) && m_framesInFlight >= MaximumFramesInFlight)
+	{
+		return;
+	}
+	const ParameterSnapshot::SPtr parameters = ParameterStore::getInstance()->snapshot();
+	const bool extended = m_display.extendedProtocol.value(*parameters);
+	const bool reduced = m_display.reducedColor.value(*parameters);
+	const QByteArray data = convertImage(m_pendingImage);
+	m_pendingImage = Image16();
+	m_hasPending = false;
+	if (data.isEmpty())
+	{
+		return;
+	}
+	//send only changes if the device supports it, else all LEDs
+	QByteArray frame;
+	if (extended && (m_capabilities & LEDStreamEncoder::DeltaCoding))
+	{
+		frame = m_encoder.encode(data, reduced && (m_capabilities & LEDStreamEncoder::ReducedColor));
+	}
+	else
+	{
+		frame = LEDStreamEncoder::encodeAdalight(data);
+	}
+	m_serial->write(frame);
+	m_framesSent++;
+	//a byte takes 10 bits on the wire with 8N1. don't hand out the next frame before this one could have been transmitted,
+	//else frames would pile up in the operating system's buffers instead of being dropped here
+	const int transmitTime = (int)((qint64)frame.size() * 10 * 1000 / std::max(m_currentBaudrate, 1));
+	m_transmitTimer.start(transmitTime);
+	if (m_capabilities & LEDStreamEncoder::Acknowledge)
+	{
+		m_framesInFlight++;
+	}
+	m_timeoutTimer.start(transmitTime + m_waitTimeout);
+}
+
+void SerialWriter::dataWritten(qint64 /*bytes*/)
+{
+	if (m_serial->bytesToWrite() == 0)
+	{
+		//without acknowledgements the frame is done when it has been written
+		if (!(m_capabilities & LEDStreamEncoder::Acknowledge))
+		{
+			m_timeoutTimer.stop();
+		}
+		sendPending();
+	}
+}
+
+void SerialWriter::dataReceived()
+{
+	//the device announces capabilities, requests key frames and acknowledges frames it has shown
+	m_received.append(m_serial->readAll());
+	int acknowledged = 0;
+	m_encoder.parseDeviceMessages(m_received, m_capabilities, acknowledged);
+	if (acknowledged > 0)
+	{
+		m_framesInFlight = std::max(m_framesInFlight - acknowledged, 0);
+		if (m_framesInFlight == 0)
+		{
+			m_timeoutTimer.stop();
+		}
+		sendPending();
+	}
+}
+
+void SerialWriter::writeTimedOut()
+{
+	//the frame may have been sent partially or the device may have missed it, so the device state is unknown
+	m_serial->clear(QSerialPort::Output);
+	m_encoder.reset();
+	m_framesInFlight = 0;
+	m_transmitTimer.stop();
+	emit timeout(tr("Wait write request timeout %1").arg(QTime::currentTime().toString()));
+	sendPending();
+}
+
+void SerialWriter::reportStatistics()
+{
+	if (m_framesProduced > 0 || m_framesSent > 0)
+	{
+		QString message = tr("Frames/s produced %1, sent %2, dropped %3").arg(m_framesProduced).arg(m_framesSent).arg(m_framesDropped);
+		if (m_currentFrames > 0)
+		{
+			message += tr(". Current %1A (peak %2A), limited to %3A").arg(m_currentSum / m_currentFrames / 1000.0f, 0, 'f', 2).arg(m_currentPeak / 1000.0f, 0, 'f', 2).arg(m_limitedCurrentSum / m_currentFrames / 1000.0f, 0, 'f', 2);
+		}
+		emit response(message);
+	}
+	m_framesProduced = 0;
+	m_framesSent = 0;
+	m_framesDropped = 0;
+	m_currentSum = 0.0f;
+	m_currentPeak = 0.0f;
+	m_limitedCurrentSum = 0.0f;
+	m_currentFrames = 0;
+}
+
+QByteArray SerialWriter::convertImage(const Image16 & image)
+{
+	const ParameterSnapshot::SPtr parameters = ParameterStore::getInstance()->snapshot();
+	const int width = m_display.displayWidth.value(*parameters);
+	const int height = m_display.displayHeight.value(*parameters);
+	const bool horizontal = m_display.flipHorizontal.value(*parameters);
+	const bool vertical = m_display.flipVertical.value(*parameters);
+	const ScanlineDirection direction = m_display.scanlineDirection.value(*parameters);
+	const bool dither = m_display.dithering.value(*parameters);
+	const int segments = std::min(m_display.powerSegments.value(*parameters), width * height);
+	QByteArray data;
+	//check if we have data and display setup is ok
+	if (image.isNull() || width <= 0 || height <= 0)
+	{
+		return data;
+	}
+	//convert image to proper size
+	Image16 dataImage = image.scaled(width, height);
+	//flip image according to settings
+	if (horizontal || vertical)
+	{
+		dataImage = dataImage.mirrored(horizontal, vertical);
+	}
+	//collect 16-bit colors in the order G, R, B the LEDs expect and sum them up per power segment
+	const int ledCount = dataImage.width() * dataImage.height();
+	QVector<quint16> colors;
+	colors.reserve(ledCount * 3);
+	QVector<quint64> segmentSums(segments, 0);
+	QVector<int> segmentLEDs(segments, 0);
+	//convert image for diplay. get initial scan line direction
+	int stepDirection = ((direction == ConstantRightToLeft) || (direction == AlternatingStartRight)) ? 4 : -4;
+	for (int y = 0; y < dataImage.height(); ++y)
+	{
+		const quint16 * scanLine = dataImage.constScanLine(y);
+		//loop through pixels left-right
+		if (stepDirection > 0)
+		{
+			for (int x = 0; x < dataImage.width() * 4; x += 4)
+			{
+				const int segment = (colors.size() / 3) * segments / ledCount;
+				segmentSums[segment] += scanLine[x] + scanLine[x + 1] + scanLine[x + 2];
+				segmentLEDs[segment]++;
+				colors.append(scanLine[x + 1]);
+				colors.append(scanLine[x]);
+				colors.append(scanLine[x + 2]);
+			}
+		}
+		else
+		{
+			for (int x = (dataImage.width() - 1) * 4; x >= 0; x -= 4)
+			{
+				const int segment = (colors.size() / 3) * segments / ledCount;
+				segmentSums[segment] += scanLine[x] + scanLine[x + 1] + scanLine[x + 2];
+				segmentLEDs[segment]++;
+				colors.append(scanLine[x + 1]);
+				colors.append(scanLine[x]);
+				colors.append(scanLine[x + 2]);
+			}
+		}
+		//if we have alternating lines, flip direction after every line
+		if ((direction == AlternatingStartLeft) || (direction == AlternatingStartRight))
+		{
+			stepDirection = -stepDirection;
+		}
+	}
+	//reduce to 8 bits as the very last step. start over when the LED layout changes
+	if (m_ditherResidual.size() != colors.size())
+	{
+		m_ditherResidual.fill(0x80, colors.size());
+	}
+	//estimate the current the frame draws and scale segments that exceed their budget
+	float deltaTime = 0.0f;
+	if (m_frameTimer.isValid())
+	{
+		deltaTime = m_frameTimer.restart() / 1000.0f;
+	}
+	else
+	{
+		m_frameTimer.start();
+	}
+	m_powerLimiter.setCurrents(m_display.ledCurrent.value(*parameters), m_display.powerLimit.value(*parameters), m_display.segmentPowerLimit.value(*parameters));
+	m_powerLimiter.update(segmentSums, segmentLEDs, deltaTime);
+	m_currentSum += m_powerLimiter.estimatedCurrent();
+	m_currentPeak = std::max(m_currentPeak, m_powerLimiter.estimatedCurrent());
+	m_limitedCurrentSum += m_powerLimiter.limitedCurrent();
+	m_currentFrames++;
+	data.resize(colors.size());
+	int start = 0;
+	for (int segment = 0; segment < segments; ++segment)
+	{
+		const int count = segmentLEDs.at(segment) * 3;
+		ditherTo8Bit(colors.constData() + start, dither ? m_ditherResidual.data() + start : nullptr, (unsigned char *)data.data() + start, count, m_powerLimiter.segmentScale(segment));
+		start += count;
+	}
+	return data;
+}
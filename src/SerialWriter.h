@@ -0,0 +1,89 @@
+#pragma once
+
+#include "LEDStream.h"
+#include "Image16.h"
+#include "PowerLimiter.h"
+
+#include <QObject>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QtSerialPort/QSerialPort>
+
+class DisplayThread;
+
+
+/// @brief Event-driven writer sending LED frames to the serial port. Lives in the display thread.
+/// Only the newest frame is kept. A new frame is written when the previous one has left the port and, if the device
+/// acknowledges frames, when the device has shown enough frames. Frames replaced before they could be sent are dropped.
+class SerialWriter : public QObject
+{
+	Q_OBJECT
+
+public:
+	/// @brief Maximum number of frames sent but not acknowledged by the device yet.
+	/// Two frames let the device receive the next frame while it is showing the current one.
+	static const int MaximumFramesInFlight = 2;
+
+	/// @brief Constructor.
+	/// @param display Display thread the settings are read from.
+	SerialWriter(DisplayThread & display, QObject * parent = 0);
+
+signals:
+	void portOpened(bool portOpen);
+	void response(const QString &s);
+	void error(const QString &s);
+	void timeout(const QString &s);
+
+public slots:
+	/// @brief Queue an image for sending, replacing an image that was not sent yet.
+	/// @param image Image to send.
+	/// @param waitTimeout Time in ms the device may take to receive and show a frame before the frame is considered lost.
+	void submitImage(const Image16 & image, int waitTimeout);
+	/// @brief Re-read port name, baud rate and sending state from the parameters and re-open the port if needed.
+	void updateSettings();
+
+private slots:
+	void sendPending();
+	void dataWritten(qint64 bytes);
+	void dataReceived();
+	void writeTimedOut();
+	void reportStatistics();
+
+private:
+	/// @brief Close the current port and open the port with the name passed, if it is not empty.
+	void openPort(const QString & name);
+	/// @brief Convert an image to the LED size, orientation and scan line order, reduce it to 8 bits and return the
+	/// colors in device order.
+	QByteArray convertImage(const Image16 & image);
+
+	DisplayThread & m_display;
+	QSerialPort * m_serial;
+	QString m_currentPortName;
+	int m_currentBaudrate;
+	//state of the extended protocol. capabilities are announced by the device after the port is opened
+	LEDStreamEncoder m_encoder;
+	QByteArray m_received;
+	int m_capabilities;
+	//newest frame not sent yet
+	Image16 m_pendingImage;
+	bool m_hasPending;
+	int m_waitTimeout;
+	int m_framesInFlight;
+	QTimer m_timeoutTimer;
+	QTimer m_transmitTimer; //runs while the last frame is on the wire
+	QTimer m_statisticsTimer;
+	//frame counts since the last report
+	int m_framesProduced;
+	int m_framesSent;
+	int m_framesDropped;
+	//error carried over to the next frame when dithering
+	QVector<quint16> m_ditherResidual;
+	//current estimation and limiting
+	PowerLimiter m_powerLimiter;
+	QElapsedTimer m_frameTimer;
+	float m_currentSum;
+	float m_currentPeak;
+	float m_limitedCurrentSum;
+	int m_currentFrames;
+};
@@ -0,0 +1,244 @@
+#include "ShowFile.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+#include <stdexcept>
+
+
+const quint32 ShowFile::Magic;
+const quint32 ShowFile::Version;
+const quint32 ShowFile::None;
+
+//sizes of the file structures in 32-bit values
+static const int HeaderSize = 6;
+static const int StringSize = 2;
+static const int ElementSize = 5;
+static const int AttributeSize = 2;
+
+//collects the tables of a show file while walking a document
+class ShowFileWriter
+{
+public:
+	quint32 addString(const QString & string)
+	{
+		QHash<QString, quint32>::const_iterator it = m_stringIndices.constFind(string);
+		if (it != m_stringIndices.constEnd())
+		{
+			return it.value();
+		}
+		const QByteArray utf8 = string.toUtf8();
+		const quint32 index = m_stringIndices.size();
+		m_stringIndices.insert(string, index);
+		m_strings << (quint32)m_stringData.size() << (quint32)utf8.size();
+		m_stringData.append(utf8);
+		return index;
+	}
+
+	void addElement(const QDomElement & element, quint32 parent)
+	{
+		//text directly inside the element
+		QString text;
+		bool hasText = false;
+		for (QDomNode child = element.firstChild(); !child.isNull(); child = child.nextSibling())
+		{
+			if (child.isText())
+			{
+				text += child.toText().data();
+				hasText = true;
+			}
+		}
+		const quint32 index = m_elements.size() / ElementSize;
+		const QDomNamedNodeMap attributes = element.attributes();
+		m_elements << addString(element.tagName()) << parent << (quint32)(m_attributes.size() / AttributeSize) << (quint32)attributes.count() << (hasText ? addString(text) : ShowFile::None);
+		for (int i = 0; i < attributes.count(); ++i)
+		{
+			const QDomAttr attribute = attributes.item(i).toAttr();
+			m_attributes << addString(attribute.name()) << addString(attribute.value());
+		}
+		//children follow their parent, so a reader can always append to an existing element
+		for (QDomElement child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement())
+		{
+			addElement(child, index);
+		}
+	}
+
+	QByteArray data() const
+	{
+		QVector<quint32> values;
+		values << ShowFile::Magic << ShowFile::Version << (quint32)m_stringIndices.size() << (quint32)(m_elements.size() / ElementSize) << (quint32)(m_attributes.size() / AttributeSize) << (quint32)m_stringData.size();
+		values << m_strings << m_elements << m_attributes;
+		QByteArray result(values.size() * 4, 0);
+		for (int i = 0; i < values.size(); ++i)
+		{
+			qToLittleEndian(values.at(i), (uchar *)result.data() + i * 4);
+		}
+		result.append(m_stringData);
+		return result;
+	}
+
+private:
+	QHash<QString, quint32> m_stringIndices;
+	QVector<quint32> m_strings;
+	QVector<quint32> m_elements;
+	QVector<quint32> m_attributes;
+	QByteArray m_stringData;
+};
+
+bool ShowFile::isShowFile(const QString & fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	const QByteArray magic = file.read(4);
+	return magic.size() == 4 && qFromLittleEndian<quint32>((const uchar *)magic.constData()) == Magic;
+}
+
+QDomDocument ShowFile::read(const QString & fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		throw std::runtime_error(("Failed to open \"" + fileName + "\"").toStdString());
+	}
+	//map the file, so it is not copied into memory once more. the complete document is rebuilt from it below
+	const qint64 size = file.size();
+	const uchar * data = file.map(0, size);
+	if (!data || size < HeaderSize * 4)
+	{
+		throw std::runtime_error(("Failed to read \"" + fileName + "\"").toStdString());
+	}
+	const quint32 * header = (const quint32 *)data;
+	if (qFromLittleEndian(header[0]) != Magic)
+	{
+		throw std::runtime_error(("\"" + fileName + "\" is not a show file").toStdString());
+	}
+	if (qFromLittleEndian(header[1]) != Version)
+	{
+		throw std::runtime_error(("\"" + fileName + "\" has an unsupported show file version").toStdString());
+	}
+	const quint32 stringCount = qFromLittleEndian(header[2]);
+	const quint32 elementCount = qFromLittleEndian(header[3]);
+	const quint32 attributeCount = qFromLittleEndian(header[4]);
+	const quint32 stringDataSize = qFromLittleEndian(header[5]);
+	const quint32 * strings = header + HeaderSize;
+	const quint32 * elements = strings + stringCount * StringSize;
+	const quint32 * attributes = elements + elementCount * ElementSize;
+	const char * stringData = (const char *)(attributes + attributeCount * AttributeSize);
+	if ((qint64)HeaderSize * 4 + ((qint64)stringCount * StringSize + (qint64)elementCount * ElementSize + (qint64)attributeCount * AttributeSize) * 4 + stringDataSize != size)
+	{
+		throw std::runtime_error(("\"" + fileName + "\" is truncated or corrupt").toStdString());
+	}
+	//strings are decoded once when first used. element and attribute names repeat a lot
+	QVector<QString> decoded(stringCount);
+	QVector<bool> isDecoded(stringCount, false);
+	auto string = [&](quint32 index) -> const QString & {
+		if (index >= stringCount)
+		{
+			throw std::runtime_error(("\"" + fileName + "\" references an invalid string").toStdString());
+		}
+		if (!isDecoded.at(index))
+		{
+			const quint32 offset = qFromLittleEndian(strings[index * StringSize]);
+			const quint32 length = qFromLittleEndian(strings[index * StringSize + 1]);
+			if ((quint64)offset + length > stringDataSize)
+			{
+				throw std::runtime_error(("\"" + fileName + "\" references an invalid string").toStdString());
+			}
+			decoded[index] = QString::fromUtf8(stringData + offset, length);
+			isDecoded[index] = true;
+		}
+		return decoded.at(index);
+	};
+	//rebuild the document
+	QDomDocument document("NerDisco");
+	QVector<QDomElement> created(elementCount);
+	for (quint32 i = 0; i < elementCount; ++i)
+	{
+		const quint32 * element = elements + i * ElementSize;
+		const quint32 parent = qFromLittleEndian(element[1]);
+		const quint32 firstAttribute = qFromLittleEndian(element[2]);
+		const quint32 count = qFromLittleEndian(element[3]);
+		const quint32 text = qFromLittleEndian(element[4]);
+		if ((parent != None && parent >= i) || (parent == None && i != 0) || (quint64)firstAttribute + count > attributeCount)
+		{
+			throw std::runtime_error(("\"" + fileName + "\" has an invalid element structure").toStdString());
+		}
+		QDomElement node = document.createElement(string(qFromLittleEndian(element[0])));
+		for (quint32 a = firstAttribute; a < firstAttribute + count; ++a)
+		{
+			node.setAttribute(string(qFromLittleEndian(attributes[a * AttributeSize])), string(qFromLittleEndian(attributes[a * AttributeSize + 1])));
+		}
+		if (text != None)
+		{
+			node.appendChild(document.createTextNode(string(text)));
+		}
+		if (parent == None)
+		{
+			document.appendChild(node);
+		}
+		else
+		{
+			created[parent].appendChild(node);
+		}
+		created[i] = node;
+	}
+	return document;
+}
+
+void ShowFile::write(const QDomDocument & document, const QString & fileName)
+{
+	ShowFileWriter writer;
+	if (!document.documentElement().isNull())
+	{
+		writer.addElement(document.documentElement(), None);
+	}
+	//write to a temporary file first, so a failed write does not destroy the old show
+	QSaveFile file(fileName);
+	const QByteArray data = writer.data();
+	if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+	{
+		throw std::runtime_error(("Failed to write \"" + fileName + "\"").toStdString());
+	}
+}
+
+QDomDocument ShowFile::load(const QString & fileName)
+{
+	if (isShowFile(fileName))
+	{
+		return read(fileName);
+	}
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		throw std::runtime_error(("Failed to open \"" + fileName + "\"").toStdString());
+	}
+	QDomDocument document("NerDisco");
+	QString errorMessage;
+	if (!document.setContent(&file, &errorMessage))
+	{
+		throw std::runtime_error(("Error reading \"" + fileName + "\": " + errorMessage).toStdString());
+	}
+	return document;
+}
+
+void ShowFile::save(const QDomDocument & document, const QString & fileName)
+{
+	if (fileName.endsWith(".xml", Qt::CaseInsensitive))
+	{
+		QSaveFile file(fileName);
+		const QByteArray data = document.toByteArray();
+		if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+		{
+			throw std::runtime_error(("Failed to write \"" + fileName + "\"").toStdString());
+		}
+	}
+	else
+	{
+		write(document, fileName);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QDomDocument>
+#include <QString>
+
+
+/// @brief Reads and writes settings documents as compact binary show files or as XML.
+/// All components save their settings to a QDomDocument with toXML() and read them with fromXML(). A show file stores
+/// this tree in a binary form that is read by memory-mapping the file. No text has to be parsed and every string,
+/// e.g. a script stored by a deck, is stored only once. Reading rebuilds the complete QDomDocument, so components read
+/// their settings with fromXML() as they do from XML files.
+/// File layout, all values are 32-bit little endian:
+/// Header: magic "NDSF", version, string count, element count, attribute count, string data size.
+/// Strings: offset and length of the UTF-8 string in the string data.
+/// Elements in document order: name string, parent element (0xFFFFFFFF for the root), first attribute, attribute count,
+/// text string (0xFFFFFFFF for no text).
+/// Attributes: name string, value string.
+/// String data.
+class ShowFile
+{
+public:
+	static const quint32 Magic = 0x4653444E; ///< "NDSF" in little endian.
+	static const quint32 Version = 1;
+	static const quint32 None = 0xFFFFFFFF; ///< Index of a parent or text that does not exist.
+
+	/// @brief Check if a file is a binary show file.
+	static bool isShowFile(const QString & fileName);
+
+	/// @brief Read a binary show file.
+	/// @return The settings document.
+	/// @throw std::runtime_error if the file can not be read or is not a valid show file.
+	static QDomDocument read(const QString & fileName);
+	/// @brief Write a settings document to a binary show file.
+	/// @throw std::runtime_error if the file can not be written.
+	static void write(const QDomDocument & document, const QString & fileName);
+
+	/// @brief Read a settings document from a binary show file or an XML file, depending on the content of the file.
+	/// @throw std::runtime_error if the file can not be read or parsed.
+	static QDomDocument load(const QString & fileName);
+	/// @brief Save a settings document as XML if the file name ends in ".xml", else as binary show file.
+	/// @throw std::runtime_error if the file can not be written.
+	static void save(const QDomDocument & document, const QString & fileName);
+};
@@ -0,0 +1,62 @@
+#include "ShowLoadThread.h"
+#include "ShowFile.h"
+
+#include <QElapsedTimer>
+#include <stdexcept>
+
+
+ShowLoadThread::ShowLoadThread(QObject * parent)
+	: QThread(parent)
+	, m_busy(false)
+{
+	qRegisterMetaType<QDomDocument>("QDomDocument");
+}
+
+ShowLoadThread::~ShowLoadThread()
+{
+	m_mutex.lock();
+	m_fileName.clear();
+	m_mutex.unlock();
+	wait();
+}
+
+void ShowLoadThread::load(const QString & fileName)
+{
+	QMutexLocker locker(&m_mutex);
+	m_fileName = fileName;
+	if (!m_busy)
+	{
+		//the thread may still be returning from the last run
+		m_busy = true;
+		wait();
+		start();
+	}
+}
+
+void ShowLoadThread::run()
+{
+	while (true)
+	{
+		m_mutex.lock();
+		const QString fileName = m_fileName;
+		m_fileName.clear();
+		if (fileName.isEmpty())
+		{
+			m_busy = false;
+			m_mutex.unlock();
+			return;
+		}
+		m_mutex.unlock();
+		QElapsedTimer timer;
+		timer.start();
+		try
+		{
+			const QDomDocument document = ShowFile::load(fileName);
+			emit loaded(fileName, document, QString(), timer.nsecsElapsed() / 1000000.0);
+		}
+		catch (std::runtime_error & e)
+		{
+			emit loaded(fileName, QDomDocument(), QString(e.what()), timer.nsecsElapsed() / 1000000.0);
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <QDomDocument>
+
+
+/// @brief Reads show or XML settings files in the background, so output continues while a show is loaded.
+/// The settings are applied by the receiver of loaded() in its own thread. MainWindow applies them in the GUI thread,
+/// one component per event loop turn, so output frames are rendered between the components.
+class ShowLoadThread : public QThread
+{
+	Q_OBJECT
+
+public:
+	ShowLoadThread(QObject * parent = nullptr);
+	~ShowLoadThread();
+
+	/// @brief Start reading a file. Emits loaded() when done. If a file is still being read, the new file is read after it.
+	void load(const QString & fileName);
+
+signals:
+	/// @brief Emitted when a file has been read.
+	/// @param fileName Name of the file read.
+	/// @param document The settings read. Null if reading failed.
+	/// @param errors Error message if reading failed.
+	/// @param readTime Time reading the file took in ms.
+	void loaded(const QString & fileName, const QDomDocument & document, const QString & errors, double readTime);
+
+protected:
+	void run();
+
+private:
+	QMutex m_mutex;
+	QString m_fileName;
+	bool m_busy;
+};
@@ -47,6 +47,19 @@ void SignalJoiner::start()
 	m_waitList = m_objectList;
 }
 
+void SignalJoiner::start(const QVector<QObject*> & objects)
+{
+	QMutexLocker locker(&m_listMutex);
+	for (auto object : objects)
+	{
+		if (!m_objectList.contains(object))
+		{
+			throw std::runtime_error("Object to join has not been added!");
+		}
+	}
+	m_waitList = objects;
+}
+
 void SignalJoiner::stop()
 {
 	m_waitList.clear();
@@ -17,6 +17,9 @@ public:
 	void removeObjectToJoin(QObject * object);
 
 	void start();
+	/// @brief Start joining only a subset of the objects added.
+	/// @param objects Objects to wait for. Must have been added with addObjectToJoin().
+	void start(const QVector<QObject*> & objects);
 	void stop();
 
 	bool isJoining() const;
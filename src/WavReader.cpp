@@ -0,0 +1,131 @@
+#include "WavReader.h"
+
+#include <QFile>
+#include <QByteArray>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+
+static uint32_t readUInt32(const char * data)
+{
+	const uint8_t * bytes = (const uint8_t *)data;
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint16_t readUInt16(const char * data)
+{
+	const uint8_t * bytes = (const uint8_t *)data;
+	return bytes[0] | (bytes[1] << 8);
+}
+
+WavReader::WavReader(const QString & fileName)
+	: m_sampleRate(0)
+	, m_channelCount(0)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		throw std::runtime_error("Failed to open WAVE file!");
+	}
+	const QByteArray data = file.readAll();
+	if (data.size() < 12 || memcmp(data.constData(), "RIFF", 4) != 0 || memcmp(data.constData() + 8, "WAVE", 4) != 0)
+	{
+		throw std::runtime_error("Not a RIFF WAVE file!");
+	}
+	//walk through the chunks and find format and data
+	int format = 0;
+	int blockAlign = 0;
+	const char * sampleData = nullptr;
+	int sampleDataSize = 0;
+	int offset = 12;
+	while (offset + 8 <= data.size())
+	{
+		const char * chunk = data.constData() + offset;
+		const int chunkSize = (int)std::min((uint32_t)(data.size() - offset - 8), readUInt32(chunk + 4));
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+		{
+			format = readUInt16(chunk + 8);
+			m_channelCount = readUInt16(chunk + 10);
+			m_sampleRate = (int)readUInt32(chunk + 12);
+			blockAlign = readUInt16(chunk + 20);
+			if (format == 0xFFFE && chunkSize >= 26)
+			{
+				//WAVE_FORMAT_EXTENSIBLE. the actual format is at the start of the sub-format GUID
+				format = readUInt16(chunk + 32);
+			}
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			sampleData = chunk + 8;
+			sampleDataSize = chunkSize;
+		}
+		//chunks are padded to an even size
+		offset += 8 + chunkSize + (chunkSize & 1);
+	}
+	if (m_channelCount <= 0 || m_sampleRate <= 0 || sampleData == nullptr)
+	{
+		throw std::runtime_error("WAVE file has no format or data!");
+	}
+	//convert samples to float
+	//samples may use less bits than their container, e.g. 20 bits in 3 bytes. they're aligned to the most significant bit
+	const int bytesPerSample = blockAlign / m_channelCount;
+	if (!((format == 1 && bytesPerSample >= 1 && bytesPerSample <= 4) || (format == 3 && bytesPerSample == 4)))
+	{
+		throw std::runtime_error("Unsupported WAVE sample format!");
+	}
+	const int sampleCount = (sampleDataSize / (bytesPerSample * m_channelCount)) * m_channelCount;
+	m_samples.resize(sampleCount);
+	for (int i = 0; i < sampleCount; ++i)
+	{
+		const char * sample = sampleData + i * bytesPerSample;
+		if (format == 3)
+		{
+			const uint32_t bits = readUInt32(sample);
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			m_samples[i] = value;
+		}
+		else if (bytesPerSample == 1)
+		{
+			//8-bit samples are unsigned
+			m_samples[i] = ((int)(uint8_t)sample[0] - 128) / 128.0f;
+		}
+		else
+		{
+			//sign-extend the sample from the most significant byte
+			int32_t value = (int8_t)sample[bytesPerSample - 1];
+			for (int b = bytesPerSample - 2; b >= 0; --b)
+			{
+				value = (int32_t)(((uint32_t)value << 8) | (uint8_t)sample[b]);
+			}
+			m_samples[i] = value / (float)(1u << (bytesPerSample * 8 - 1));
+		}
+	}
+}
+
+int WavReader::sampleRate() const
+{
+	return m_sampleRate;
+}
+
+int WavReader::channelCount() const
+{
+	return m_channelCount;
+}
+
+int WavReader::frameCount() const
+{
+	return m_samples.size() / m_channelCount;
+}
+
+double WavReader::duration() const
+{
+	return (double)frameCount() / m_sampleRate;
+}
+
+const QVector<float> & WavReader::samples() const
+{
+	return m_samples;
+}
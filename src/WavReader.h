@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+
+/// @brief Reads a RIFF WAVE file completely into memory.
+/// Supports integer PCM with 8, 16, 24 or 32 bits per sample and 32-bit float samples.
+class WavReader
+{
+public:
+	/// @brief Read a WAVE file.
+	/// @param fileName Path to the file.
+	/// @note Throws std::runtime_error if the file can not be read or has an unsupported format.
+	WavReader(const QString & fileName);
+
+	int sampleRate() const;
+	int channelCount() const;
+	/// @brief Retrieve the number of frames, e.g. samples per channel.
+	int frameCount() const;
+	/// @brief Retrieve the duration in seconds.
+	double duration() const;
+
+	/// @brief Retrieve all samples, interleaved and converted to float in the range [-1,1].
+	const QVector<float> & samples() const;
+
+private:
+	int m_sampleRate;
+	int m_channelCount;
+	QVector<float> m_samples;
+};